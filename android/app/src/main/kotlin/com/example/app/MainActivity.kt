@@ -41,6 +41,13 @@ class MainActivity : FlutterActivity() {
                     val isConnected = isConnected()
                     result.success(isConnected)
                 }
+                "getStatus" -> {
+                    result.success(mapOf(
+                        "isConnected" to isConnected(),
+                        "isWifiOrEthernet" to isConnectedToWifiOrEthernet(),
+                        "networkType" to getNetworkType()
+                    ))
+                }
                 "startNetworkMonitoring" -> {
                     startNetworkMonitoring()
                     result.success(null)
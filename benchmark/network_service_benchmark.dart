@@ -0,0 +1,71 @@
+import 'dart:async';
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+import 'package:flutter/widgets.dart';
+import 'package:imagedumper/services/network_service.dart';
+
+/// Microbenchmark: latency of reading the network state through dart:ffi
+/// versus a round trip over the `network_service` MethodChannel.
+///
+/// Linux only. Run in profile mode so the numbers are representative:
+///   flutter run -d linux --profile -t benchmark/network_service_benchmark.dart
+const int _warmupIterations = 200;
+const int _iterations = 5000;
+
+Future<void> main() async {
+  WidgetsFlutterBinding.ensureInitialized();
+
+  final bindings = NetworkServiceBindings.tryLoad();
+  if (bindings == null) {
+    print('❌ libnetwork_service.so is not available on this platform');
+    exit(1);
+  }
+
+  const channel = MethodChannel('network_service');
+
+  final ffi = await _measure(bindings.readStatus);
+  final methodChannel = await _measure(() async {
+    // What one event used to cost: two MethodChannel queries
+    await channel.invokeMethod('isConnectedToWifiOrEthernet');
+    await channel.invokeMethod('getNetworkType');
+  });
+  final singleCall = await _measure(() => channel.invokeMethod('getStatus'));
+
+  print('📊 Network state query latency ($_iterations iterations)');
+  _report('FFI network_service_get_status', ffi);
+  _report('MethodChannel getStatus', singleCall);
+  _report('MethodChannel x2 (previous event path)', methodChannel);
+  exit(0);
+}
+
+/// Run [body] repeatedly and return the sorted latencies in microseconds
+/// Synchronous bodies are not awaited, so they pay no event-loop hop
+Future<List<int>> _measure(FutureOr<void> Function() body) async {
+  for (var i = 0; i < _warmupIterations; i++) {
+    final pending = body();
+    if (pending is Future) await pending;
+  }
+
+  final samples = List<int>.filled(_iterations, 0);
+  final stopwatch = Stopwatch();
+  for (var i = 0; i < _iterations; i++) {
+    stopwatch
+      ..reset()
+      ..start();
+    final pending = body();
+    if (pending is Future) await pending;
+    stopwatch.stop();
+    samples[i] = stopwatch.elapsedMicroseconds;
+  }
+  samples.sort();
+  return samples;
+}
+
+void _report(String name, List<int> sorted) {
+  int percentile(double p) => sorted[((sorted.length - 1) * p).round()];
+  print(
+    '  $name: p50 ${percentile(0.50)} µs, p99 ${percentile(0.99)} µs, '
+    'max ${sorted.last} µs',
+  );
+}
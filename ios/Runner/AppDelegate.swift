@@ -24,6 +24,16 @@ import Network
         result(self?.getNetworkType() ?? "none")
       case "isConnected":
         result(self?.isConnected() ?? false)
+      case "getStatus":
+        guard let self = self else {
+          result(["isConnected": false, "isWifiOrEthernet": false, "networkType": "none"])
+          return
+        }
+        result([
+          "isConnected": self.isConnected(),
+          "isWifiOrEthernet": self.isConnectedToWifiOrEthernet(),
+          "networkType": self.getNetworkType()
+        ])
       case "startNetworkMonitoring":
         self?.startNetworkMonitoring()
         result(nil)
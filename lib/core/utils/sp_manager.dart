@@ -7,6 +7,11 @@ class SPManager {
   // Preference keys
   static const String _lastDownloadDateTimeKey = 'last_download_datetime';
   static const String _lastDownloadFilenameKey = 'last_download_filename';
+  static const String _interruptedDownloadsKey = 'interrupted_downloads';
+  static const String _syncCursorKey = 'sync_cursor';
+  static const String _minFreeSpaceKey = 'min_free_space';
+  static const String _storageLayoutKey = 'storage_layout';
+  static const String _appliedStorageLayoutKey = 'storage_layout_applied';
 
   /// Initialize SharedPreferences
   static Future<void> init() async {
@@ -99,4 +104,126 @@ class SPManager {
       return null;
     }
   }
+
+  // ========== Interrupted Downloads ==========
+
+  /// Save the downloads to resume on the next connection (encoded images)
+  static Future<bool> setInterruptedDownloads(List<String> images) async {
+    try {
+      final prefs = await _instance;
+      if (images.isEmpty) {
+        return await prefs.remove(_interruptedDownloadsKey);
+      }
+      return await prefs.setStringList(_interruptedDownloadsKey, images);
+    } catch (e) {
+      print('❌ Error saving interrupted downloads: $e');
+      return false;
+    }
+  }
+
+  /// Get the downloads to resume on the next connection (encoded images)
+  static Future<List<String>> getInterruptedDownloads() async {
+    try {
+      final prefs = await _instance;
+      return prefs.getStringList(_interruptedDownloadsKey) ?? [];
+    } catch (e) {
+      print('❌ Error getting interrupted downloads: $e');
+      return [];
+    }
+  }
+
+  // ========== Catch-up Sync Cursor ==========
+
+  /// Save the backend manifest position caught up to
+  static Future<bool> setSyncCursor(String cursor) async {
+    try {
+      final prefs = await _instance;
+      return await prefs.setString(_syncCursorKey, cursor);
+    } catch (e) {
+      print('❌ Error saving sync cursor: $e');
+      return false;
+    }
+  }
+
+  /// Get the backend manifest position caught up to
+  static Future<String?> getSyncCursor() async {
+    try {
+      final prefs = await _instance;
+      return prefs.getString(_syncCursorKey);
+    } catch (e) {
+      print('❌ Error getting sync cursor: $e');
+      return null;
+    }
+  }
+
+  // ========== Free-space Floor ==========
+
+  /// Save the free space (bytes) downloads must leave on the image folder's
+  /// disk
+  static Future<bool> setMinFreeSpace(int bytes) async {
+    try {
+      final prefs = await _instance;
+      return await prefs.setInt(_minFreeSpaceKey, bytes);
+    } catch (e) {
+      print('❌ Error saving free-space floor: $e');
+      return false;
+    }
+  }
+
+  /// Get the free space (bytes) downloads must leave, null if never set
+  static Future<int?> getMinFreeSpace() async {
+    try {
+      final prefs = await _instance;
+      return prefs.getInt(_minFreeSpaceKey);
+    } catch (e) {
+      print('❌ Error getting free-space floor: $e');
+      return null;
+    }
+  }
+
+  // ========== Storage Layout ==========
+
+  /// Save the layout new images are saved in (a StorageLayout name)
+  static Future<bool> setStorageLayout(String layout) async {
+    try {
+      final prefs = await _instance;
+      return await prefs.setString(_storageLayoutKey, layout);
+    } catch (e) {
+      print('❌ Error saving storage layout: $e');
+      return false;
+    }
+  }
+
+  /// Get the layout new images are saved in, null if never set
+  static Future<String?> getStorageLayout() async {
+    try {
+      final prefs = await _instance;
+      return prefs.getString(_storageLayoutKey);
+    } catch (e) {
+      print('❌ Error getting storage layout: $e');
+      return null;
+    }
+  }
+
+  /// Save the layout the images folder was last migrated to
+  static Future<bool> setAppliedStorageLayout(String layout) async {
+    try {
+      final prefs = await _instance;
+      return await prefs.setString(_appliedStorageLayoutKey, layout);
+    } catch (e) {
+      print('❌ Error saving applied storage layout: $e');
+      return false;
+    }
+  }
+
+  /// Get the layout the images folder was last migrated to, null if never
+  static Future<String?> getAppliedStorageLayout() async {
+    try {
+      final prefs = await _instance;
+      return prefs.getString(_appliedStorageLayoutKey);
+    } catch (e) {
+      print('❌ Error getting applied storage layout: $e');
+      return null;
+    }
+  }
 }
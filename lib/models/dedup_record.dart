@@ -0,0 +1,36 @@
+/// Entry written to the native dedup index for a saved image
+class DedupRecord {
+  /// XXH64 of the file content, 16 hex digits
+  final String hash;
+
+  final int size;
+
+  /// Name of an earlier image with identical content, if any
+  final String? duplicateOf;
+
+  /// Directory of [duplicateOf] under the images folder, '' for the folder
+  final String? duplicateShard;
+
+  const DedupRecord({
+    required this.hash,
+    required this.size,
+    this.duplicateOf,
+    this.duplicateShard,
+  });
+
+  /// Create DedupRecord from the `recordImage` response map
+  factory DedupRecord.fromMap(Map<dynamic, dynamic> map) {
+    return DedupRecord(
+      hash: map['hash'] ?? '',
+      size: map['size'] ?? 0,
+      duplicateOf: map['duplicateOf'],
+      duplicateShard: map['duplicateShard'],
+    );
+  }
+
+  @override
+  String toString() {
+    return 'DedupRecord(hash: $hash, size: $size, duplicateOf: $duplicateOf, '
+        'duplicateShard: $duplicateShard)';
+  }
+}
@@ -0,0 +1,80 @@
+/// Progress of one download, as sampled by the progress tracker
+class TransferProgress {
+  /// File being downloaded
+  final String label;
+
+  /// Bytes received so far
+  final int bytes;
+
+  /// Size of the download, -1 when unknown
+  final int total;
+
+  /// Smoothed receive rate
+  final double bytesPerSecond;
+
+  const TransferProgress({
+    required this.label,
+    this.bytes = 0,
+    this.total = -1,
+    this.bytesPerSecond = 0,
+  });
+
+  /// Share received, 0.0 - 1.0, null when the size is unknown
+  double? get fraction =>
+      total > 0 ? (bytes / total).clamp(0.0, 1.0).toDouble() : null;
+
+  /// Time left at the current rate, null when it can't be estimated
+  Duration? get eta => _eta(bytes, total, bytesPerSecond);
+
+  @override
+  String toString() {
+    return 'TransferProgress(label: $label, bytes: $bytes, total: $total, bytesPerSecond: ${bytesPerSecond.round()})';
+  }
+}
+
+/// Every download in flight, merged into one figure for the UI
+class DownloadProgress {
+  final List<TransferProgress> transfers;
+
+  const DownloadProgress([this.transfers = const []]);
+
+  static const DownloadProgress idle = DownloadProgress();
+
+  bool get isIdle => transfers.isEmpty;
+
+  int get bytes => transfers.fold(0, (sum, t) => sum + t.bytes);
+
+  /// Combined size, -1 while any download's size is unknown
+  int get total {
+    var sum = 0;
+    for (final transfer in transfers) {
+      if (transfer.total < 0) return -1;
+      sum += transfer.total;
+    }
+    return sum;
+  }
+
+  double get bytesPerSecond =>
+      transfers.fold(0.0, (sum, t) => sum + t.bytesPerSecond);
+
+  /// Share received, 0.0 - 1.0, null when a size is unknown
+  double? get fraction {
+    final all = total;
+    return all > 0 ? (bytes / all).clamp(0.0, 1.0).toDouble() : null;
+  }
+
+  /// Time until the last download finishes at the current rates
+  Duration? get eta => _eta(bytes, total, bytesPerSecond);
+
+  @override
+  String toString() {
+    return 'DownloadProgress(transfers: ${transfers.length}, bytes: $bytes, total: $total, bytesPerSecond: ${bytesPerSecond.round()})';
+  }
+}
+
+Duration? _eta(int bytes, int total, double bytesPerSecond) {
+  if (total < 0 || bytesPerSecond <= 0) return null;
+  final remaining = total - bytes;
+  if (remaining <= 0) return Duration.zero;
+  return Duration(milliseconds: (remaining / bytesPerSecond * 1000).round());
+}
@@ -0,0 +1,36 @@
+/// Snapshot of the download scheduler's queue, for the UI
+class DownloadQueueState {
+  /// Downloads waiting for a free slot
+  final int queued;
+
+  /// Downloads currently transferring or saving
+  final int active;
+
+  /// Downloads dropped because the queue was full
+  final int dropped;
+
+  const DownloadQueueState({
+    this.queued = 0,
+    this.active = 0,
+    this.dropped = 0,
+  });
+
+  static const DownloadQueueState idle = DownloadQueueState();
+
+  bool get isIdle => queued == 0 && active == 0;
+
+  @override
+  bool operator ==(Object other) =>
+      other is DownloadQueueState &&
+      other.queued == queued &&
+      other.active == active &&
+      other.dropped == dropped;
+
+  @override
+  int get hashCode => Object.hash(queued, active, dropped);
+
+  @override
+  String toString() {
+    return 'DownloadQueueState(queued: $queued, active: $active, dropped: $dropped)';
+  }
+}
@@ -0,0 +1,121 @@
+/// One completed download from the download history
+class DownloadRecord {
+  final String filename;
+
+  /// Size of the saved file
+  final int size;
+
+  /// Bytes transferred; less than [size] when the download was resumed
+  final int bytes;
+
+  /// XXH64 of the file content, 16 hex digits, if known
+  final String? hash;
+
+  final DateTime startedAt;
+  final DateTime finishedAt;
+
+  /// Time spent transferring, which excludes queueing and saving
+  final Duration duration;
+
+  /// Network type the download ran on ("wifi", "ethernet", ...)
+  final String linkType;
+
+  const DownloadRecord({
+    required this.filename,
+    required this.size,
+    required this.bytes,
+    this.hash,
+    required this.startedAt,
+    required this.finishedAt,
+    required this.duration,
+    required this.linkType,
+  });
+
+  /// Create DownloadRecord from a `download_history` record map
+  factory DownloadRecord.fromMap(Map<dynamic, dynamic> map) {
+    return DownloadRecord(
+      filename: map['filename'] ?? '',
+      size: map['size'] ?? 0,
+      bytes: map['bytes'] ?? 0,
+      hash: map['hash'],
+      startedAt: DateTime.fromMillisecondsSinceEpoch(map['startedAt'] ?? 0),
+      finishedAt: DateTime.fromMillisecondsSinceEpoch(map['finishedAt'] ?? 0),
+      duration: Duration(milliseconds: map['durationMs'] ?? 0),
+      linkType: map['linkType'] ?? 'none',
+    );
+  }
+
+  /// [finishedAt] as shown on the home screen (YYYY-MM-DD HH-MM)
+  String get finishedAtFormatted => formatTime(finishedAt);
+
+  static String formatTime(DateTime dateTime) {
+    final year = dateTime.year.toString().padLeft(4, '0');
+    final month = dateTime.month.toString().padLeft(2, '0');
+    final day = dateTime.day.toString().padLeft(2, '0');
+    final hour = dateTime.hour.toString().padLeft(2, '0');
+    final minute = dateTime.minute.toString().padLeft(2, '0');
+    return '$year-$month-$day $hour-$minute';
+  }
+
+  @override
+  String toString() {
+    return 'DownloadRecord(filename: $filename, size: $size, bytes: $bytes, '
+        'finishedAt: $finishedAt, duration: $duration, linkType: $linkType)';
+  }
+}
+
+/// Totals over a range of the download history
+class DownloadStats {
+  final int count;
+  final int size;
+  final int bytes;
+  final Duration duration;
+
+  /// Finish time of the oldest and newest record counted, null if none
+  final DateTime? first;
+  final DateTime? last;
+
+  const DownloadStats({
+    required this.count,
+    required this.size,
+    required this.bytes,
+    required this.duration,
+    this.first,
+    this.last,
+  });
+
+  static const empty = DownloadStats(
+    count: 0,
+    size: 0,
+    bytes: 0,
+    duration: Duration.zero,
+  );
+
+  /// Create DownloadStats from the `stats` response map
+  factory DownloadStats.fromMap(Map<dynamic, dynamic> map) {
+    final int count = map['count'] ?? 0;
+    return DownloadStats(
+      count: count,
+      size: map['size'] ?? 0,
+      bytes: map['bytes'] ?? 0,
+      duration: Duration(milliseconds: map['durationMs'] ?? 0),
+      first: count > 0
+          ? DateTime.fromMillisecondsSinceEpoch(map['firstAt'])
+          : null,
+      last: count > 0
+          ? DateTime.fromMillisecondsSinceEpoch(map['lastAt'])
+          : null,
+    );
+  }
+
+  /// Average transfer rate in bytes per second, 0 if nothing was timed
+  double get bytesPerSecond => duration.inMilliseconds > 0
+      ? bytes * 1000 / duration.inMilliseconds
+      : 0;
+
+  @override
+  String toString() {
+    return 'DownloadStats(count: $count, size: $size, bytes: $bytes, '
+        'duration: $duration)';
+  }
+}
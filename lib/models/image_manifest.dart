@@ -0,0 +1,39 @@
+import 'image_model.dart';
+
+/// One page of the backend's image manifest (`GET /api/images?since=`)
+class ImageManifestPage {
+  /// Images uploaded after the requested cursor, oldest first
+  final List<ImageModel> images;
+
+  /// Cursor to continue from; null if the server sent none
+  final String? nextCursor;
+
+  /// Whether more images follow [nextCursor]
+  final bool hasMore;
+
+  const ImageManifestPage({
+    required this.images,
+    this.nextCursor,
+    this.hasMore = false,
+  });
+
+  /// Create ImageManifestPage from JSON
+  factory ImageManifestPage.fromJson(Map<String, dynamic> json) {
+    final images = json['images'];
+    return ImageManifestPage(
+      images: images is List
+          ? [
+              for (final image in images)
+                if (image is Map<String, dynamic>) ImageModel.fromJson(image),
+            ]
+          : const [],
+      nextCursor: json['nextCursor']?.toString(),
+      hasMore: json['hasMore'] == true,
+    );
+  }
+
+  @override
+  String toString() {
+    return 'ImageManifestPage(images: ${images.length}, nextCursor: $nextCursor, hasMore: $hasMore)';
+  }
+}
@@ -4,11 +4,15 @@ class ImageModel {
   final int size;
   final String uploadedAt;
 
+  /// XXH64 of the content (16 hex digits), when the server sends one
+  final String? checksum;
+
   ImageModel({
     required this.filename,
     required this.url,
     required this.size,
     required this.uploadedAt,
+    this.checksum,
   });
 
   /// Create ImageModel from JSON
@@ -20,6 +24,18 @@ class ImageModel {
           : '',
       size: json['size'] ?? 0,
       uploadedAt: json['uploadedAt'] ?? '',
+      checksum: json['checksum'],
+    );
+  }
+
+  /// Create ImageModel from [toJson] output, whose url is already absolute
+  factory ImageModel.fromSavedJson(Map<String, dynamic> json) {
+    return ImageModel(
+      filename: json['filename'] ?? '',
+      url: json['url'] ?? '',
+      size: json['size'] ?? 0,
+      uploadedAt: json['uploadedAt'] ?? '',
+      checksum: json['checksum'],
     );
   }
 
@@ -30,11 +46,12 @@ class ImageModel {
       'url': url,
       'size': size,
       'uploadedAt': uploadedAt,
+      if (checksum != null) 'checksum': checksum,
     };
   }
 
   @override
   String toString() {
-    return 'ImageModel(filename: $filename, url: $url, size: $size, uploadedAt: $uploadedAt)';
+    return 'ImageModel(filename: $filename, url: $url, size: $size, uploadedAt: $uploadedAt, checksum: $checksum)';
   }
 }
@@ -0,0 +1,81 @@
+/// Capacity indicators of the primary network link
+///
+/// Reported by the Linux network monitor (linux/runner/network_service_linux.h);
+/// every field may be unknown, as most drivers only report some of them.
+class LinkQuality {
+  /// Negotiated speed of a wired link, -1 when unknown
+  final int speedMbps;
+
+  /// `full`, `half`, or null when unknown
+  final String? duplex;
+
+  /// -1 when unknown
+  final int mtu;
+
+  /// Wi-Fi signal strength, 0 when unknown
+  final int signalDbm;
+
+  /// Current Wi-Fi transmit rate, -1 when unknown
+  final int txBitrateKbps;
+
+  const LinkQuality({
+    this.speedMbps = -1,
+    this.duplex,
+    this.mtu = -1,
+    this.signalDbm = 0,
+    this.txBitrateKbps = -1,
+  });
+
+  static const LinkQuality unknown = LinkQuality();
+
+  // Native NetworkServiceDuplex values (linux/runner/network_service_ffi.h)
+  static const List<String?> _duplexModes = [null, 'half', 'full'];
+
+  /// Create LinkQuality from native fields
+  factory LinkQuality.fromNative({
+    required int speedMbps,
+    required int duplex,
+    required int mtu,
+    required int signalDbm,
+    required int txBitrateKbps,
+  }) {
+    return LinkQuality(
+      speedMbps: speedMbps,
+      duplex: duplex >= 0 && duplex < _duplexModes.length
+          ? _duplexModes[duplex]
+          : null,
+      mtu: mtu,
+      signalDbm: signalDbm,
+      txBitrateKbps: txBitrateKbps,
+    );
+  }
+
+  /// Best estimate of the link's raw capacity, null when nothing is known
+  /// Wired speed if the driver reports one, else the Wi-Fi transmit rate
+  double? get capacityMbps {
+    if (speedMbps > 0) return speedMbps.toDouble();
+    if (txBitrateKbps > 0) return txBitrateKbps / 1000;
+    return null;
+  }
+
+  /// Wi-Fi signal below -70 dBm, where retries and rate drops set in
+  bool get isWeakSignal => signalDbm != 0 && signalDbm < -70;
+
+  @override
+  bool operator ==(Object other) =>
+      other is LinkQuality &&
+      other.speedMbps == speedMbps &&
+      other.duplex == duplex &&
+      other.mtu == mtu &&
+      other.signalDbm == signalDbm &&
+      other.txBitrateKbps == txBitrateKbps;
+
+  @override
+  int get hashCode =>
+      Object.hash(speedMbps, duplex, mtu, signalDbm, txBitrateKbps);
+
+  @override
+  String toString() {
+    return 'LinkQuality(speedMbps: $speedMbps, duplex: $duplex, mtu: $mtu, signalDbm: $signalDbm, txBitrateKbps: $txBitrateKbps)';
+  }
+}
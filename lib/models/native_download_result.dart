@@ -0,0 +1,150 @@
+/// Why a native download failed (DownloadFailure in
+/// linux/runner/download_engine_linux.h)
+enum NativeDownloadFailure {
+  none,
+
+  /// The engine shut down first
+  cancelled,
+
+  /// Timeouts, resets, refused connections, bodies cut short
+  network,
+
+  /// An error status, or a response that broke the range protocol
+  server,
+
+  /// Checksum or size mismatch, an object that kept changing, a malformed
+  /// archive
+  content,
+
+  /// Opening, writing or reading back the file failed
+  local,
+
+  /// See [NativeDownloadResult.insufficientSpace]
+  noSpace;
+
+  static NativeDownloadFailure fromName(String? name) {
+    for (final failure in values) {
+      if (failure.name == name) return failure;
+    }
+    return none;
+  }
+}
+
+/// Outcome of a download run by the native download engine
+class NativeDownloadResult {
+  final bool success;
+
+  /// HTTP status of the last response, 0 if none was received
+  final int statusCode;
+
+  /// Bytes written to the destination file
+  final int bytes;
+
+  /// Most ranged requests that were in flight at once (1 = single stream)
+  final int connections;
+
+  /// XXH64 of the content (16 hex digits), computed while downloading
+  final String? hash;
+
+  /// Bytes an earlier, interrupted attempt had already written
+  final int resumedBytes;
+
+  /// Failed, but the partial file was kept; downloading the same URL into
+  /// the same path again continues from where this attempt stopped
+  final bool resumable;
+
+  /// Failed for lack of disk space: the free-space floor would have been
+  /// crossed, or the disk filled up; worth retrying once space is freed
+  final bool insufficientSpace;
+
+  /// Files unpacked by an archive download, empty otherwise
+  final List<NativeArchiveEntry> entries;
+
+  /// Kind of failure, [NativeDownloadFailure.none] on success; decide on
+  /// this rather than on the wording of [error]
+  final NativeDownloadFailure failure;
+
+  /// Failure reason, null on success
+  final String? error;
+
+  const NativeDownloadResult({
+    required this.success,
+    this.statusCode = 0,
+    this.bytes = 0,
+    this.connections = 0,
+    this.hash,
+    this.resumedBytes = 0,
+    this.resumable = false,
+    this.insufficientSpace = false,
+    this.entries = const [],
+    this.failure = NativeDownloadFailure.none,
+    this.error,
+  });
+
+  /// Create NativeDownloadResult from the `download_engine` response map
+  factory NativeDownloadResult.fromMap(
+    Map<dynamic, dynamic>? map, {
+    bool success = true,
+    String? error,
+  }) {
+    return NativeDownloadResult(
+      success: success,
+      statusCode: map?['statusCode'] ?? 0,
+      bytes: map?['bytes'] ?? 0,
+      connections: map?['connections'] ?? 0,
+      hash: map?['hash'],
+      resumedBytes: map?['resumedBytes'] ?? 0,
+      resumable: map?['resumable'] ?? false,
+      insufficientSpace: map?['insufficientSpace'] ?? false,
+      entries: [
+        for (final entry in map?['entries'] ?? const [])
+          if (entry is Map) NativeArchiveEntry.fromMap(entry),
+      ],
+      failure: NativeDownloadFailure.fromName(map?['failure']),
+      error: error,
+    );
+  }
+
+  @override
+  String toString() {
+    return success
+        ? 'NativeDownloadResult($bytes bytes, $connections connection(s), hash: $hash)'
+        : 'NativeDownloadResult(failed: $error (${failure.name}), status: $statusCode, resumable: $resumable)';
+  }
+}
+
+/// A file unpacked from an archive by the native download engine
+class NativeArchiveEntry {
+  /// File name in the archive, without any directory part
+  final String name;
+
+  /// Where it was written: the hidden `.partial` staging file for [name]
+  final String path;
+
+  final int size;
+
+  /// XXH64 of the content (16 hex digits)
+  final String hash;
+
+  const NativeArchiveEntry({
+    required this.name,
+    required this.path,
+    required this.size,
+    required this.hash,
+  });
+
+  /// Create NativeArchiveEntry from an `entries` item of the response map
+  factory NativeArchiveEntry.fromMap(Map<dynamic, dynamic> map) {
+    return NativeArchiveEntry(
+      name: map['name'] ?? '',
+      path: map['path'] ?? '',
+      size: map['size'] ?? 0,
+      hash: map['hash'] ?? '',
+    );
+  }
+
+  @override
+  String toString() {
+    return 'NativeArchiveEntry($name, $size bytes, hash: $hash)';
+  }
+}
@@ -0,0 +1,83 @@
+import 'dart:typed_data';
+
+import 'link_quality.dart';
+import 'network_status.dart';
+
+/// A notification from `network_service/events`
+///
+/// Linux sends a compact little-endian binary payload (see
+/// linux/runner/network_event_codec.h); the other platforms still send a
+/// string-keyed map, which is decoded into the same value.
+class NetworkEvent {
+  /// Newest payload version this decoder understands
+  static const int currentVersion = 2;
+
+  /// Size of the version 1 payload in bytes
+  static const int _v1Size = 24;
+
+  /// Size of the version 2 payload (adds the primary link's quality)
+  static const int _v2Size = 40;
+
+  final int version;
+  final NetworkStatus status;
+
+  /// Native status page generation, 0 when the platform does not have one
+  final int generation;
+
+  /// Milliseconds since epoch when the native side took the snapshot
+  final int timestampMs;
+
+  const NetworkEvent({
+    required this.version,
+    required this.status,
+    this.generation = 0,
+    this.timestampMs = 0,
+  });
+
+  /// Decode a binary payload
+  /// Returns null if it is shorter than the fields it announces. Payloads
+  /// from newer versions are accepted: only the known prefix is read.
+  static NetworkEvent? decode(Uint8List bytes) {
+    if (bytes.length < _v1Size) return null;
+
+    final data = ByteData.sublistView(bytes);
+    final version = data.getUint8(0);
+    final length = data.getUint32(4, Endian.little);
+    if (version < 1 || length < _v1Size || length > bytes.length) return null;
+
+    final link = length >= _v2Size
+        ? LinkQuality.fromNative(
+            speedMbps: data.getInt32(24, Endian.little),
+            txBitrateKbps: data.getInt32(28, Endian.little),
+            mtu: data.getInt32(32, Endian.little),
+            signalDbm: data.getInt8(36),
+            duplex: data.getUint8(37),
+          )
+        : LinkQuality.unknown;
+
+    return NetworkEvent(
+      version: version,
+      status: NetworkStatus.fromNative(
+        data.getUint8(1),
+        data.getUint16(2, Endian.little),
+        link: link,
+      ),
+      generation: data.getUint64(8, Endian.little),
+      timestampMs: data.getInt64(16, Endian.little),
+    );
+  }
+
+  /// Create NetworkEvent from a legacy map payload
+  factory NetworkEvent.fromMap(Map<dynamic, dynamic> map) {
+    return NetworkEvent(
+      version: 0,
+      status: NetworkStatus.fromMap(map),
+      timestampMs: map['timestamp'] ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return 'NetworkEvent(version: $version, status: $status, generation: $generation, timestampMs: $timestampMs)';
+  }
+}
@@ -0,0 +1,67 @@
+import 'link_quality.dart';
+
+/// Network state reported by the native network service
+class NetworkStatus {
+  final bool isConnected;
+  final bool isWifiOrEthernet;
+  final String networkType;
+
+  /// Quality of the primary link (Linux only, unknown elsewhere)
+  final LinkQuality link;
+
+  const NetworkStatus({
+    required this.isConnected,
+    required this.isWifiOrEthernet,
+    required this.networkType,
+    this.link = LinkQuality.unknown,
+  });
+
+  // Indexed by the native NetworkServiceType values
+  // (linux/runner/network_service_ffi.h)
+  static const List<String> _networkTypes = [
+    'none',
+    'wifi',
+    'ethernet',
+    'mobile',
+  ];
+
+  // Native NETWORK_SERVICE_STATUS_* flag bits
+  static const int _connectedBit = 1 << 8;
+  static const int _wifiOrEthernetBit = 1 << 9;
+
+  static const NetworkStatus offline = NetworkStatus(
+    isConnected: false,
+    isWifiOrEthernet: false,
+    networkType: 'none',
+  );
+
+  /// Create NetworkStatus from a native type code and status flags
+  factory NetworkStatus.fromNative(
+    int type,
+    int flags, {
+    LinkQuality link = LinkQuality.unknown,
+  }) {
+    return NetworkStatus(
+      isConnected: (flags & _connectedBit) != 0,
+      isWifiOrEthernet: (flags & _wifiOrEthernetBit) != 0,
+      networkType: type >= 0 && type < _networkTypes.length
+          ? _networkTypes[type]
+          : 'none',
+      link: link,
+    );
+  }
+
+  /// Create NetworkStatus from a `network_service/events` map payload
+  factory NetworkStatus.fromMap(Map<dynamic, dynamic> map) {
+    return NetworkStatus(
+      isConnected: map['isConnected'] ?? false,
+      isWifiOrEthernet: map['isWifiOrEthernet'] ?? false,
+      networkType: map['networkType'] ?? 'none',
+    );
+  }
+
+  @override
+  String toString() {
+    return 'NetworkStatus(isConnected: $isConnected, isWifiOrEthernet: $isWifiOrEthernet, networkType: $networkType, link: $link)';
+  }
+}
@@ -0,0 +1,50 @@
+import 'dart:convert';
+
+/// How images are arranged in the molethewall folder (Linux & macOS)
+///
+/// A flat folder gets slow to list, back up and look up in once it holds
+/// 100k+ images; the sharded layouts keep each directory small. Where an
+/// image went is recorded in the native dedup index (Linux), so finding it
+/// again never lists the folder.
+enum StorageLayout {
+  /// Every image directly in the folder
+  flat,
+
+  /// `YYYY/MM/DD/`, by the local day the image was saved
+  byDate,
+
+  /// 256 buckets, `00/` to `ff/`, by a hash of the filename
+  byHash;
+
+  /// Layout saved under [name], flat if unknown
+  static StorageLayout fromName(String? name) {
+    return StorageLayout.values.firstWhere(
+      (layout) => layout.name == name,
+      orElse: () => StorageLayout.flat,
+    );
+  }
+
+  /// Directory under the folder for [filename] saved at [savedAt], '' for
+  /// the folder itself
+  String shardFor(String filename, DateTime savedAt) {
+    switch (this) {
+      case StorageLayout.flat:
+        return '';
+      case StorageLayout.byDate:
+        final month = savedAt.month.toString().padLeft(2, '0');
+        final day = savedAt.day.toString().padLeft(2, '0');
+        return '${savedAt.year}/$month/$day';
+      case StorageLayout.byHash:
+        return _bucket(filename).toRadixString(16).padLeft(2, '0');
+    }
+  }
+
+  /// FNV-1a of the UTF-8 name, folded to a byte
+  static int _bucket(String filename) {
+    var hash = 0x811c9dc5;
+    for (final byte in utf8.encode(filename)) {
+      hash = ((hash ^ byte) * 0x01000193) & 0xffffffff;
+    }
+    return (hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24)) & 0xff;
+  }
+}
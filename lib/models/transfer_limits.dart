@@ -0,0 +1,32 @@
+/// How hard the downloader currently drives the link
+class TransferLimits {
+  /// Downloads allowed to run at the same time
+  final int transfers;
+
+  /// Parallel ranged requests per download (native engine)
+  final int connections;
+
+  /// Bytes per ranged request (native engine)
+  final int chunkSize;
+
+  const TransferLimits({
+    required this.transfers,
+    required this.connections,
+    required this.chunkSize,
+  });
+
+  @override
+  bool operator ==(Object other) =>
+      other is TransferLimits &&
+      other.transfers == transfers &&
+      other.connections == connections &&
+      other.chunkSize == chunkSize;
+
+  @override
+  int get hashCode => Object.hash(transfers, connections, chunkSize);
+
+  @override
+  String toString() {
+    return 'TransferLimits(transfers: $transfers, connections: $connections, chunkSize: $chunkSize)';
+  }
+}
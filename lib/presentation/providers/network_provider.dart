@@ -1,10 +1,17 @@
 import 'dart:async';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
-import 'package:imagedumper/core/utils/sp_manager.dart';
+import 'package:imagedumper/models/download_progress.dart';
+import 'package:imagedumper/models/download_queue_state.dart';
 import 'package:imagedumper/models/image_model.dart';
+import 'package:imagedumper/models/network_event.dart';
+import '../../services/catch_up_service.dart';
+import '../../services/download_history.dart';
 import '../../services/network_service.dart';
 import '../../services/socket_service.dart';
+import '../../services/download_scheduler.dart';
 import '../../services/download_service.dart';
+import '../../services/progress_tracker.dart';
+import '../../services/transfer_controller.dart';
 
 // Network Status Provider
 final networkStatusProvider =
@@ -12,7 +19,11 @@ final networkStatusProvider =
       return NetworkStatusNotifier(
         ref.read(networkServiceProvider),
         ref.read(socketServiceProvider),
-        ref.read(downloadManagerProvider),
+        ref.read(downloadSchedulerProvider),
+        ref.read(transferControllerProvider),
+        ref.read(progressTrackerProvider),
+        ref.read(catchUpServiceProvider),
+        ref.read(downloadHistoryProvider),
       );
     });
 
@@ -22,6 +33,8 @@ class NetworkState {
   final String downloadStatus;
   final String lastDownloadTime;
   final String lastDownloadFilename;
+  final DownloadQueueState downloadQueue;
+  final DownloadProgress downloadProgress;
 
   NetworkState({
     this.isWifiOrEthernet = false,
@@ -29,6 +42,8 @@ class NetworkState {
     this.downloadStatus = '',
     this.lastDownloadTime = '',
     this.lastDownloadFilename = '',
+    this.downloadQueue = DownloadQueueState.idle,
+    this.downloadProgress = DownloadProgress.idle,
   });
 
   NetworkState copyWith({
@@ -37,6 +52,8 @@ class NetworkState {
     String? downloadStatus,
     String? lastDownloadTime,
     String? lastDownloadFilename,
+    DownloadQueueState? downloadQueue,
+    DownloadProgress? downloadProgress,
   }) {
     return NetworkState(
       isWifiOrEthernet: isWifiOrEthernet ?? this.isWifiOrEthernet,
@@ -44,60 +61,86 @@ class NetworkState {
       downloadStatus: downloadStatus ?? this.downloadStatus,
       lastDownloadTime: lastDownloadTime ?? this.lastDownloadTime,
       lastDownloadFilename: lastDownloadFilename ?? this.lastDownloadFilename,
+      downloadQueue: downloadQueue ?? this.downloadQueue,
+      downloadProgress: downloadProgress ?? this.downloadProgress,
     );
   }
 }
 
 class NetworkStatusNotifier extends StateNotifier<NetworkState> {
-  StreamSubscription<Map<String, dynamic>>? _networkSubscription;
+  StreamSubscription<NetworkEvent>? _networkSubscription;
   StreamSubscription<Map<String, dynamic>>? _socketSubscription;
+  StreamSubscription<DownloadQueueState>? _queueSubscription;
+  StreamSubscription<DownloadProgress>? _progressSubscription;
   bool _isReconnecting = false;
   bool _socketInitialized = false;
 
   final NetworkService _networkService;
   final SocketService _socketService;
-  final DownloadManager _downloadManager;
+  final DownloadScheduler _downloadScheduler;
+  final TransferController _transferController;
+  final ProgressTracker _progressTracker;
+  final CatchUpService _catchUpService;
+  final DownloadHistory _downloadHistory;
 
   NetworkStatusNotifier(
     this._networkService,
     this._socketService,
-    this._downloadManager,
+    this._downloadScheduler,
+    this._transferController,
+    this._progressTracker,
+    this._catchUpService,
+    this._downloadHistory,
   ) : super(NetworkState()) {
+    _queueSubscription = _downloadScheduler.queueChanges.listen((queue) {
+      state = state.copyWith(downloadQueue: queue);
+    });
+    // Already sampled (10 Hz) and merged across downloads
+    _progressSubscription = _progressTracker.progressChanges.listen(
+      (progress) => state = state.copyWith(downloadProgress: progress),
+    );
     _initializeServices();
   }
 
   Future<void> _initializeServices() async {
     await _initializeNetworkMonitoring();
     await _initializeSocket();
+    if (state.isWifiOrEthernet) _catchUp();
   }
 
   Future<void> _initializeNetworkMonitoring() async {
     try {
       // Get initial status
-      final isWifiOrEthernet = await _networkService
-          .isConnectedToWifiOrEthernet();
-      final networkType = await _networkService.getNetworkType();
+      final status = await _networkService.getStatus();
+      final lastDownload = await _downloadHistory.latest();
       state = state.copyWith(
-        isWifiOrEthernet: isWifiOrEthernet,
-        networkType: networkType,
-        lastDownloadTime: await SPManager.getLastDownloadDateTimeFormatted(),
-        lastDownloadFilename: await SPManager.getLastDownloadFilename(),
+        isWifiOrEthernet: status.isWifiOrEthernet,
+        networkType: status.networkType,
+        lastDownloadTime: lastDownload?.finishedAtFormatted,
+        lastDownloadFilename: lastDownload?.filename,
       );
+      _transferController.setLink(status.networkType, status.link);
 
       // Start live monitoring
       await _networkService.startNetworkMonitoring();
 
       _networkSubscription = _networkService.networkChanges.listen(
-        (networkData) async {
-          final isWifiOrEthernet = await _networkService
-              .isConnectedToWifiOrEthernet();
-          final networkType = await _networkService.getNetworkType();
+        (networkEvent) {
+          // No platform-channel round trips: the state comes from the event
+          // itself, or from the native status page on Linux
+          final status = _networkService.statusFromEvent(networkEvent);
+          final isWifiOrEthernet = status.isWifiOrEthernet;
           final wasConnected = state.isWifiOrEthernet;
 
           state = state.copyWith(
             isWifiOrEthernet: isWifiOrEthernet,
-            networkType: networkType,
+            networkType: status.networkType,
           );
+          _transferController.setLink(status.networkType, status.link);
+
+          // Downloads cut off by the outage continue where they stopped,
+          // and images announced during it are fetched
+          if (isWifiOrEthernet && !wasConnected) _catchUp();
 
           // Only reconnect socket if we just got connected and socket is not connected
           // Avoid reconnecting if we were already connected or if already reconnecting
@@ -178,42 +221,61 @@ class NetworkStatusNotifier extends StateNotifier<NetworkState> {
         return;
       }
 
-      // Download the image
-      _downloadManager.downloadImageToGallery(imageModel.url).listen((
-        result,
-      ) async {
-        if (result.status == DownloadStatus.started ||
-            result.status == DownloadStatus.downloading) {
-          state = state.copyWith(downloadStatus: 'Downloading new image ...');
-        } else if (result.status == DownloadStatus.saving) {
-          state = state.copyWith(downloadStatus: 'Saving image to gallery ...');
-        } else if (result.status == DownloadStatus.completed) {
-          final lastDownloadTime =
-              await SPManager.getLastDownloadDateTimeFormatted();
-          final lastDownloadFilename =
-              await SPManager.getLastDownloadFilename();
-          state = state.copyWith(
-            downloadStatus: 'Image saved to gallery',
-            lastDownloadTime: lastDownloadTime,
-            lastDownloadFilename: lastDownloadFilename,
-          );
-        } else if (result.status == DownloadStatus.failed) {
-          state = state.copyWith(
-            downloadStatus: 'Failed to save image to gallery',
-          );
-        } else {
-          state = state.copyWith(
-            downloadStatus: 'There is no new image to download',
-          );
-        }
-      });
+      // Queue the download; the scheduler bounds how many run at once
+      _trackDownload(_downloadScheduler.enqueue(imageModel));
     } catch (e) {
       print('❌ Auto-download error: $e');
     }
   }
 
+  /// Resume interrupted downloads and fetch the images missed while offline
+  Future<void> _catchUp() async {
+    try {
+      final downloads = [
+        ...await _downloadScheduler.resumeInterrupted(),
+        ...await _catchUpService.catchUp(),
+      ];
+      downloads.forEach(_trackDownload);
+    } catch (e) {
+      print('❌ Error catching up on downloads: $e');
+    }
+  }
+
+  /// Mirror a download's progress in the state
+  void _trackDownload(Stream<DownloadResult> downloads) {
+    downloads.listen((result) async {
+      if (result.status == DownloadStatus.started ||
+          result.status == DownloadStatus.downloading) {
+        state = state.copyWith(downloadStatus: 'Downloading new image ...');
+      } else if (result.status == DownloadStatus.saving) {
+        state = state.copyWith(downloadStatus: 'Saving image to gallery ...');
+      } else if (result.status == DownloadStatus.completed) {
+        final lastDownload = await _downloadHistory.latest();
+        state = state.copyWith(
+          downloadStatus: 'Image saved to gallery',
+          lastDownloadTime: lastDownload?.finishedAtFormatted,
+          lastDownloadFilename: lastDownload?.filename,
+        );
+      } else if (result.status == DownloadStatus.failed && result.resumable) {
+        state = state.copyWith(
+          downloadStatus: 'Download interrupted, will resume',
+        );
+      } else if (result.status == DownloadStatus.failed) {
+        state = state.copyWith(
+          downloadStatus: 'Failed to save image to gallery',
+        );
+      } else {
+        state = state.copyWith(
+          downloadStatus: 'There is no new image to download',
+        );
+      }
+    });
+  }
+
   @override
   void dispose() {
+    _queueSubscription?.cancel();
+    _progressSubscription?.cancel();
     // _networkSubscription?.cancel();
     // _socketSubscription?.cancel();
     // _networkService.stopNetworkMonitoring();
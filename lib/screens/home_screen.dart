@@ -1,5 +1,7 @@
 import 'package:flutter/material.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/download_progress.dart';
+import '../models/download_queue_state.dart';
 import '../presentation/providers/network_provider.dart';
 
 /// Main home screen that displays network status and download progress
@@ -79,7 +81,11 @@ class _MainContent extends StatelessWidget {
         const SizedBox(height: 40),
 
         // Download status card
-        _DownloadStatusCard(downloadStatus: networkStatus.downloadStatus),
+        _DownloadStatusCard(
+          downloadStatus: networkStatus.downloadStatus,
+          downloadQueue: networkStatus.downloadQueue,
+          downloadProgress: networkStatus.downloadProgress,
+        ),
 
         const SizedBox(height: 24),
 
@@ -164,8 +170,14 @@ class _ConnectionStatusSection extends StatelessWidget {
 /// Download status card with consistent Material Design styling
 class _DownloadStatusCard extends StatelessWidget {
   final String downloadStatus;
+  final DownloadQueueState downloadQueue;
+  final DownloadProgress downloadProgress;
 
-  const _DownloadStatusCard({required this.downloadStatus});
+  const _DownloadStatusCard({
+    required this.downloadStatus,
+    required this.downloadQueue,
+    required this.downloadProgress,
+  });
 
   @override
   Widget build(BuildContext context) {
@@ -198,12 +210,56 @@ class _DownloadStatusCard extends StatelessWidget {
               ),
               textAlign: TextAlign.center,
             ),
+
+            // Bytes, rate and time left across all running downloads
+            if (!downloadProgress.isIdle) ...[
+              const SizedBox(height: 12),
+              LinearProgressIndicator(value: downloadProgress.fraction),
+              const SizedBox(height: 8),
+              Text(
+                _getProgressText(),
+                style: theme.textTheme.bodySmall?.copyWith(
+                  color: Colors.grey.shade600,
+                ),
+              ),
+            ],
+
+            // Queue depth while a burst is being worked off
+            if (!downloadQueue.isIdle) ...[
+              const SizedBox(height: 8),
+              Text(
+                '${downloadQueue.active} active, ${downloadQueue.queued} queued',
+                style: theme.textTheme.bodySmall?.copyWith(
+                  color: Colors.grey.shade600,
+                ),
+              ),
+            ],
           ],
         ),
       ),
     );
   }
 
+  String _getProgressText() {
+    final total = downloadProgress.total;
+    final parts = [
+      total >= 0
+          ? '${_formatBytes(downloadProgress.bytes)} of ${_formatBytes(total)}'
+          : _formatBytes(downloadProgress.bytes),
+      '${_formatBytes(downloadProgress.bytesPerSecond.round())}/s',
+    ];
+    final eta = downloadProgress.eta;
+    if (eta != null) parts.add('${eta.inSeconds + 1} s left');
+    return parts.join(' · ');
+  }
+
+  String _formatBytes(int bytes) {
+    const mib = 1024 * 1024;
+    if (bytes >= mib) return '${(bytes / mib).toStringAsFixed(1)} MB';
+    if (bytes >= 1024) return '${(bytes / 1024).toStringAsFixed(0)} KB';
+    return '$bytes B';
+  }
+
   String _getDisplayStatus() {
     return downloadStatus.isNotEmpty
         ? downloadStatus
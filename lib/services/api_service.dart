@@ -1,5 +1,6 @@
 import 'package:dio/dio.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/image_manifest.dart';
 import '../models/image_model.dart';
 
 final dioProvider = Provider((ref) {
@@ -14,6 +15,10 @@ class ApiService {
   final Dio _dio;
   ApiService(this._dio);
 
+  /// Endpoint that streams many images as one tar (or tar.zst) archive
+  /// POST `{"filenames": [...]}`; see the README.
+  String get archiveUrl => '${_dio.options.baseUrl}/images/archive';
+
   /// Get latest image info from server
   Future<ImageModel?> getLatestImage() async {
     try {
@@ -36,4 +41,30 @@ class ApiService {
       return null;
     }
   }
+
+  /// Get the images uploaded after [cursor], oldest first, [limit] at most
+  /// Without a cursor the manifest starts at the oldest image. Returns null
+  /// on errors, including backends without the manifest endpoint.
+  Future<ImageManifestPage?> getImagesSince(
+    String? cursor, {
+    int limit = 100,
+  }) async {
+    try {
+      final response = await _dio.get(
+        '/images',
+        queryParameters: {if (cursor != null) 'since': cursor, 'limit': limit},
+      );
+
+      if (response.statusCode == 200 && response.data is Map) {
+        return ImageManifestPage.fromJson(
+          Map<String, dynamic>.from(response.data as Map),
+        );
+      }
+      print('❌ Failed to get image manifest: ${response.statusCode}');
+      return null;
+    } catch (e) {
+      print('❌ API Error: $e');
+      return null;
+    }
+  }
 }
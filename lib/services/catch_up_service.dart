@@ -0,0 +1,124 @@
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../core/utils/sp_manager.dart';
+import '../models/image_model.dart';
+import 'api_service.dart';
+import 'download_history.dart';
+import 'download_scheduler.dart';
+import 'download_service.dart';
+import 'storage_service.dart';
+
+final catchUpServiceProvider = Provider(
+  (ref) => CatchUpService(
+    ref.read(apiProvider),
+    ref.read(downloadSchedulerProvider),
+    ref.read(storageServiceProvider),
+    ref.read(downloadHistoryProvider),
+  ),
+);
+
+/// Recovers images announced while the app was offline
+///
+/// `new-image` socket events sent while the link or the socket was down are
+/// lost. On reconnect, [catchUp] reads the backend's manifest from the last
+/// position caught up to (a cursor kept in SharedPreferences), one page of
+/// [pageSize] per request, drops the images already saved or queued, and
+/// hands the rest to the [DownloadScheduler] as one batch. N missed images
+/// cost ceil(N / [pageSize]) + 1 requests at most.
+class CatchUpService {
+  /// Images per manifest request
+  static const int pageSize = 100;
+
+  /// Upper bound on pages per catch-up; the next run carries on from there
+  static const int _maxPages = 50;
+
+  final ApiService _api;
+  final DownloadScheduler _scheduler;
+  final StorageService _storage;
+  final DownloadHistory _history;
+
+  bool _running = false;
+
+  CatchUpService(this._api, this._scheduler, this._storage, this._history);
+
+  /// Queue the images uploaded since the last catch-up
+  /// The first run only records where the manifest ends: earlier uploads
+  /// predate the app and were never meant to be downloaded. Returns the
+  /// result streams of the downloads queued; empty if nothing was missed,
+  /// the backend has no manifest, or a run is already in progress.
+  Future<List<Stream<DownloadResult>>> catchUp() async {
+    if (_running) return [];
+    _running = true;
+    try {
+      final start = await SPManager.getSyncCursor();
+      var cursor = start;
+      var reachedEnd = false;
+      final missed = <ImageModel>[];
+
+      // The first run has no images to collect, only the end to find, so
+      // it isn't capped: stopping early would save a cursor mid-manifest
+      for (var page = 0; start == null || page < _maxPages; page++) {
+        final manifest = await _api.getImagesSince(cursor, limit: pageSize);
+        if (manifest == null) break;
+        if (start != null) missed.addAll(manifest.images);
+        final next = manifest.nextCursor;
+        if (next == null || next == cursor) {
+          reachedEnd = !manifest.hasMore;
+          break;
+        }
+        cursor = next;
+        if (!manifest.hasMore) {
+          reachedEnd = true;
+          break;
+        }
+      }
+
+      if (cursor == null || cursor == start) return [];
+      if (start == null && !reachedEnd) {
+        print(
+          '⚠️ Catch-up: manifest unreadable to its end, retrying next time',
+        );
+        return [];
+      }
+
+      final downloads = await _missing(missed);
+      final results = _scheduler.enqueueAll(downloads);
+      // Advanced once the batch is queued; downloads that are interrupted
+      // from here on, or that the full queue defers, are resumed by the
+      // scheduler
+      await SPManager.setSyncCursor(cursor);
+
+      if (start == null) {
+        print('📍 Catch-up sync starts from here');
+      } else {
+        print(
+          '🔁 Catch-up: ${missed.length} image(s) since last sync, '
+          '${results.length} to download',
+        );
+      }
+      return results;
+    } catch (e) {
+      print('❌ Catch-up sync error: $e');
+      return [];
+    } finally {
+      _running = false;
+    }
+  }
+
+  /// The images in [images] that are neither saved nor queued yet, once each
+  Future<List<ImageModel>> _missing(List<ImageModel> images) async {
+    final seen = <String>{};
+    final lastFilename = (await _history.latest())?.filename;
+    final missing = <ImageModel>[];
+    for (final image in images) {
+      if (image.url.isEmpty || !seen.add(image.url)) continue;
+      if (image.filename == lastFilename) continue;
+      if (_scheduler.isQueuedOrActive(image.url)) continue;
+      final size = image.size > 0 ? image.size : null;
+      if (await _storage.hasImage(image.filename, size: size) == true) {
+        continue;
+      }
+      missing.add(image);
+    }
+    return missing;
+  }
+}
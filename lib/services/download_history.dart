@@ -0,0 +1,135 @@
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../core/utils/sp_manager.dart';
+import '../models/download_record.dart';
+
+final downloadHistoryProvider = Provider((ref) => DownloadHistory());
+
+/// Record of every completed download
+/// (linux/runner/download_history_linux.h)
+///
+/// On Linux each download is appended to a native journal that is
+/// memory-mapped and flushed to disk in groups, so recording one costs a
+/// copy rather than a SharedPreferences rewrite, and the whole history can
+/// be queried: [last], [since] and [stats]. Elsewhere only the latest
+/// download is kept, in SharedPreferences, and the queries come back empty.
+class DownloadHistory {
+  static const MethodChannel _channel = MethodChannel('download_history');
+
+  /// Note a completed download of [filename]
+  /// [size] is the saved file's size, [bytes] what was transferred for it
+  /// (less than [size] after a resume); [duration] is the transfer time
+  /// from [startedAt]. The link type is filled in natively.
+  Future<void> record(
+    String filename, {
+    int size = 0,
+    int? bytes,
+    String? hash,
+    DateTime? startedAt,
+    Duration duration = Duration.zero,
+  }) async {
+    final finishedAt = DateTime.now();
+    if (Platform.isLinux) {
+      try {
+        final bool recorded = await _channel.invokeMethod('record', {
+          'filename': filename,
+          'size': size,
+          'bytes': bytes ?? size,
+          if (hash != null) 'hash': hash,
+          'startedAt': (startedAt ?? finishedAt.subtract(duration))
+              .millisecondsSinceEpoch,
+          'finishedAt': finishedAt.millisecondsSinceEpoch,
+          'durationMs': duration.inMilliseconds,
+        });
+        if (recorded) return;
+      } on MissingPluginException {
+        // Older runner without the history journal
+      } on PlatformException catch (e) {
+        print("Failed to record download history: '${e.message}'");
+      }
+    }
+
+    try {
+      await SPManager.setLastDownloadDateTime(finishedAt);
+      await SPManager.setLastDownloadFilename(filename);
+    } catch (e) {
+      print('❌ Error saving last download info: $e');
+    }
+  }
+
+  /// The most recent download, or null if there was none
+  /// Falls back to SharedPreferences, which then only knows the filename
+  /// and time.
+  Future<DownloadRecord?> latest() async {
+    final records = await last(1);
+    if (records.isNotEmpty) return records.first;
+
+    final filename = await SPManager.getLastDownloadFilename();
+    final finishedAt = await SPManager.getLastDownloadDateTime();
+    if (filename == null || finishedAt == null) return null;
+    return DownloadRecord(
+      filename: filename,
+      size: 0,
+      bytes: 0,
+      startedAt: finishedAt,
+      finishedAt: finishedAt,
+      duration: Duration.zero,
+      linkType: 'none',
+    );
+  }
+
+  /// The newest [count] downloads, newest first (Linux)
+  Future<List<DownloadRecord>> last(int count) async {
+    return _query('last', {'count': count});
+  }
+
+  /// Downloads finished at or after [time], newest first, at most [limit]
+  /// (Linux)
+  Future<List<DownloadRecord>> since(DateTime time, {int limit = 1000}) async {
+    return _query('since', {
+      'since': time.millisecondsSinceEpoch,
+      'limit': limit,
+    });
+  }
+
+  /// Totals over the downloads finished at or after [since], or over all of
+  /// them (Linux; empty elsewhere)
+  Future<DownloadStats> stats({DateTime? since}) async {
+    if (!Platform.isLinux) return DownloadStats.empty;
+    try {
+      final Map<dynamic, dynamic> result = await _channel.invokeMethod(
+        'stats',
+        {if (since != null) 'since': since.millisecondsSinceEpoch},
+      );
+      return DownloadStats.fromMap(result);
+    } on MissingPluginException {
+      return DownloadStats.empty;
+    } on PlatformException catch (e) {
+      print("Failed to query download history: '${e.message}'");
+      return DownloadStats.empty;
+    }
+  }
+
+  Future<List<DownloadRecord>> _query(
+    String method,
+    Map<String, dynamic> arguments,
+  ) async {
+    if (!Platform.isLinux) return [];
+    try {
+      final List<dynamic> result = await _channel.invokeMethod(
+        method,
+        arguments,
+      );
+      return result
+          .map((record) => DownloadRecord.fromMap(record as Map))
+          .toList();
+    } on MissingPluginException {
+      return [];
+    } on PlatformException catch (e) {
+      print("Failed to query download history: '${e.message}'");
+      return [];
+    }
+  }
+}
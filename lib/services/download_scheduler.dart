@@ -0,0 +1,495 @@
+import 'dart:async';
+import 'dart:convert';
+
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../core/utils/sp_manager.dart';
+import '../models/download_queue_state.dart';
+import '../models/image_model.dart';
+import 'api_service.dart';
+import 'download_service.dart';
+import 'transfer_controller.dart';
+
+final downloadSchedulerProvider = Provider((ref) {
+  final transfers = ref.read(transferControllerProvider);
+  final scheduler = DownloadScheduler(
+    ref.read(downloadManagerProvider),
+    maxConcurrent: transfers.limits.transfers,
+    maxPerHost: transfers.limits.transfers,
+    archiveUrl: ref.read(apiProvider).archiveUrl,
+  );
+  // The controller ramps concurrency up and down with the link. Images
+  // mostly come from one server, so the per-host cap follows it too rather
+  // than clipping the ramp
+  final subscription = transfers.limitChanges.listen(
+    (limits) => scheduler
+      ..maxPerHost = limits.transfers
+      ..maxConcurrent = limits.transfers,
+  );
+  ref.onDispose(() {
+    subscription.cancel();
+    scheduler.dispose();
+  });
+  return scheduler;
+});
+
+/// Which queued download runs next
+enum DownloadOrder {
+  /// Most recently announced image first
+  newestFirst,
+
+  /// Smallest image first (by the size the server announced)
+  smallestFirst,
+}
+
+class _PendingDownload {
+  final ImageModel image;
+  final String host;
+  final int sequence;
+  final StreamController<DownloadResult> results;
+
+  /// Remember the image with the interrupted downloads if the full queue
+  /// drops it, rather than losing it
+  final bool deferIfDropped;
+
+  _PendingDownload(
+    this.image,
+    this.host,
+    this.sequence, {
+    this.deferIfDropped = false,
+  }) : results = StreamController<DownloadResult>();
+}
+
+/// Runs downloads through [DownloadManager] with bounded concurrency
+///
+/// A burst of `new-image` events no longer starts one transfer (and one
+/// gallery save) per event: at most [maxConcurrent] downloads run at once,
+/// at most [maxPerHost] against the same server, and the rest wait in a
+/// queue ordered by [order]. When more than [maxQueued] are waiting, the
+/// lowest-priority one is dropped. [queueChanges] reports the queue depth.
+///
+/// Downloads that fail part way but can be resumed, or that were refused
+/// because the disk is too full, are remembered, across restarts, until
+/// [resumeInterrupted] queues them again. So are images from [enqueueAll]
+/// that the full queue drops.
+///
+/// Batches of [archiveThreshold] images or more from [enqueueAll] are
+/// fetched as archives of up to [archiveBatchSize] from [archiveUrl] where
+/// the manager supports it, one request and one slot per archive instead of
+/// one per image. Images the archive didn't deliver are queued again singly.
+class DownloadScheduler {
+  final DownloadManager _manager;
+
+  int _maxConcurrent;
+  int maxPerHost;
+  int maxQueued;
+  DownloadOrder order;
+
+  /// Bulk download endpoint; null downloads every image on its own
+  final String? archiveUrl;
+  int archiveThreshold;
+  int archiveBatchSize;
+
+  final List<_PendingDownload> _pending = [];
+
+  /// Archive batches waiting for a slot, oldest first
+  final List<List<_PendingDownload>> _batches = [];
+
+  /// URLs in [_pending] and [_batches], with how often each is waiting
+  /// ([enqueue] doesn't skip duplicates)
+  final Map<String, int> _queuedUrls = {};
+  final Map<String, int> _activePerHost = {};
+  final Set<String> _activeUrls = {};
+
+  /// Resumable or deferred downloads by URL, mirrored in SharedPreferences
+  final Map<String, ImageModel> _interrupted = {};
+  Future<void>? _interruptedLoaded;
+  Future<void>? _interruptedSave;
+  int _active = 0;
+  int _dropped = 0;
+  int _sequence = 0;
+
+  final StreamController<DownloadQueueState> _queueController =
+      StreamController<DownloadQueueState>.broadcast();
+  DownloadQueueState _queueState = DownloadQueueState.idle;
+
+  DownloadScheduler(
+    this._manager, {
+    int maxConcurrent = 4,
+    this.maxPerHost = 8,
+    this.maxQueued = 1000,
+    this.order = DownloadOrder.newestFirst,
+    this.archiveUrl,
+    this.archiveThreshold = 16,
+    this.archiveBatchSize = 200,
+  }) : _maxConcurrent = maxConcurrent;
+
+  /// Downloads allowed to run at the same time
+  int get maxConcurrent => _maxConcurrent;
+
+  /// Raising the limit starts waiting downloads right away; lowering it lets
+  /// running ones finish
+  set maxConcurrent(int value) {
+    _maxConcurrent = value < 1 ? 1 : value;
+    _pump();
+  }
+
+  /// Current queue depth
+  DownloadQueueState get queueState => _queueState;
+
+  /// Queue depth on every change
+  Stream<DownloadQueueState> get queueChanges => _queueController.stream;
+
+  /// Queue [image] for download
+  /// The returned stream carries the same events as
+  /// [DownloadManager.downloadImageToGallery] once the download starts.
+  Stream<DownloadResult> enqueue(ImageModel image) {
+    final results = _add(image);
+    _pump();
+    return results;
+  }
+
+  /// Queue [images] as one batch, oldest first
+  /// Images already queued or downloading are skipped, and the queue state
+  /// is published once for the whole batch. Images the queue has no room
+  /// for are deferred to [resumeInterrupted] rather than lost. Returns the
+  /// result streams of the downloads queued.
+  List<Stream<DownloadResult>> enqueueAll(List<ImageModel> images) {
+    final fresh = <ImageModel>[];
+    final seen = <String>{};
+    for (final image in images) {
+      if (isQueuedOrActive(image.url) || !seen.add(image.url)) continue;
+      fresh.add(image);
+    }
+
+    final streams = <Stream<DownloadResult>>[];
+    var start = 0;
+    if (archiveUrl != null && _manager.supportsArchives) {
+      while (fresh.length - start >= archiveThreshold) {
+        final end = start + archiveBatchSize < fresh.length
+            ? start + archiveBatchSize
+            : fresh.length;
+        final batch = [
+          for (final image in fresh.sublist(start, end))
+            _PendingDownload(
+              image,
+              Uri.tryParse(image.url)?.host ?? '',
+              _sequence++,
+              // What the archive leaves is queued singly, and may not fit
+              deferIfDropped: true,
+            ),
+        ];
+        _batches.add(batch);
+        batch.forEach(_markQueued);
+        streams.addAll(batch.map((pending) => pending.results.stream));
+        start = end;
+      }
+    }
+    for (final image in fresh.skip(start)) {
+      streams.add(_add(image, deferIfDropped: true));
+    }
+    _pump();
+    return streams;
+  }
+
+  /// Whether a download of [url] is waiting or running
+  bool isQueuedOrActive(String url) {
+    return _activeUrls.contains(url) || _queuedUrls.containsKey(url);
+  }
+
+  void _markQueued(_PendingDownload pending) {
+    final url = pending.image.url;
+    _queuedUrls[url] = (_queuedUrls[url] ?? 0) + 1;
+  }
+
+  void _unmarkQueued(_PendingDownload pending) {
+    final url = pending.image.url;
+    final remaining = (_queuedUrls[url] ?? 1) - 1;
+    if (remaining > 0) {
+      _queuedUrls[url] = remaining;
+    } else {
+      _queuedUrls.remove(url);
+    }
+  }
+
+  Stream<DownloadResult> _add(
+    ImageModel image, {
+    bool deferIfDropped = false,
+  }) {
+    final pending = _PendingDownload(
+      image,
+      Uri.tryParse(image.url)?.host ?? '',
+      _sequence++,
+      deferIfDropped: deferIfDropped,
+    );
+    _queue(pending);
+    return pending.results.stream;
+  }
+
+  void _queue(_PendingDownload pending) {
+    _pending.add(pending);
+    _markQueued(pending);
+
+    if (_pending.length > maxQueued) {
+      _drop(_lowestPriority());
+    }
+  }
+
+  /// Queue the downloads that were interrupted, to continue them
+  /// Call when the link comes back. Downloads already queued or running are
+  /// skipped. Returns the result streams of the downloads queued.
+  Future<List<Stream<DownloadResult>>> resumeInterrupted() async {
+    await _loadInterrupted();
+    final images = _interrupted.values
+        .where((image) => !isQueuedOrActive(image.url))
+        .toList();
+    if (images.isEmpty) return [];
+    print('▶️ Resuming ${images.length} interrupted download(s)');
+    return enqueueAll(images);
+  }
+
+  Future<void> _loadInterrupted() {
+    return _interruptedLoaded ??= () async {
+      for (final encoded in await SPManager.getInterruptedDownloads()) {
+        try {
+          final image = ImageModel.fromSavedJson(
+            jsonDecode(encoded) as Map<String, dynamic>,
+          );
+          if (image.url.isNotEmpty) {
+            _interrupted.putIfAbsent(image.url, () => image);
+          }
+        } catch (e) {
+          print('⚠️ Skipping unreadable interrupted download: $e');
+        }
+      }
+    }();
+  }
+
+  /// Remember [image] while its download can be resumed or waits for space
+  Future<void> _trackInterrupted(
+    ImageModel image,
+    DownloadResult result,
+  ) async {
+    if (result.result == null) return; // still running
+    await _loadInterrupted();
+    final bool changed;
+    if (result.status == DownloadStatus.failed &&
+        (result.resumable || result.insufficientSpace)) {
+      if (result.insufficientSpace) {
+        print('💾 Deferring ${image.filename} until there is space for it');
+      }
+      changed = !_interrupted.containsKey(image.url);
+      _interrupted[image.url] = image;
+    } else {
+      changed = _interrupted.remove(image.url) != null;
+    }
+    if (changed) await _saveInterrupted();
+  }
+
+  /// Write [_interrupted] to SharedPreferences
+  /// Calls made in the same turn of the event loop share one write, so a
+  /// batch that overflows the queue isn't saved once per image.
+  Future<void> _saveInterrupted() {
+    return _interruptedSave ??= Future(() async {
+      await _loadInterrupted();
+      _interruptedSave = null;
+      await SPManager.setInterruptedDownloads([
+        for (final saved in _interrupted.values) jsonEncode(saved.toJson()),
+      ]);
+    });
+  }
+
+  void _pump() {
+    while (_active < _maxConcurrent) {
+      final next = _takeNext();
+      if (next != null) {
+        _start(next);
+      } else if (_batches.isNotEmpty) {
+        _startBatch(_batches.removeAt(0));
+      } else {
+        break;
+      }
+    }
+    _publishQueueState();
+  }
+
+  /// Highest-priority waiting download whose host has a free slot
+  /// A linear scan: the queue is short-lived and the per-host check would
+  /// have to skip over heap entries anyway.
+  _PendingDownload? _takeNext() {
+    int best = -1;
+    for (var i = 0; i < _pending.length; i++) {
+      final candidate = _pending[i];
+      if ((_activePerHost[candidate.host] ?? 0) >= maxPerHost) continue;
+      if (best < 0 || _runsBefore(candidate, _pending[best])) best = i;
+    }
+    if (best < 0) return null;
+    final next = _pending.removeAt(best);
+    _unmarkQueued(next);
+    return next;
+  }
+
+  _PendingDownload _lowestPriority() {
+    var lowest = _pending.first;
+    for (final candidate in _pending) {
+      if (_runsBefore(lowest, candidate)) lowest = candidate;
+    }
+    return lowest;
+  }
+
+  bool _runsBefore(_PendingDownload a, _PendingDownload b) {
+    if (order == DownloadOrder.smallestFirst) {
+      // Unknown sizes (0) go last
+      final sizeA = a.image.size > 0 ? a.image.size : 1 << 62;
+      final sizeB = b.image.size > 0 ? b.image.size : 1 << 62;
+      if (sizeA != sizeB) return sizeA < sizeB;
+    }
+    return a.sequence > b.sequence;
+  }
+
+  void _drop(_PendingDownload pending) {
+    _pending.remove(pending);
+    _unmarkQueued(pending);
+    final String message;
+    if (pending.deferIfDropped) {
+      // Picked up by the next resumeInterrupted()
+      _interrupted[pending.image.url] = pending.image;
+      _saveInterrupted();
+      message = 'Deferred: download queue full';
+    } else {
+      _dropped++;
+      print('⚠️ Download queue full, dropping ${pending.image.filename}');
+      message = 'Dropped: download queue full';
+    }
+    pending.results
+      ..add(
+        DownloadResult(
+          status: DownloadStatus.failed,
+          message: message,
+          result: false,
+        ),
+      )
+      ..close();
+  }
+
+  void _start(_PendingDownload pending) {
+    _active++;
+    _activePerHost[pending.host] = (_activePerHost[pending.host] ?? 0) + 1;
+    _activeUrls.add(pending.image.url);
+
+    _manager
+        .downloadImageToGallery(
+          pending.image.url,
+          checksum: pending.image.checksum,
+          size: pending.image.size,
+        )
+        .listen(
+          (result) {
+            _trackInterrupted(pending.image, result);
+            pending.results.add(result);
+          },
+          onError: pending.results.addError,
+          onDone: () {
+            _active--;
+            _activeUrls.remove(pending.image.url);
+            final remaining = (_activePerHost[pending.host] ?? 1) - 1;
+            if (remaining > 0) {
+              _activePerHost[pending.host] = remaining;
+            } else {
+              _activePerHost.remove(pending.host);
+            }
+            pending.results.close();
+            _pump();
+          },
+        );
+  }
+
+  /// Run [batch] as one archive download
+  /// Events about an image go to its stream, which closes once it has an
+  /// outcome. Batch-wide progress goes to the first image still waiting.
+  void _startBatch(List<_PendingDownload> batch) {
+    _active++;
+    batch.forEach(_unmarkQueued);
+    final waiting = {for (final pending in batch) pending.image.url: pending};
+    DownloadResult? noSpace;
+    _activeUrls.addAll(waiting.keys);
+    print('📦 Downloading ${batch.length} images as one archive');
+
+    _manager
+        .downloadArchiveToGallery(archiveUrl!, [
+          for (final pending in batch) pending.image,
+        ])
+        .listen(
+          (result) {
+            final url = result.url;
+            if (url == null) {
+              if (result.insufficientSpace) noSpace = result;
+              // A failed batch leaves its images waiting; queued again below
+              if (result.result == null && waiting.isNotEmpty) {
+                waiting.values.first.results.add(result);
+              }
+              return;
+            }
+            final pending = waiting[url];
+            if (pending == null) return;
+            pending.results.add(result);
+            if (result.result == null) return;
+            _trackInterrupted(pending.image, result);
+            waiting.remove(url);
+            _activeUrls.remove(url);
+            pending.results.close();
+          },
+          onError: (Object e) => print('❌ Archive download error: $e'),
+          onDone: () {
+            _active--;
+            _activeUrls.removeAll(waiting.keys);
+            final refused = noSpace;
+            if (refused != null) {
+              // One by one they would be refused too; wait for space instead
+              for (final pending in waiting.values) {
+                _trackInterrupted(pending.image, refused);
+                pending.results
+                  ..add(refused)
+                  ..close();
+              }
+            } else if (waiting.isNotEmpty) {
+              print(
+                '⚠️ Archive left ${waiting.length} image(s), '
+                'downloading them one by one',
+              );
+              waiting.values.forEach(_queue);
+            }
+            _pump();
+          },
+        );
+  }
+
+  void _publishQueueState() {
+    final queueState = DownloadQueueState(
+      queued:
+          _pending.length +
+          _batches.fold(0, (count, batch) => count + batch.length),
+      active: _active,
+      dropped: _dropped,
+    );
+    if (queueState == _queueState) return;
+    _queueState = queueState;
+    if (!_queueController.isClosed) _queueController.add(queueState);
+  }
+
+  /// Dispose resources
+  /// Waiting downloads are abandoned; running ones finish in the background
+  void dispose() {
+    for (final pending in _pending) {
+      pending.results.close();
+    }
+    _pending.clear();
+    for (final batch in _batches) {
+      for (final pending in batch) {
+        pending.results.close();
+      }
+    }
+    _batches.clear();
+    _queuedUrls.clear();
+    _queueController.close();
+  }
+}
@@ -1,3 +1,4 @@
+import 'dart:convert';
 import 'dart:io';
 import 'package:dio/dio.dart';
 import 'package:flutter/foundation.dart';
@@ -6,13 +7,91 @@ import 'package:gal/gal.dart';
 import 'package:path_provider/path_provider.dart';
 import 'package:path/path.dart' as path;
 import '../core/utils/sp_manager.dart';
+import '../models/image_model.dart';
+import '../models/native_download_result.dart';
+import '../models/storage_layout.dart';
+import 'download_history.dart';
+import 'folder_view.dart';
+import 'native_download_engine.dart';
+import 'progress_tracker.dart';
+import 'storage_service.dart';
+import 'transfer_controller.dart';
 
 final downloadAgentProvider = Provider((ref) => Dio());
 
 final downloadManagerProvider = Provider(
-  (ref) => DownloadManager(ref.read(downloadAgentProvider)),
+  (ref) => DownloadManager(
+    ref.read(downloadAgentProvider),
+    ref.read(nativeDownloadEngineProvider),
+    ref.read(storageServiceProvider),
+    ref.read(transferControllerProvider),
+    ref.read(progressTrackerProvider),
+    ref.read(folderViewProvider),
+    ref.read(downloadHistoryProvider),
+  ),
 );
 
+/// When a download started, how long its transfer took and the bytes moved
+typedef _Transfer = ({DateTime startedAt, Duration duration, int bytes});
+
+/// Outcome of a download attempt, see [DownloadManager._fetch]
+class _FetchResult {
+  /// Failure reason, null on success
+  final String? error;
+
+  /// Content hash, if one was computed
+  final String? hash;
+
+  /// Bytes received by this attempt
+  final int bytes;
+
+  /// The failure came from the connection itself (timeout, reset,
+  /// truncated body) and says something about the link
+  final bool linkFailure;
+
+  /// Failed, but the partial file was kept for a later attempt
+  final bool resumable;
+
+  /// Failed for lack of disk space
+  final bool insufficientSpace;
+
+  /// When the attempt started and how long it took, set by [_fetch]
+  final DateTime? startedAt;
+  final Duration duration;
+
+  const _FetchResult({
+    this.error,
+    this.hash,
+    this.bytes = 0,
+    this.linkFailure = false,
+    this.resumable = false,
+    this.insufficientSpace = false,
+    this.startedAt,
+    this.duration = Duration.zero,
+  });
+
+  bool get success => error == null;
+
+  _Transfer get transfer => (
+    startedAt: startedAt ?? DateTime.now().subtract(duration),
+    duration: duration,
+    bytes: bytes,
+  );
+
+  _FetchResult timed(DateTime startedAt, Duration duration) {
+    return _FetchResult(
+      error: error,
+      hash: hash,
+      bytes: bytes,
+      linkFailure: linkFailure,
+      resumable: resumable,
+      insufficientSpace: insufficientSpace,
+      startedAt: startedAt,
+      duration: duration,
+    );
+  }
+}
+
 enum DownloadStatus {
   started,
   downloading,
@@ -26,17 +105,66 @@ class DownloadResult {
   final DownloadStatus status;
   final String? message;
   final bool? result; // true/false for completed/failed, null otherwise
-
-  DownloadResult({required this.status, this.message, this.result});
+  final String? hash; // content XXH64 for completed (Linux), null otherwise
+  final bool resumable; // failed, but the partial file was kept (Linux)
+  final String? url; // image an archive event is about, null for the batch
+  final bool insufficientSpace; // failed for lack of disk space (Linux)
+
+  DownloadResult({
+    required this.status,
+    this.message,
+    this.result,
+    this.hash,
+    this.resumable = false,
+    this.url,
+    this.insufficientSpace = false,
+  });
 }
 
 class DownloadManager {
-  final Dio _dio;
-
-  DownloadManager(this._dio);
+  /// Free space a download must leave on the image folder's disk unless
+  /// [SPManager.setMinFreeSpace] says otherwise
+  static const int defaultMinFreeSpace = 512 * 1024 * 1024;
 
-  /// Download and save to gallery as a stream of status events (no progress)
-  Stream<DownloadResult> downloadImageToGallery(String imageUrl) async* {
+  final Dio _dio;
+  final NativeDownloadEngine? _engine;
+  final StorageService _storage;
+  final TransferController? _transfers;
+  final ProgressTracker? _progress;
+  final FolderView? _folder;
+  final DownloadHistory _history;
+
+  /// Molethewall folder, resolved on first use (Linux & macOS)
+  Directory? _desktopFolder;
+
+  /// Shard directories known to exist, relative to the molethewall folder
+  final Set<String> _shards = {};
+  Future<void>? _layoutApplied;
+
+  DownloadManager(
+    this._dio, [
+    this._engine,
+    StorageService? storage,
+    this._transfers,
+    this._progress,
+    this._folder,
+    DownloadHistory? history,
+  ]) : _storage = storage ?? StorageService(),
+       _history = history ?? DownloadHistory();
+
+  /// Download and save to gallery as a stream of status events
+  /// Byte-level progress goes to the [ProgressTracker], sampled, rather than
+  /// into this stream.
+  /// [checksum] is the server-provided XXH64; a mismatch fails the download
+  /// [size] is the server-announced size (0 if unknown); on Linux the
+  /// download is refused up front if it would leave less than the free-space
+  /// floor, and fails with [DownloadResult.insufficientSpace] set
+  Stream<DownloadResult> downloadImageToGallery(
+    String imageUrl, {
+    String? checksum,
+    int size = 0,
+  }) async* {
+    File? downloadFile;
     try {
       yield DownloadResult(
         status: DownloadStatus.started,
@@ -57,17 +185,31 @@ class DownloadManager {
         return;
       }
 
-      // Create temp file with original name
-      final tempDir = await getTemporaryDirectory();
-      final tempFile = File('${tempDir.path}/$originalFilename');
+      // Desktop downloads go straight into the destination folder and are
+      // renamed into place; elsewhere the temp dir stages them for gal
+      downloadFile = await _getDownloadFile(originalFilename);
+
+      yield DownloadResult(
+        status: DownloadStatus.downloading,
+        message: 'Downloading: $originalFilename',
+      );
 
       // Download the image
-      final response = await _dio.download(imageUrl, tempFile.path);
-      if (response.statusCode != 200) {
+      final fetched = await _fetch(
+        imageUrl,
+        downloadFile.path,
+        checksum: checksum,
+        size: size,
+      );
+      if (!fetched.success) {
+        // A resumable partial file stays for the next attempt to continue
+        if (!fetched.resumable) await _deleteQuietly(downloadFile);
         yield DownloadResult(
           status: DownloadStatus.failed,
-          message: 'Download failed: ${response.statusCode}',
+          message: 'Download failed: ${fetched.error}',
           result: false,
+          resumable: fetched.resumable,
+          insufficientSpace: fetched.insufficientSpace,
         );
         return;
       }
@@ -77,21 +219,179 @@ class DownloadManager {
         message: _getSavingMessage(),
       );
 
-      // Save image based on platform
-      final savedPath = await _saveImageToPlatformStorage(
-        tempFile,
+      yield await _saveDownloaded(
+        downloadFile,
         originalFilename,
+        fetched.hash,
+        fetched.transfer,
       );
+    } catch (e) {
+      if (downloadFile != null) await _deleteQuietly(downloadFile);
+      yield DownloadResult(
+        status: DownloadStatus.failed,
+        message: 'Error: $e',
+        result: false,
+      );
+    }
+  }
 
-      // Save last download info to SharedPreferences
-      await _saveLastDownloadInfo(originalFilename);
+  /// Whether [downloadArchiveToGallery] can run on this platform
+  bool get supportsArchives => _engine?.isAvailable == true;
+
+  /// Download [images] as one archive from [archiveUrl] and save each one
+  /// The backend streams a tar (or tar.zst) of the requested files, which
+  /// the native engine unpacks straight into the molethewall folder; each
+  /// file then goes through the same checksum, dedup and placement steps as
+  /// a single download. Events about one image carry its [DownloadResult.url]
+  /// and end with a completed, duplicate or failed event for it. Events
+  /// without a url are about the batch; a failed one means the images
+  /// without an outcome yet were not saved. Linux only, see
+  /// [supportsArchives].
+  Stream<DownloadResult> downloadArchiveToGallery(
+    String archiveUrl,
+    List<ImageModel> images,
+  ) async* {
+    final entries = <NativeArchiveEntry>[];
+    try {
+      yield DownloadResult(
+        status: DownloadStatus.started,
+        message: 'Starting archive download: ${images.length} image(s)',
+      );
+
+      // Requested by server name, saved under the name a single download of
+      // the URL would use
+      final requested = <String, (ImageModel, String)>{};
+      for (final image in images) {
+        final filename = _getFilenameFromUrl(image.url);
+        final existingPath = await _checkForExistingFile(filename);
+        if (existingPath != null) {
+          yield DownloadResult(
+            status: DownloadStatus.duplicate,
+            message: 'File already exists: $filename at $existingPath',
+            result: true,
+            url: image.url,
+          );
+          continue;
+        }
+        requested[image.filename] = (image, filename);
+      }
+      if (requested.isEmpty) return;
 
+      final directory = await _getDesktopFolder();
       yield DownloadResult(
-        status: DownloadStatus.completed,
-        message: 'Saved as: $originalFilename at $savedPath',
-        result: true,
+        status: DownloadStatus.downloading,
+        message: 'Downloading ${requested.length} image(s) as one archive',
       );
+
+      final progress = _progress;
+      final progressId = progress?.begin(
+        '${requested.length} images',
+        nativePath: directory.path,
+      );
+      final startedAt = DateTime.now();
+      final stopwatch = Stopwatch()..start();
+      final NativeDownloadResult? native;
+      try {
+        native = await _engine?.downloadArchive(
+          archiveUrl,
+          directory.path,
+          body: jsonEncode({'filenames': requested.keys.toList()}),
+          expectedSize: requested.values.fold(
+            0,
+            (total, match) => total + match.$1.size,
+          ),
+          minFreeBytes: await _minFreeSpace(),
+        );
+      } finally {
+        if (progressId != null) progress?.end(progressId);
+      }
+      if (native == null || !native.success) {
+        yield DownloadResult(
+          status: DownloadStatus.failed,
+          message: 'Archive download failed: ${native?.error ?? 'no engine'}',
+          result: false,
+          insufficientSpace: native?.insufficientSpace ?? false,
+        );
+        return;
+      }
+      entries.addAll(native.entries);
+      final batchBytes = native.entries.fold(0, (total, e) => total + e.size);
+      final batchTime = stopwatch.elapsed;
+      print(
+        '📦 Archive download: ${native.bytes} bytes, '
+        '${entries.length} file(s)',
+      );
+
+      // Every file is handed to storage before any placement is awaited, so
+      // the native writer can batch them
+      final placements =
+          <(ImageModel, String, File, NativeArchiveEntry, Future<String>)>[];
+      while (entries.isNotEmpty) {
+        final entry = entries.removeAt(0);
+        final file = File(entry.path);
+        final match = requested.remove(entry.name);
+        if (match == null) {
+          print('⚠️ Archive sent ${entry.name}, which was not requested');
+          await _deleteQuietly(file);
+          continue;
+        }
+        final (image, filename) = match;
+        final checksum = image.checksum;
+        if (checksum != null && checksum.toLowerCase() != entry.hash) {
+          await _deleteQuietly(file);
+          yield DownloadResult(
+            status: DownloadStatus.failed,
+            message:
+                'Download failed: checksum mismatch: got ${entry.hash}, '
+                'expected $checksum',
+            result: false,
+            url: image.url,
+          );
+          continue;
+        }
+        yield DownloadResult(
+          status: DownloadStatus.saving,
+          message: _getSavingMessage(),
+          url: image.url,
+        );
+        final placed = _saveImageToPlatformStorage(file, filename);
+        // Awaited below, in order; failures are reported per image there
+        placed.ignore();
+        placements.add((image, filename, file, entry, placed));
+      }
+
+      for (final (image, filename, file, entry, placed) in placements) {
+        try {
+          final savedPath = await placed;
+          // The batch's time, shared out by size
+          final transfer = (
+            startedAt: startedAt,
+            duration: batchBytes > 0
+                ? batchTime * (entry.size / batchBytes)
+                : Duration.zero,
+            bytes: entry.size,
+          );
+          yield await _indexSaved(
+            filename,
+            savedPath,
+            entry.hash,
+            transfer,
+            url: image.url,
+          );
+        } catch (e) {
+          await _deleteQuietly(file);
+          yield DownloadResult(
+            status: DownloadStatus.failed,
+            message: 'Error: $e',
+            result: false,
+            url: image.url,
+          );
+        }
+      }
     } catch (e) {
+      for (final entry in entries) {
+        await _deleteQuietly(File(entry.path));
+      }
       yield DownloadResult(
         status: DownloadStatus.failed,
         message: 'Error: $e',
@@ -100,19 +400,297 @@ class DownloadManager {
     }
   }
 
+  /// Save a downloaded file as [filename] and index it
+  /// Returns the completed event, or a duplicate one if the same content is
+  /// already saved under another name.
+  Future<DownloadResult> _saveDownloaded(
+    File downloadFile,
+    String filename,
+    String? hash,
+    _Transfer transfer,
+  ) async {
+    // Save image based on platform
+    final savedPath = await _saveImageToPlatformStorage(downloadFile, filename);
+    return _indexSaved(filename, savedPath, hash, transfer);
+  }
+
+  /// Index an image saved at [savedPath] and add it to the download history
+  /// Returns the event for it; [url] is passed on to the event.
+  Future<DownloadResult> _indexSaved(
+    String filename,
+    String savedPath,
+    String? hash,
+    _Transfer transfer, {
+    String? url,
+  }) async {
+    // Index the saved file; a renamed copy of a known image is dropped
+    final (duplicateOf, size) = await _recordSavedImage(
+      filename,
+      savedPath,
+      hash,
+    );
+    if (duplicateOf != null) {
+      return DownloadResult(
+        status: DownloadStatus.duplicate,
+        message: 'Same image already saved as $duplicateOf',
+        result: true,
+        url: url,
+      );
+    }
+
+    await _history.record(
+      filename,
+      size: size ?? transfer.bytes,
+      bytes: transfer.bytes,
+      hash: hash,
+      startedAt: transfer.startedAt,
+      duration: transfer.duration,
+    );
+
+    return DownloadResult(
+      status: DownloadStatus.completed,
+      message: 'Saved as: $filename at $savedPath',
+      result: true,
+      hash: hash,
+      url: url,
+    );
+  }
+
+  /// File to download [filename] into
+  /// Linux & macOS: a hidden `.partial` file in the molethewall folder, so
+  /// saving is a rename. Other platforms: the temp directory.
+  Future<File> _getDownloadFile(String filename) async {
+    if (defaultTargetPlatform == TargetPlatform.linux ||
+        defaultTargetPlatform == TargetPlatform.macOS) {
+      try {
+        final molethewallDir = await _getDesktopFolder();
+        return File(
+          StorageService.partialPathFor(
+            path.join(molethewallDir.path, filename),
+          ),
+        );
+      } catch (e) {
+        print('⚠️ Cannot download into molethewall folder: $e');
+      }
+    }
+    final tempDir = await getTemporaryDirectory();
+    return File('${tempDir.path}/$filename');
+  }
+
+  /// Free space downloads must leave, in bytes
+  Future<int> _minFreeSpace() async {
+    return await SPManager.getMinFreeSpace() ?? defaultMinFreeSpace;
+  }
+
+  /// Delete a leftover download file, ignoring errors
+  Future<void> _deleteQuietly(File file) async {
+    try {
+      if (await file.exists()) await file.delete();
+    } catch (e) {
+      print('⚠️ Could not delete ${file.path}: $e');
+    }
+  }
+
+  /// Download [url] into [filePath]
+  /// Uses the native engine (parallel ranged requests, content hashed on the
+  /// way in and checked against [checksum]) where available and Dio
+  /// otherwise. [size] (0 if unknown) is checked against the free-space
+  /// floor by the native engine.
+  /// Every attempt is reported to the transfer controller, which sets the
+  /// connection count and chunk size used here. Failures that say nothing
+  /// about the link (HTTP errors, checksum mismatches) are left out.
+  Future<_FetchResult> _fetch(
+    String url,
+    String filePath, {
+    String? checksum,
+    int size = 0,
+  }) async {
+    final startedAt = DateTime.now();
+    final stopwatch = Stopwatch()..start();
+    try {
+      final result = await _fetchOnce(
+        url,
+        filePath,
+        checksum: checksum,
+        size: size,
+      );
+      if (result.success || result.linkFailure) {
+        _transfers?.recordTransfer(
+          bytes: result.bytes,
+          elapsed: stopwatch.elapsed,
+          success: result.success,
+        );
+      }
+      return result.timed(startedAt, stopwatch.elapsed);
+    } on DioException catch (e) {
+      if (e.type != DioExceptionType.badResponse &&
+          e.type != DioExceptionType.cancel) {
+        _transfers?.recordTransfer(
+          bytes: 0,
+          elapsed: stopwatch.elapsed,
+          success: false,
+        );
+      }
+      rethrow;
+    }
+  }
+
+  /// Single download attempt for [_fetch], tracked by the progress tracker
+  Future<_FetchResult> _fetchOnce(
+    String url,
+    String filePath, {
+    String? checksum,
+    int size = 0,
+  }) async {
+    final progress = _progress;
+    final progressId = progress?.begin(
+      _getFilenameFromUrl(url),
+      nativePath: _engine?.isAvailable == true ? filePath : null,
+    );
+    try {
+      return await _transferOnce(url, filePath, checksum, size, progressId);
+    } finally {
+      if (progressId != null) progress?.end(progressId);
+    }
+  }
+
+  Future<_FetchResult> _transferOnce(
+    String url,
+    String filePath,
+    String? checksum,
+    int size,
+    int? progressId,
+  ) async {
+    final limits = _transfers?.limits;
+    final native = await _engine?.download(
+      url,
+      filePath,
+      connections:
+          limits?.connections ?? NativeDownloadEngine.defaultConnections,
+      chunkSize: limits?.chunkSize ?? NativeDownloadEngine.defaultChunkSize,
+      checksum: checksum,
+      expectedSize: size,
+      minFreeBytes: await _minFreeSpace(),
+    );
+    if (native != null) {
+      if (!native.success) {
+        final reason = native.statusCode >= 400
+            ? '${native.statusCode}'
+            : '${native.error}';
+        if (native.insufficientSpace) {
+          print('💾 Download refused: $reason');
+        } else if (native.resumable) {
+          print(
+            '⏸️ Download interrupted, keeping ${native.bytes} bytes to resume',
+          );
+        }
+        return _FetchResult(
+          error: reason,
+          bytes: native.bytes - native.resumedBytes,
+          linkFailure: native.failure == NativeDownloadFailure.network,
+          resumable: native.resumable,
+          insufficientSpace: native.insufficientSpace,
+        );
+      }
+      final resumed = native.resumedBytes > 0
+          ? ', resumed after ${native.resumedBytes} bytes'
+          : '';
+      print(
+        '⚡ Native download: ${native.bytes} bytes over '
+        '${native.connections} connection(s), xxh64 ${native.hash}$resumed',
+      );
+      return _FetchResult(
+        hash: native.hash,
+        bytes: native.bytes - native.resumedBytes,
+      );
+    }
+
+    var received = 0;
+    final response = await _dio.download(
+      url,
+      filePath,
+      onReceiveProgress: (count, total) {
+        received = count;
+        if (progressId != null) _progress?.update(progressId, count, total);
+      },
+    );
+    return _FetchResult(
+      error: response.statusCode == 200 ? null : '${response.statusCode}',
+      bytes: received,
+    );
+  }
+
+  /// Record a saved image in the dedup index
+  /// If its content matches an image saved under another name that is still
+  /// on disk, the new copy is deleted and that name returned. Also returns
+  /// the file's size where the index knows it.
+  Future<(String?, int?)> _recordSavedImage(
+    String filename,
+    String savedPath,
+    String? hash,
+  ) async {
+    final shard = await _shardOf(savedPath);
+    final record = await _storage.recordImage(
+      filename,
+      savedPath,
+      hash: hash,
+      shard: shard,
+    );
+    final duplicateOf = record?.duplicateOf;
+    if (duplicateOf == null) return (null, record?.size);
+
+    // The earlier copy may be in another shard of the same folder
+    final root = shard.isEmpty
+        ? path.dirname(savedPath)
+        : (await _getDesktopFolder()).path;
+    final original = File(
+      path.join(root, record?.duplicateShard ?? '', duplicateOf),
+    );
+    if (!await original.exists()) return (null, record?.size);
+
+    print('🔄 $filename has the same content as $duplicateOf, removing it');
+    await _deleteQuietly(File(savedPath));
+    return (duplicateOf, record?.size);
+  }
+
   /// Check if file already exists to prevent duplicate downloads
   Future<String?> _checkForExistingFile(String filename) async {
     try {
+      // Linux: every file in the folder is known from memory, and one the
+      // user deleted may be downloaded again
+      final folder = _folder;
+      if (folder != null && folder.isLive) {
+        final shard = folder.shardOf(filename);
+        if (shard == null) return null;
+        final molethewallDir = await _getDesktopFolder();
+        final existingPath = path.join(molethewallDir.path, shard, filename);
+        print('🔄 File already in molethewall folder: $existingPath');
+        return existingPath;
+      }
+
+      // Every image saved before, not just the last one (Linux), found
+      // without listing the folder
+      final shard = await _storage.locateImage(filename);
+      if (shard != null) {
+        final molethewallDir = await _getDesktopFolder();
+        final existingPath = path.join(molethewallDir.path, shard, filename);
+        print('🔄 File already in dedup index: $existingPath');
+        return existingPath;
+      }
+
       // Check if this is the same as the last downloaded file
-      final lastDownloadedFile = await SPManager.getLastDownloadFilename();
+      final lastDownload = await _history.latest();
 
-      if (lastDownloadedFile != null && lastDownloadedFile == filename) {
+      if (lastDownload != null && lastDownload.filename == filename) {
         print('🔄 File already downloaded recently: $filename');
 
         if (defaultTargetPlatform == TargetPlatform.linux ||
             defaultTargetPlatform == TargetPlatform.macOS) {
           // For Linux & macOS, verify file still exists at expected location
-          final existingPath = await _checkDesktopFileExists(filename);
+          final existingPath = await _checkDesktopFileExists(
+            filename,
+            lastDownload.finishedAt,
+          );
           if (existingPath != null) {
             return existingPath;
           }
@@ -130,45 +708,25 @@ class DownloadManager {
     }
   }
 
-  /// Check if file exists in desktop molethewall folder (Linux & macOS)
-  Future<String?> _checkDesktopFileExists(String filename) async {
+  /// Check if the last downloaded file, saved at [savedAt], exists in
+  /// desktop molethewall folder (Linux & macOS), in its shard or directly in
+  /// the folder
+  Future<String?> _checkDesktopFileExists(
+    String filename,
+    DateTime savedAt,
+  ) async {
     try {
-      // Get platform-specific base directory
-      Directory baseDir;
-      final homeDir = Platform.environment['HOME'];
-
-      if (defaultTargetPlatform == TargetPlatform.macOS) {
-        // macOS: Use Pictures folder
-        if (homeDir != null) {
-          final picturesDir = Directory(path.join(homeDir, 'Pictures'));
-          if (await picturesDir.exists()) {
-            baseDir = picturesDir;
-          } else {
-            baseDir = await getApplicationDocumentsDirectory();
-          }
-        } else {
-          baseDir = await getApplicationDocumentsDirectory();
-        }
-      } else {
-        // Linux: Use Pictures folder or Home folder
-        if (homeDir != null) {
-          final picturesDir = Directory(path.join(homeDir, 'Pictures'));
-          if (await picturesDir.exists()) {
-            baseDir = picturesDir;
-          } else {
-            baseDir = Directory(homeDir);
-          }
-        } else {
-          baseDir = await getApplicationDocumentsDirectory();
-        }
-      }
+      final molethewallDir = await _getDesktopFolder();
+      final shard = (await _storageLayout()).shardFor(filename, savedAt);
 
-      final molethewallDir = Directory(path.join(baseDir.path, 'molethewall'));
-      final targetFile = File(path.join(molethewallDir.path, filename));
-
-      if (await targetFile.exists()) {
-        print('📁 File already exists: ${targetFile.path}');
-        return targetFile.path;
+      for (final directory in {shard, ''}) {
+        final targetFile = File(
+          path.join(molethewallDir.path, directory, filename),
+        );
+        if (await targetFile.exists()) {
+          print('📁 File already exists: ${targetFile.path}');
+          return targetFile.path;
+        }
       }
 
       return null;
@@ -178,6 +736,122 @@ class DownloadManager {
     }
   }
 
+  /// Get platform-specific base directory (Linux & macOS)
+  /// Pictures when it exists, else Home (Linux) or Documents (macOS)
+  Future<Directory> _getDesktopBaseDirectory() async {
+    final homeDir = Platform.environment['HOME'];
+    if (homeDir != null) {
+      final picturesDir = Directory(path.join(homeDir, 'Pictures'));
+      if (await picturesDir.exists()) {
+        return picturesDir;
+      }
+      if (defaultTargetPlatform != TargetPlatform.macOS) {
+        return Directory(homeDir);
+      }
+    }
+    return await getApplicationDocumentsDirectory();
+  }
+
+  /// Get the molethewall folder (Linux & macOS), creating it if needed
+  /// Resolved once; the first call also starts following the folder and
+  /// moving it to the chosen storage layout.
+  Future<Directory> _getDesktopFolder() async {
+    final cached = _desktopFolder;
+    if (cached != null) return cached;
+
+    final baseDir = await _getDesktopBaseDirectory();
+    final molethewallDir = Directory(path.join(baseDir.path, 'molethewall'));
+    if (!await molethewallDir.exists()) {
+      await molethewallDir.create(recursive: true);
+      print('📁 Created molethewall directory: ${molethewallDir.path}');
+    }
+    _shards.add('');
+    _desktopFolder = molethewallDir;
+    await _folder?.watch(molethewallDir.path);
+    _layoutApplied ??= _applyStorageLayout(molethewallDir);
+    return molethewallDir;
+  }
+
+  /// Layout new images are saved in
+  Future<StorageLayout> _storageLayout() async {
+    return StorageLayout.fromName(await SPManager.getStorageLayout());
+  }
+
+  /// Directory [savedPath] is in, relative to the molethewall folder
+  /// '' for the folder itself and for paths outside it
+  Future<String> _shardOf(String savedPath) async {
+    if (defaultTargetPlatform != TargetPlatform.linux &&
+        defaultTargetPlatform != TargetPlatform.macOS) {
+      return '';
+    }
+    final root = (await _getDesktopFolder()).path;
+    final directory = path.dirname(savedPath);
+    return path.isWithin(root, directory)
+        ? path.relative(directory, from: root)
+        : '';
+  }
+
+  /// Create [shard] ('' for [root] itself) unless it is known to exist
+  Future<void> _ensureShard(Directory root, String shard) async {
+    if (_shards.contains(shard)) return;
+    await Directory(path.join(root.path, shard)).create(recursive: true);
+    _shards.add(shard);
+  }
+
+  /// One-time migration of a flat molethewall folder to the chosen layout
+  /// Images directly in [root] move to their shard, dated by their
+  /// modification time, and the dedup index follows them in batches.
+  /// Interrupted, it picks up where it stopped on the next start. Images
+  /// already in shards stay put; switching back to flat moves nothing.
+  Future<void> _applyStorageLayout(Directory root) async {
+    try {
+      final layout = await _storageLayout();
+      final applied = StorageLayout.fromName(
+        await SPManager.getAppliedStorageLayout(),
+      );
+      if (layout == applied) return;
+      if (layout == StorageLayout.flat) {
+        await SPManager.setAppliedStorageLayout(layout.name);
+        return;
+      }
+
+      print('🗂️ Moving molethewall images into the ${layout.name} layout');
+      final stopwatch = Stopwatch()..start();
+      final moved = <String, String>{};
+      var count = 0;
+      await for (final entity in root.list(followLinks: false)) {
+        if (entity is! File) continue;
+        final filename = path.basename(entity.path);
+        // Downloads in progress
+        if (filename.startsWith('.')) continue;
+
+        final shard = layout.shardFor(filename, await entity.lastModified());
+        final target = path.join(root.path, shard, filename);
+        await _ensureShard(root, shard);
+        if (await File(target).exists()) {
+          print('⚠️ Not moving $filename, $target already exists');
+          continue;
+        }
+        await entity.rename(target);
+        moved[filename] = shard;
+        count++;
+        if (moved.length >= 500) {
+          await _storage.moveImages(moved);
+          moved.clear();
+        }
+      }
+      if (moved.isNotEmpty) await _storage.moveImages(moved);
+
+      await SPManager.setAppliedStorageLayout(layout.name);
+      print(
+        '✅ Moved $count image(s) into the ${layout.name} layout in '
+        '${stopwatch.elapsedMilliseconds} ms',
+      );
+    } catch (e) {
+      print('❌ Error moving images to the storage layout: $e');
+    }
+  }
+
   /// Get platform-specific saving message
   String _getSavingMessage() {
     if (defaultTargetPlatform == TargetPlatform.linux ||
@@ -201,6 +875,8 @@ class DownloadManager {
       // Mobile platforms (Android, iOS) & Windows: Use gal package
       await _ensureGalleryPermissions();
       await Gal.putImage(tempFile.path, album: 'molethewall');
+      // Gal keeps its own copy
+      await _deleteQuietly(tempFile);
       return 'molethewall album in ${_getPlatformGalleryName()}';
     }
   }
@@ -236,58 +912,35 @@ class DownloadManager {
   }
 
   /// Save image to desktop folder (Linux & macOS)
+  /// Moves [tempFile] into place: a rename when it was downloaded into the
+  /// folder, otherwise a reflink or copy (see StorageService.placeFile)
   Future<String> _saveToDesktopFolder(File tempFile, String filename) async {
+    final platformName = defaultTargetPlatform == TargetPlatform.macOS
+        ? 'macOS'
+        : 'Linux';
     try {
-      // Get platform-specific base directory
-      Directory baseDir;
-      final homeDir = Platform.environment['HOME'];
-
-      if (defaultTargetPlatform == TargetPlatform.macOS) {
-        // macOS: Use Pictures folder
-        if (homeDir != null) {
-          final picturesDir = Directory(path.join(homeDir, 'Pictures'));
-          if (await picturesDir.exists()) {
-            baseDir = picturesDir;
-          } else {
-            baseDir = await getApplicationDocumentsDirectory();
-          }
-        } else {
-          baseDir = await getApplicationDocumentsDirectory();
-        }
-      } else {
-        // Linux: Use Pictures folder or Home folder
-        if (homeDir != null) {
-          final picturesDir = Directory(path.join(homeDir, 'Pictures'));
-          if (await picturesDir.exists()) {
-            baseDir = picturesDir;
-          } else {
-            baseDir = Directory(homeDir);
-          }
-        } else {
-          baseDir = await getApplicationDocumentsDirectory();
-        }
+      final molethewallDir = await _getDesktopFolder();
+      final layout = await _storageLayout();
+      final shard = layout.shardFor(filename, DateTime.now());
+      await _ensureShard(molethewallDir, shard);
+      final finalFile = File(path.join(molethewallDir.path, shard, filename));
+      String method;
+      try {
+        method = await _storage.placeFile(tempFile.path, finalFile.path);
+      } catch (e) {
+        // The folder or shard may have been removed since it was created
+        if (await finalFile.parent.exists()) rethrow;
+        print('⚠️ Re-creating molethewall folder: $e');
+        _shards.clear();
+        await _ensureShard(molethewallDir, '');
+        await _ensureShard(molethewallDir, shard);
+        await _folder?.watch(molethewallDir.path);
+        method = await _storage.placeFile(tempFile.path, finalFile.path);
       }
 
-      // Create molethewall subdirectory
-      final molethewallDir = Directory(path.join(baseDir.path, 'molethewall'));
-      if (!await molethewallDir.exists()) {
-        await molethewallDir.create(recursive: true);
-        print('📁 Created molethewall directory: ${molethewallDir.path}');
-      }
-
-      // Copy file to final location
-      final finalFile = File(path.join(molethewallDir.path, filename));
-      await tempFile.copy(finalFile.path);
-
-      final platformName = defaultTargetPlatform == TargetPlatform.macOS
-          ? 'macOS'
-          : 'Linux';
-      print('✅ Saved to $platformName folder: ${finalFile.path}');
+      print('✅ Saved to $platformName folder ($method): ${finalFile.path}');
       return finalFile.path;
     } catch (e) {
-      final platformName = defaultTargetPlatform == TargetPlatform.macOS
-          ? 'macOS'
-          : 'Linux';
       print('❌ Error saving to $platformName folder: $e');
       // Fallback: save to application documents directory
       final documentsDir = await getApplicationDocumentsDirectory();
@@ -298,28 +951,11 @@ class DownloadManager {
         await molethewallDir.create(recursive: true);
       }
       final finalFile = File(path.join(molethewallDir.path, filename));
-      await tempFile.copy(finalFile.path);
+      await _storage.placeFile(tempFile.path, finalFile.path);
       return finalFile.path;
     }
   }
 
-  /// Save last download information to SharedPreferences
-  Future<void> _saveLastDownloadInfo(String filename) async {
-    try {
-      final now = DateTime.now();
-
-      // Save last download datetime and filename
-      await SPManager.setLastDownloadDateTime(now);
-      await SPManager.setLastDownloadFilename(filename);
-
-      print(
-        '💾 Saved last download info: $filename at ${now.toIso8601String()}',
-      );
-    } catch (e) {
-      print('❌ Error saving last download info: $e');
-    }
-  }
-
   /// Extract original filename from URL
   static String _getFilenameFromUrl(String imageUrl) {
     try {
@@ -0,0 +1,91 @@
+import 'dart:async';
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+
+final folderViewProvider = Provider((ref) {
+  final view = FolderView();
+  ref.onDispose(view.dispose);
+  return view;
+});
+
+/// In-memory listing of the molethewall folder, kept current by the native
+/// folder watcher (linux/runner/folder_watcher_linux.h)
+///
+/// The watcher lists the folder once, then reports files as they are saved
+/// and as they disappear, including ones the user deletes, so "is this image
+/// on disk, and where?" is a map lookup. [isLive] is false on other
+/// platforms, until the first listing arrives, and once the folder can't be
+/// followed (removed, or out of inotify watches); ask the disk then.
+class FolderView {
+  static const MethodChannel _channel = MethodChannel('storage_service');
+  static const EventChannel _eventChannel = EventChannel(
+    'storage_service/folder',
+  );
+
+  /// Shard of each file on disk by name, '' for the folder itself
+  final Map<String, String> _shards = {};
+  StreamSubscription<dynamic>? _subscription;
+  bool _live = false;
+
+  /// Whether lookups reflect the folder
+  bool get isLive => _live;
+
+  /// Number of files in the folder and its shards
+  int get length => _shards.length;
+
+  /// Shard [filename] is saved in ('' for the folder itself), or null if it
+  /// is not on disk or the view is not live
+  String? shardOf(String filename) => _live ? _shards[filename] : null;
+
+  /// Start following [folder] (Linux)
+  /// Calling it again for the same folder lists it anew, e.g. after it was
+  /// re-created.
+  Future<void> watch(String folder) async {
+    if (!Platform.isLinux) return;
+    // Listening first, so the initial listing isn't missed
+    _subscription ??= _eventChannel.receiveBroadcastStream().listen(
+      _apply,
+      onError: (Object e) => print('❌ Folder watcher error: $e'),
+    );
+    try {
+      await _channel.invokeMethod('watchFolder', {'path': folder});
+    } on MissingPluginException {
+      // Older runner without the folder watcher
+    } on PlatformException catch (e) {
+      print("Failed to watch folder: '${e.message}'");
+    }
+  }
+
+  void _apply(dynamic event) {
+    if (event is! Map) return;
+    if (event['reset'] == true) _shards.clear();
+    for (final change in event['changes'] as List<dynamic>) {
+      final fields = change as List<dynamic>;
+      final name = fields[0] as String;
+      final shard = fields[1] as String;
+      if (fields[2] == true) {
+        _shards[name] = shard;
+      } else if (_shards[name] == shard) {
+        _shards.remove(name);
+      }
+    }
+    final live = event['live'] == true;
+    if (event['reset'] == true) {
+      print(
+        live
+            ? '📁 Watching ${_shards.length} file(s) in molethewall folder'
+            : '⚠️ Lost track of molethewall folder',
+      );
+    }
+    _live = live;
+  }
+
+  /// Dispose resources
+  void dispose() {
+    _subscription?.cancel();
+    _subscription = null;
+    _live = false;
+  }
+}
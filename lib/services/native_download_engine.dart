@@ -0,0 +1,166 @@
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/native_download_result.dart';
+
+final nativeDownloadEngineProvider = Provider((ref) => NativeDownloadEngine());
+
+/// Client for the native download engine (linux/runner/download_engine_linux.h)
+///
+/// Large objects are fetched as parallel HTTP Range requests written straight
+/// into the destination file, which a single Dio stream can't match on fast
+/// links. Only the Linux runner provides the engine.
+class NativeDownloadEngine {
+  static const MethodChannel _channel = MethodChannel('download_engine');
+
+  /// Parallel ranged requests per download
+  static const int defaultConnections = 4;
+
+  /// Bytes per ranged request
+  static const int defaultChunkSize = 8 * 1024 * 1024;
+
+  bool _missing = false;
+
+  /// Whether downloads can be handed to the native engine on this platform
+  bool get isAvailable => Platform.isLinux && !_missing;
+
+  /// Download [url] into [filePath], completing when the file is written
+  /// When [checksum] (XXH64, 16 hex digits) is given the content is verified
+  /// against it and the download fails on a mismatch.
+  /// [bindInterface] sends the download over the fastest link the network
+  /// monitor has seen rather than the default route; [stripe] lets its
+  /// ranged requests alternate between the two fastest links when both are
+  /// up (never onto mobile data). Neither applies while the default route
+  /// goes through a VPN tunnel, which binding would bypass.
+  /// With [resume], an earlier interrupted download into [filePath] is
+  /// continued where the server allows it (If-Range), and an interrupted
+  /// one leaves its partial file and journal behind (see
+  /// [NativeDownloadResult.resumable]).
+  /// [expectedSize] (0 if unknown) is checked against [minFreeBytes], the
+  /// space that must stay free on the disk, and preallocated before the
+  /// first request; see [NativeDownloadResult.insufficientSpace].
+  /// Returns null if the engine is not available, in which case the caller
+  /// should download some other way
+  Future<NativeDownloadResult?> download(
+    String url,
+    String filePath, {
+    int connections = defaultConnections,
+    int chunkSize = defaultChunkSize,
+    String? checksum,
+    bool bindInterface = true,
+    bool stripe = true,
+    bool resume = true,
+    int expectedSize = 0,
+    int minFreeBytes = 0,
+  }) async {
+    if (!isAvailable) return null;
+
+    try {
+      final Map<dynamic, dynamic>? result = await _channel.invokeMethod(
+        'download',
+        {
+          'url': url,
+          'path': filePath,
+          'connections': connections,
+          'chunkSize': chunkSize,
+          if (checksum != null) 'checksum': checksum,
+          'bindInterface': bindInterface,
+          'stripe': stripe,
+          'resume': resume,
+          'expectedSize': expectedSize,
+          'minFreeBytes': minFreeBytes,
+        },
+      );
+      return NativeDownloadResult.fromMap(result);
+    } on MissingPluginException {
+      print('⚠️ Native download engine not registered, disabling it');
+      _missing = true;
+      return null;
+    } on PlatformException catch (e) {
+      if (e.code != 'DOWNLOAD_FAILED') {
+        print("Native download engine unavailable: '${e.message}'");
+        return null;
+      }
+      return NativeDownloadResult.fromMap(
+        e.details is Map ? e.details as Map : null,
+        success: false,
+        error: e.message,
+      );
+    }
+  }
+
+  /// Download the tar archive at [url], optionally zstd-compressed, and
+  /// unpack it into [directory] as it arrives
+  /// [body] is POSTed as JSON when given. Each file lands in the hidden
+  /// `.partial` staging file for its name (see [NativeDownloadResult.entries]),
+  /// ready to be placed like a single download. A failed or truncated
+  /// archive leaves nothing behind and can't be resumed.
+  /// [expectedSize] is the total of the files, checked against
+  /// [minFreeBytes] as for [download]; each file is preallocated from the
+  /// archive's own header.
+  /// Returns null if the engine is not available
+  Future<NativeDownloadResult?> downloadArchive(
+    String url,
+    String directory, {
+    String? body,
+    bool bindInterface = true,
+    int expectedSize = 0,
+    int minFreeBytes = 0,
+  }) async {
+    if (!isAvailable) return null;
+
+    try {
+      final Map<dynamic, dynamic>? result = await _channel.invokeMethod(
+        'downloadArchive',
+        {
+          'url': url,
+          'directory': directory,
+          if (body != null) 'body': body,
+          'bindInterface': bindInterface,
+          'expectedSize': expectedSize,
+          'minFreeBytes': minFreeBytes,
+        },
+      );
+      return NativeDownloadResult.fromMap(result);
+    } on MissingPluginException {
+      print('⚠️ Native download engine not registered, disabling it');
+      _missing = true;
+      return null;
+    } on PlatformException catch (e) {
+      if (e.code != 'DOWNLOAD_FAILED') {
+        print("Native download engine unavailable: '${e.message}'");
+        return null;
+      }
+      return NativeDownloadResult.fromMap(
+        e.details is Map ? e.details as Map : null,
+        success: false,
+        error: e.message,
+      );
+    }
+  }
+
+  /// Bytes written and size (-1 until known) of the downloads in flight, by
+  /// destination path
+  /// Cheap enough to poll at UI rates; empty when the engine is unavailable.
+  Future<Map<String, (int, int)>> progress() async {
+    if (!isAvailable) return const {};
+
+    try {
+      final List<dynamic>? downloads = await _channel.invokeMethod('progress');
+      return {
+        for (final download in downloads ?? const [])
+          if (download is Map)
+            download['path'] as String: (
+              download['bytes'] as int,
+              download['total'] as int,
+            ),
+      };
+    } on MissingPluginException {
+      _missing = true;
+      return const {};
+    } on PlatformException {
+      return const {};
+    }
+  }
+}
@@ -1,24 +1,245 @@
 import 'package:flutter/services.dart';
+import 'dart:ffi';
 import 'dart:io';
 import 'dart:async';
+import 'dart:typed_data';
 
 import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/link_quality.dart';
+import '../models/network_event.dart';
+import '../models/network_status.dart';
 
 final networkServiceProvider = Provider((ref) => NetworkService());
 
+typedef _StatusPageFunction = Pointer<NetworkStatusPage> Function();
+
+/// Mirror of `NetworkStatusLink` in linux/runner/network_service_ffi.h
+final class NetworkStatusLink extends Struct {
+  /// NETWORK_STATUS_LINK_NAME_SIZE
+  static const int nameSize = 16;
+
+  @Array(nameSize)
+  external Array<Uint8> name;
+
+  @Int32()
+  external int type;
+
+  /// Negotiated link speed, -1 when unknown
+  @Int32()
+  external int speedMbps;
+
+  /// NetworkServiceDuplex: 0 unknown, 1 half, 2 full
+  @Int32()
+  external int duplex;
+
+  /// -1 when unknown
+  @Int32()
+  external int mtu;
+
+  /// Wi-Fi signal strength, 0 when unknown
+  @Int32()
+  external int signalDbm;
+
+  /// Wi-Fi transmit rate, -1 when unknown
+  @Int32()
+  external int txBitrateKbps;
+
+  LinkQuality get quality => LinkQuality.fromNative(
+    speedMbps: speedMbps,
+    duplex: duplex,
+    mtu: mtu,
+    signalDbm: signalDbm,
+    txBitrateKbps: txBitrateKbps,
+  );
+
+  /// Interface name (e.g. `eth0`)
+  String get interfaceName {
+    final codes = <int>[];
+    for (var i = 0; i < nameSize && name[i] != 0; i++) {
+      codes.add(name[i]);
+    }
+    return String.fromCharCodes(codes);
+  }
+}
+
+/// Mirror of `NetworkStatusPage` in linux/runner/network_service_ffi.h
+///
+/// The native monitor publishes every change into this page under a seqlock.
+/// Only [generation] may be read from the live page; everything else must be
+/// read from a copy returned by [NetworkService.readStatusPage].
+final class NetworkStatusPage extends Struct {
+  /// NETWORK_STATUS_PAGE_MAX_LINKS
+  static const int maxLinks = 8;
+
+  /// NetworkServiceType of a disconnected page (NETWORK_SERVICE_TYPE_NONE)
+  static const int typeNone = 0;
+
+  @Uint32()
+  external int sequence;
+
+  @Uint32()
+  external int version;
+
+  @Int32()
+  external int networkType;
+
+  @Uint32()
+  external int flags;
+
+  /// Incremented on every published change, 0 until the monitor has started
+  @Uint64()
+  external int generation;
+
+  @Int64()
+  external int timestampMs;
+
+  @Uint32()
+  external int linkCount;
+
+  @Uint32()
+  external int reserved;
+
+  /// The primary link first whenever [networkType] isn't [typeNone]
+  @Array(maxLinks)
+  external Array<NetworkStatusLink> links;
+}
+
+/// dart:ffi binding to the native network library (libnetwork_service.so).
+/// Only built on Linux; see linux/runner/network_service_ffi.h for the C ABI.
+class NetworkServiceBindings {
+  // network_service_get_status() keeps the type in the low byte
+  static const int _typeMask = 0xFF;
+
+  // Byte offset of NetworkStatusPage.generation
+  static const int _generationOffset = 16;
+
+  final int Function() _getStatus;
+  final _StatusPageFunction _readStatusPage;
+  final Pointer<Uint64> _liveGeneration;
+
+  NetworkServiceBindings._(
+    this._getStatus,
+    this._readStatusPage,
+    this._liveGeneration,
+  );
+
+  factory NetworkServiceBindings(DynamicLibrary library) {
+    final livePage = library
+        .lookupFunction<_StatusPageFunction, _StatusPageFunction>(
+          'network_service_status_page',
+        )();
+    return NetworkServiceBindings._(
+      library.lookupFunction<Uint32 Function(), int Function()>(
+        'network_service_get_status',
+      ),
+      library.lookupFunction<_StatusPageFunction, _StatusPageFunction>(
+        'network_service_read_status_page',
+      ),
+      Pointer<Uint64>.fromAddress(livePage.address + _generationOffset),
+    );
+  }
+
+  /// Load the native library, or return null where it is not available
+  static NetworkServiceBindings? tryLoad() {
+    if (!Platform.isLinux) return null;
+    try {
+      // Already mapped by the runner executable, which links against it
+      return NetworkServiceBindings(
+        DynamicLibrary.open('libnetwork_service.so'),
+      );
+    } catch (e) {
+      print('⚠️ Native network library unavailable, using MethodChannel: $e');
+      return null;
+    }
+  }
+
+  /// Read the current state with one synchronous native call
+  NetworkStatus readStatus() {
+    final status = _getStatus();
+    return NetworkStatus.fromNative(status & _typeMask, status);
+  }
+
+  /// Generation of the published status page; a plain memory load, cheap
+  /// enough to compare on every frame
+  int get statusGeneration => _liveGeneration.value;
+
+  /// Consistent copy of the published status page, valid until the next call
+  NetworkStatusPage readStatusPage() => _readStatusPage().ref;
+
+  /// Network state held by a status page copy
+  /// The link quality is that of the primary link, which the native side
+  /// publishes first
+  NetworkStatus statusFromPage(NetworkStatusPage page) {
+    final primary = page.networkType != NetworkStatusPage.typeNone &&
+            page.linkCount > 0
+        ? page.links[0]
+        : null;
+    final link = primary != null && primary.type == page.networkType
+        ? primary.quality
+        : LinkQuality.unknown;
+    return NetworkStatus.fromNative(page.networkType, page.flags, link: link);
+  }
+}
+
 class NetworkService {
   static const MethodChannel _channel = MethodChannel('network_service');
   static const EventChannel _eventChannel = EventChannel(
     'network_service/events',
   );
 
-  static Stream<Map<String, dynamic>>? _networkStream;
+  static Stream<NetworkEvent>? _networkStream;
   static StreamSubscription? _streamSubscription;
 
+  static final NetworkServiceBindings? _native =
+      NetworkServiceBindings.tryLoad();
+
+  /// Read the current network state synchronously through dart:ffi
+  /// Returns null where the native library is not available (non-Linux)
+  NetworkStatus? readStatusSync() => _native?.readStatus();
+
+  /// Get the current network state in a single query
+  /// On Linux this is a synchronous FFI call, elsewhere one MethodChannel call
+  Future<NetworkStatus> getStatus() async {
+    final native = readStatusSync();
+    if (native != null) return native;
+
+    try {
+      final Map<dynamic, dynamic> result = await _channel.invokeMethod(
+        'getStatus',
+      );
+      return NetworkStatus.fromMap(result);
+    } on PlatformException catch (e) {
+      print("Failed to get network status: '${e.message}'");
+      return NetworkStatus.fromMap(const {});
+    }
+  }
+
+  /// Generation of the native status page (Linux), 0 when unavailable
+  /// Compare against a previously seen value to detect changes without
+  /// any messaging
+  int get statusGeneration => _native?.statusGeneration ?? 0;
+
+  /// Consistent copy of the native status page (Linux only)
+  NetworkStatusPage? readStatusPage() => _native?.readStatusPage();
+
+  /// Network state after a `network_service/events` notification
+  /// On Linux the status page is read instead when the monitor has already
+  /// published something newer than the event
+  NetworkStatus statusFromEvent(NetworkEvent event) {
+    final native = _native;
+    if (native != null && native.statusGeneration > event.generation) {
+      return native.statusFromPage(native.readStatusPage());
+    }
+    return event.status;
+  }
+
   /// Check if device is connected to Wi-Fi or Ethernet
   /// Returns true if connected to Wi-Fi/Ethernet, false if mobile data or offline
   /// Supports: Android, iOS, Windows, macOS, Linux
   Future<bool> isConnectedToWifiOrEthernet() async {
+    final native = readStatusSync();
+    if (native != null) return native.isWifiOrEthernet;
+
     try {
       final bool result = await _channel.invokeMethod(
         'isConnectedToWifiOrEthernet',
@@ -37,6 +258,9 @@ class NetworkService {
   /// Returns: "wifi", "ethernet", "mobile", "none"
   /// Supports: Android, iOS, Windows, macOS, Linux
   Future<String> getNetworkType() async {
+    final native = readStatusSync();
+    if (native != null) return native.networkType;
+
     try {
       final String result = await _channel.invokeMethod('getNetworkType');
       return result;
@@ -48,6 +272,9 @@ class NetworkService {
 
   /// Check if device is connected to any network
   Future<bool> isConnected() async {
+    final native = readStatusSync();
+    if (native != null) return native.isConnected;
+
     try {
       final bool result = await _channel.invokeMethod('isConnected');
       return result;
@@ -58,13 +285,28 @@ class NetworkService {
   }
 
   /// Start listening to network changes (stream-based)
-  Stream<Map<String, dynamic>> get networkChanges {
-    _networkStream ??= _eventChannel.receiveBroadcastStream().map(
-      (event) => Map<String, dynamic>.from(event),
-    );
+  /// Payloads are decoded in place: binary on Linux, maps elsewhere
+  Stream<NetworkEvent> get networkChanges {
+    _networkStream ??= _eventChannel
+        .receiveBroadcastStream()
+        .map(_decodeEvent)
+        .where((event) => event != null)
+        .cast<NetworkEvent>();
     return _networkStream!;
   }
 
+  static NetworkEvent? _decodeEvent(dynamic event) {
+    if (event is Uint8List) {
+      final decoded = NetworkEvent.decode(event);
+      if (decoded == null) {
+        print('⚠️ Ignoring malformed network event (${event.length} bytes)');
+      }
+      return decoded;
+    }
+    if (event is Map) return NetworkEvent.fromMap(event);
+    return null;
+  }
+
   /// Start network monitoring
   Future<void> startNetworkMonitoring() async {
     try {
@@ -0,0 +1,162 @@
+import 'dart:async';
+
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/download_progress.dart';
+import 'native_download_engine.dart';
+
+final progressTrackerProvider = Provider((ref) {
+  final tracker = ProgressTracker(ref.read(nativeDownloadEngineProvider));
+  ref.onDispose(tracker.dispose);
+  return tracker;
+});
+
+class _Transfer {
+  final String label;
+
+  /// Destination of a native engine download, whose progress is polled
+  final String? nativePath;
+
+  int bytes = 0;
+  int total = -1;
+
+  /// Bytes at the previous sample; null until a native poll saw the
+  /// transfer, so bytes resumed from an earlier attempt don't count as rate
+  int? sampledBytes;
+  double rate = 0;
+
+  _Transfer(this.label, this.nativePath)
+    : sampledBytes = nativePath == null ? 0 : null;
+}
+
+/// Samples download progress at a fixed rate and merges it across downloads
+///
+/// Downloads report bytes through [update] as often as they like (Dio calls
+/// back per received buffer); that only stores two ints. Native engine
+/// downloads are polled instead. While anything is in flight, one merged
+/// [DownloadProgress] is published every [sampleInterval], so the UI
+/// rebuilds ten times a second at most, however many downloads run and
+/// however fast they go. An idle snapshot follows the last download.
+class ProgressTracker {
+  static const Duration sampleInterval = Duration(milliseconds: 100);
+
+  /// Weight of the newest sample in the smoothed rate
+  static const double _rateSmoothing = 0.3;
+
+  final NativeDownloadEngine? _engine;
+  final Map<int, _Transfer> _transfers = {};
+  int _nextId = 0;
+
+  Timer? _timer;
+  final Stopwatch _clock = Stopwatch();
+  Duration _lastSample = Duration.zero;
+  bool _polling = false;
+
+  final StreamController<DownloadProgress> _progressController =
+      StreamController<DownloadProgress>.broadcast();
+  DownloadProgress _progress = DownloadProgress.idle;
+
+  ProgressTracker([this._engine]);
+
+  /// Latest merged sample
+  DownloadProgress get progress => _progress;
+
+  /// Merged samples, [sampleInterval] apart while downloads run
+  Stream<DownloadProgress> get progressChanges => _progressController.stream;
+
+  /// Start tracking a download and return its handle
+  /// Pass [nativePath] for a download the native engine writes to that path;
+  /// its progress is then polled from the engine rather than reported.
+  int begin(String label, {String? nativePath}) {
+    final id = _nextId++;
+    _transfers[id] = _Transfer(label, nativePath);
+    if (_timer == null) {
+      _clock
+        ..reset()
+        ..start();
+      _lastSample = Duration.zero;
+      _timer = Timer.periodic(sampleInterval, (_) => _sample());
+    }
+    return id;
+  }
+
+  /// Report the bytes received so far; [total] is -1 when unknown
+  void update(int id, int bytes, [int total = -1]) {
+    final transfer = _transfers[id];
+    if (transfer == null) return;
+    transfer.bytes = bytes;
+    if (total >= 0) transfer.total = total;
+  }
+
+  /// Stop tracking a download
+  void end(int id) {
+    if (_transfers.remove(id) == null || _transfers.isNotEmpty) return;
+    _timer?.cancel();
+    _timer = null;
+    _clock.stop();
+    _publish(DownloadProgress.idle);
+  }
+
+  void _sample() {
+    if (!_polling && _transfers.values.any((t) => t.nativePath != null)) {
+      // Lands before a later tick; this one goes with what is known
+      _pollNative();
+    }
+
+    final now = _clock.elapsed;
+    final seconds = (now - _lastSample).inMicroseconds / 1e6;
+    _lastSample = now;
+    if (seconds <= 0) return;
+
+    final transfers = <TransferProgress>[];
+    for (final transfer in _transfers.values) {
+      final previous = transfer.sampledBytes;
+      if (previous != null) {
+        final instant = (transfer.bytes - previous) / seconds;
+        transfer.rate += _rateSmoothing * (instant - transfer.rate);
+        transfer.sampledBytes = transfer.bytes;
+      }
+      transfers.add(
+        TransferProgress(
+          label: transfer.label,
+          bytes: transfer.bytes,
+          total: transfer.total,
+          bytesPerSecond: transfer.rate,
+        ),
+      );
+    }
+    _publish(DownloadProgress(transfers));
+  }
+
+  Future<void> _pollNative() async {
+    final engine = _engine;
+    if (engine == null) return;
+    _polling = true;
+    try {
+      final native = await engine.progress();
+      for (final transfer in _transfers.values) {
+        final path = transfer.nativePath;
+        if (path == null) continue;
+        final sample = native[path];
+        if (sample == null) continue;
+        final (bytes, total) = sample;
+        transfer.bytes = bytes;
+        transfer.total = total;
+        transfer.sampledBytes ??= bytes;
+      }
+    } finally {
+      _polling = false;
+    }
+  }
+
+  void _publish(DownloadProgress progress) {
+    _progress = progress;
+    if (!_progressController.isClosed) _progressController.add(progress);
+  }
+
+  /// Dispose resources
+  void dispose() {
+    _timer?.cancel();
+    _timer = null;
+    _progressController.close();
+  }
+}
@@ -0,0 +1,146 @@
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/dedup_record.dart';
+
+final storageServiceProvider = Provider((ref) => StorageService());
+
+/// Native file storage helpers (linux/runner/file_placement_linux.h,
+/// linux/runner/dedup_index_linux.h)
+class StorageService {
+  static const MethodChannel _channel = MethodChannel('storage_service');
+
+  /// Hidden sibling a download is written to before it gets its final name
+  static String partialPathFor(String destination) {
+    final separator = destination.lastIndexOf(Platform.pathSeparator);
+    final directory = destination.substring(0, separator + 1);
+    final name = destination.substring(separator + 1);
+    return '$directory.$name.partial';
+  }
+
+  /// Move [source] to [destination] without copying data where possible
+  /// On Linux this tries rename, then a reflink, then an in-kernel copy;
+  /// elsewhere rename, then copy. [source] is removed either way.
+  /// On Linux the native storage writer batches placements that are in
+  /// flight together (io_uring where available), so start several before
+  /// awaiting them when saving many files. With [sync] the file and its name
+  /// are on disk when this completes (Linux).
+  /// Returns the method used ("rename", "reflink" or "copy").
+  Future<String> placeFile(
+    String source,
+    String destination, {
+    bool sync = true,
+  }) async {
+    if (Platform.isLinux) {
+      try {
+        final String method = await _channel.invokeMethod('placeFile', {
+          'source': source,
+          'destination': destination,
+          'sync': sync,
+        });
+        return method;
+      } on MissingPluginException {
+        // Older runner without the storage channel
+      }
+    }
+
+    try {
+      await File(source).rename(destination);
+      return 'rename';
+    } on FileSystemException {
+      // Different filesystem
+      await File(source).copy(destination);
+      await File(source).delete();
+      return 'copy';
+    }
+  }
+
+  /// Whether an image named [filename] (of [size] bytes, if given) was
+  /// saved before, answered from the native dedup index without touching
+  /// the image folder
+  /// Returns null where the index is not available (non-Linux)
+  Future<bool?> hasImage(String filename, {int? size}) async {
+    if (!Platform.isLinux) return null;
+    try {
+      final bool result = await _channel.invokeMethod('hasImage', {
+        'name': filename,
+        if (size != null) 'size': size,
+      });
+      return result;
+    } on MissingPluginException {
+      return null;
+    } on PlatformException catch (e) {
+      print("Failed to query dedup index: '${e.message}'");
+      return null;
+    }
+  }
+
+  /// Directory under the images folder an image named [filename] was saved
+  /// in ('' for the folder itself), from the native dedup index
+  /// Returns null if it was never saved or the index is not available
+  /// (non-Linux)
+  Future<String?> locateImage(String filename) async {
+    if (!Platform.isLinux) return null;
+    try {
+      final String? shard = await _channel.invokeMethod('locateImage', {
+        'name': filename,
+      });
+      return shard;
+    } on MissingPluginException {
+      return null;
+    } on PlatformException catch (e) {
+      print("Failed to query dedup index: '${e.message}'");
+      return null;
+    }
+  }
+
+  /// Add a saved image to the native dedup index
+  /// Pass the [hash] from the download to avoid reading the file again, and
+  /// the [shard] (directory under the images folder) it was saved in.
+  /// Returns null where the index is not available (non-Linux)
+  Future<DedupRecord?> recordImage(
+    String filename,
+    String filePath, {
+    String? hash,
+    String shard = '',
+  }) async {
+    if (!Platform.isLinux) return null;
+    try {
+      final Map<dynamic, dynamic> result = await _channel.invokeMethod(
+        'recordImage',
+        {
+          'name': filename,
+          'path': filePath,
+          if (hash != null) 'hash': hash,
+          'shard': shard,
+        },
+      );
+      return DedupRecord.fromMap(result);
+    } on MissingPluginException {
+      return null;
+    } on PlatformException catch (e) {
+      print("Failed to record image in dedup index: '${e.message}'");
+      return null;
+    }
+  }
+
+  /// Note in the native dedup index that images moved to new shards
+  /// [shards] maps each image name to its new directory under the images
+  /// folder. Returns how many recorded images were updated, null where the
+  /// index is not available (non-Linux)
+  Future<int?> moveImages(Map<String, String> shards) async {
+    if (!Platform.isLinux) return null;
+    try {
+      final int moved = await _channel.invokeMethod('moveImages', {
+        'shards': shards,
+      });
+      return moved;
+    } on MissingPluginException {
+      return null;
+    } on PlatformException catch (e) {
+      print("Failed to update dedup index: '${e.message}'");
+      return null;
+    }
+  }
+}
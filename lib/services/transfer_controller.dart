@@ -0,0 +1,247 @@
+import 'dart:async';
+import 'dart:math' as math;
+
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import '../models/link_quality.dart';
+import '../models/transfer_limits.dart';
+
+final transferControllerProvider = Provider((ref) {
+  final controller = TransferController();
+  ref.onDispose(controller.dispose);
+  return controller;
+});
+
+const int _mib = 1024 * 1024;
+
+/// Where a link starts and how far it may ramp
+class _LinkProfile {
+  final String name;
+  final TransferLimits initial;
+  final TransferLimits max;
+
+  const _LinkProfile(this.name, this.initial, this.max);
+}
+
+/// Wired, or anything reporting 500 Mb/s and up
+const _fast = _LinkProfile(
+  'fast',
+  TransferLimits(transfers: 4, connections: 4, chunkSize: 8 * _mib),
+  TransferLimits(transfers: 16, connections: 8, chunkSize: 16 * _mib),
+);
+
+/// Wi-Fi, or a link reporting 50-500 Mb/s
+const _medium = _LinkProfile(
+  'medium',
+  TransferLimits(transfers: 2, connections: 2, chunkSize: 4 * _mib),
+  TransferLimits(transfers: 8, connections: 4, chunkSize: 8 * _mib),
+);
+
+/// Mobile data, weak Wi-Fi, or a link under 50 Mb/s
+const _slow = _LinkProfile(
+  'slow',
+  TransferLimits(transfers: 1, connections: 1, chunkSize: 2 * _mib),
+  TransferLimits(transfers: 3, connections: 2, chunkSize: 4 * _mib),
+);
+
+/// Adjusts download parallelism to what the link can take (AIMD)
+///
+/// Limits start from a profile picked from the link type and, where the
+/// platform reports it, the link's measured capacity (see [setLink]). Finished
+/// downloads are reported through [recordTransfer] and grouped into windows
+/// of one round of [TransferLimits.transfers] downloads. Aggregate throughput
+/// is the window's bytes over the time at least one of its transfers was
+/// running, so gaps between images don't read as a slow link. After a window
+/// that kept or improved it, every limit goes up a step. A failed download,
+/// or a window whose per-transfer latency doubled without buying
+/// throughput, halves them instead, so a congested Wi-Fi link sheds load
+/// before requests start timing out.
+class TransferController {
+  /// Latency over the baseline, as a factor, that counts as congestion
+  static const double _latencyBackoffFactor = 2.0;
+
+  /// Images are small; below this size a transfer is mostly round trips
+  static const int _latencyFloorBytes = 256 * 1024;
+
+  static const int _minChunkSize = _mib;
+
+  String _linkType = 'none';
+  _LinkProfile _profile = _medium;
+  TransferLimits _limits = _medium.initial;
+
+  // Current window
+  /// Start and end of each successful transfer, in microseconds since epoch
+  final List<(int, int)> _windowBusy = [];
+  int _windowSamples = 0;
+  int _windowSuccesses = 0;
+  int _windowBytes = 0;
+  double _windowLatency = 0;
+  bool _windowFailed = false;
+
+  /// Best aggregate bytes per second seen in a window
+  double _bestThroughput = 0;
+
+  /// Lowest average ms per MiB seen in a window, null until measured
+  double? _baseLatency;
+
+  final StreamController<TransferLimits> _limitsController =
+      StreamController<TransferLimits>.broadcast();
+
+  /// Limits to apply to the next downloads
+  TransferLimits get limits => _limits;
+
+  /// Limits on every change
+  Stream<TransferLimits> get limitChanges => _limitsController.stream;
+
+  String get linkType => _linkType;
+
+  /// Reseed the limits when the link changes
+  /// [linkType] is `ethernet`, `wifi` or `mobile`; [quality] refines the
+  /// choice when known, so a 1 Gb/s cable and a weak 2.4 GHz link don't get
+  /// the same treatment. Measurements from the previous link are discarded.
+  /// Quality changes that keep the same profile are ignored.
+  void setLink(String linkType, [LinkQuality quality = LinkQuality.unknown]) {
+    final profile = _profileFor(linkType, quality);
+    if (linkType == _linkType && identical(profile, _profile)) return;
+    _linkType = linkType;
+    _profile = profile;
+    _bestThroughput = 0;
+    _baseLatency = null;
+    _resetWindow();
+    print('📶 Link is $linkType (${profile.name}), seeding transfer limits');
+    _apply(_profile.initial);
+  }
+
+  static _LinkProfile _profileFor(String linkType, LinkQuality quality) {
+    final capacity = quality.capacityMbps;
+    if (quality.isWeakSignal || (capacity != null && capacity < 50)) {
+      return _slow;
+    }
+    if (capacity != null) return capacity >= 500 ? _fast : _medium;
+    return switch (linkType) {
+      'ethernet' => _fast,
+      'mobile' => _slow,
+      _ => _medium,
+    };
+  }
+
+  /// Report a finished download
+  /// [bytes] and [elapsed] cover the network transfer only. Failures and
+  /// timeouts are reported with [success] false.
+  void recordTransfer({
+    required int bytes,
+    required Duration elapsed,
+    required bool success,
+  }) {
+    _windowSamples++;
+
+    if (success) {
+      final end = DateTime.now().microsecondsSinceEpoch;
+      _windowBusy.add((end - elapsed.inMicroseconds, end));
+      _windowSuccesses++;
+      _windowBytes += bytes;
+      final mib = math.max(bytes, _latencyFloorBytes) / _mib;
+      _windowLatency += elapsed.inMicroseconds / 1000 / mib;
+    } else if (!_windowFailed) {
+      // Once per window: the other failures are likely the same event
+      _windowFailed = true;
+      _backOff('download failed');
+    }
+
+    if (_windowSamples >= _limits.transfers) {
+      _closeWindow();
+    }
+  }
+
+  void _closeWindow() {
+    final seconds = math.max(_busyMicroseconds() / 1e6, 0.001);
+    final throughput = _windowBytes / seconds;
+    final latency = _windowSuccesses > 0
+        ? _windowLatency / _windowSuccesses
+        : 0.0;
+    final failed = _windowFailed || _windowSuccesses == 0;
+    _resetWindow();
+    if (failed) return;
+
+    final best = _bestThroughput;
+    final base = _baseLatency;
+    _bestThroughput = math.max(best, throughput);
+    // Let the baseline creep up so a link that got slower for good isn't
+    // treated as congested forever
+    _baseLatency = base == null ? latency : math.min(base * 1.1, latency);
+
+    if (base != null &&
+        latency > base * _latencyBackoffFactor &&
+        throughput < best * 1.05) {
+      _backOff(
+        'latency ${latency.round()} ms/MiB, baseline ${base.round()} ms/MiB',
+      );
+    } else if (throughput >= best * 0.9) {
+      _increase();
+    } else {
+      // Hold, and forget the old best slowly so probing resumes
+      _bestThroughput *= 0.9;
+    }
+  }
+
+  /// Length of the union of the window's transfers
+  int _busyMicroseconds() {
+    _windowBusy.sort((a, b) => a.$1.compareTo(b.$1));
+    var busy = 0;
+    int? start;
+    var end = 0;
+    for (final (spanStart, spanEnd) in _windowBusy) {
+      if (start == null || spanStart > end) {
+        if (start != null) busy += end - start;
+        start = spanStart;
+        end = spanEnd;
+      } else {
+        end = math.max(end, spanEnd);
+      }
+    }
+    if (start != null) busy += end - start;
+    return busy;
+  }
+
+  void _increase() {
+    final max = _profile.max;
+    _apply(
+      TransferLimits(
+        transfers: math.min(_limits.transfers + 1, max.transfers),
+        connections: math.min(_limits.connections + 1, max.connections),
+        chunkSize: math.min(_limits.chunkSize * 2, max.chunkSize),
+      ),
+    );
+  }
+
+  void _backOff(String reason) {
+    print('📉 Backing off downloads: $reason');
+    _apply(
+      TransferLimits(
+        transfers: math.max(_limits.transfers ~/ 2, 1),
+        connections: math.max(_limits.connections ~/ 2, 1),
+        chunkSize: math.max(_limits.chunkSize ~/ 2, _minChunkSize),
+      ),
+    );
+  }
+
+  void _apply(TransferLimits limits) {
+    if (limits == _limits) return;
+    _limits = limits;
+    print('⚙️ $limits');
+    if (!_limitsController.isClosed) _limitsController.add(limits);
+  }
+
+  void _resetWindow() {
+    _windowBusy.clear();
+    _windowSamples = 0;
+    _windowSuccesses = 0;
+    _windowBytes = 0;
+    _windowLatency = 0;
+    _windowFailed = false;
+  }
+
+  /// Dispose resources
+  void dispose() {
+    _limitsController.close();
+  }
+}
@@ -0,0 +1,324 @@
+// Benchmarks for the native network service hot path.
+//
+// Every benchmark runs against a synthetic sysfs tree and a synthetic
+// getifaddrs() list with 1, 50 or 1000 interfaces (one Ethernet, one Wi-Fi,
+// the rest container veths), plus a *_Host variant on the real machine.
+// BM_GetNetworkTypeCellular checks the classification of a host whose only
+// uplink is a PPP modem.
+// Besides time, each reports "syscalls/call", counted by ptrace-ing a forked
+// copy of the benchmark body.
+
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "runner/netlink_monitor_linux.h"
+#include "runner/network_event_codec.h"
+#include "runner/network_service_linux.h"
+#include "runner/network_status_page.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// A fake /sys/class/net plus the matching getifaddrs() list.
+class SyntheticHost {
+public:
+    explicit SyntheticHost(int interface_count) : SyntheticHost() {
+        for (int i = 0; i < interface_count; ++i) {
+            if (i == 0) {
+                AddInterface("eth0", /*is_virtual=*/false, /*is_wireless=*/false);
+            } else if (i == 1) {
+                AddInterface("wlan0", false, true);
+            } else {
+                AddInterface("veth" + std::to_string(i), true, false);
+            }
+        }
+        Link();
+    }
+
+    // A cellular modem's PPP session as the only uplink, a VPN tunnel over
+    // it and a container bridge. All three are virtual devices.
+    static std::unique_ptr<SyntheticHost> Cellular() {
+        std::unique_ptr<SyntheticHost> host(new SyntheticHost());
+        host->AddInterface("ppp0", true, false, ARPHRD_PPP, IFF_POINTOPOINT);
+        host->AddInterface("tun0", true, false, ARPHRD_NONE, IFF_POINTOPOINT);
+        host->AddInterface("docker0", true, false);
+        host->Link();
+        return host;
+    }
+
+    ~SyntheticHost() {
+        std::error_code ec;
+        fs::remove_all(root_, ec);
+    }
+
+    const std::string& root() const { return root_; }
+    const struct ifaddrs* interfaces() const { return entries_.empty() ? nullptr : &entries_[0]; }
+
+private:
+    SyntheticHost() {
+        char dir_template[] = "/tmp/network_service_benchmark.XXXXXX";
+        root_ = mkdtemp(dir_template);
+    }
+
+    struct Interface {
+        std::string name;
+        unsigned int flags;
+        struct sockaddr_ll link;
+        struct sockaddr_in address;
+    };
+
+    void AddInterface(const std::string& name, bool is_virtual, bool is_wireless,
+                      int arphrd_type = ARPHRD_ETHER, unsigned int flags = 0) {
+        std::string device = root_ + (is_virtual ? "/devices/virtual/net/"
+                                                 : "/devices/pci0000:00/net/") + name;
+        fs::create_directories(device);
+        std::ofstream(device + "/type") << arphrd_type << "\n";
+        std::ofstream(device + "/operstate") << "up\n";
+        std::ofstream(device + "/speed") << (is_wireless ? "-1\n" : "1000\n");
+        std::ofstream(device + "/duplex") << (is_wireless ? "unknown\n" : "full\n");
+        std::ofstream(device + "/mtu") << "1500\n";
+        if (is_wireless) {
+            fs::create_directories(device + "/wireless");
+        }
+        fs::create_directories(root_ + "/class/net");
+        fs::create_symlink(is_virtual ? "../../devices/virtual/net/" + name
+                                      : "../../devices/pci0000:00/net/" + name,
+                           root_ + "/class/net/" + name);
+
+        auto interface = std::make_unique<Interface>();
+        interface->name = name;
+        interface->flags = IFF_UP | IFF_RUNNING | flags;
+        memset(&interface->link, 0, sizeof(interface->link));
+        interface->link.sll_family = AF_PACKET;
+        interface->link.sll_ifindex = static_cast<int>(interfaces_.size()) + 2;
+        memset(&interface->address, 0, sizeof(interface->address));
+        interface->address.sin_family = AF_INET;
+        interface->address.sin_addr.s_addr = htonl(0x0A000000u + interfaces_.size() + 2);
+        interfaces_.push_back(std::move(interface));
+    }
+
+    // Lays the list out like glibc does: every AF_PACKET entry, then every
+    // address entry.
+    void Link() {
+        for (const auto& interface : interfaces_) {
+            struct ifaddrs entry = {};
+            entry.ifa_name = const_cast<char*>(interface->name.c_str());
+            entry.ifa_flags = interface->flags;
+            entry.ifa_addr = reinterpret_cast<struct sockaddr*>(&interface->link);
+            entries_.push_back(entry);
+        }
+        for (const auto& interface : interfaces_) {
+            struct ifaddrs entry = {};
+            entry.ifa_name = const_cast<char*>(interface->name.c_str());
+            entry.ifa_flags = interface->flags;
+            entry.ifa_addr = reinterpret_cast<struct sockaddr*>(&interface->address);
+            entries_.push_back(entry);
+        }
+        for (size_t i = 0; i + 1 < entries_.size(); ++i) {
+            entries_[i].ifa_next = &entries_[i + 1];
+        }
+    }
+
+    std::string root_;
+    std::vector<std::unique_ptr<Interface>> interfaces_;
+    std::vector<struct ifaddrs> entries_;
+};
+
+// Counts the system calls made by |body| by running it |iterations| times in
+// a forked child under PTRACE_SYSCALL, minus the cost of an empty run.
+// Returns -1 when ptrace is not permitted (e.g. some containers).
+double CountSyscallsPerCall(const std::function<void()>& body, int iterations) {
+    auto trace = [](const std::function<void()>& fn, int count) -> long {
+        pid_t child = fork();
+        if (child == 0) {
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            raise(SIGSTOP);
+            for (int i = 0; i < count; ++i) fn();
+            _exit(0);
+        }
+        if (child < 0) return -1;
+
+        int status;
+        waitpid(child, &status, 0);
+        if (!WIFSTOPPED(status)) return -1;
+        ptrace(PTRACE_SETOPTIONS, child, nullptr,
+               reinterpret_cast<void*>(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+
+        long stops = 0;
+        while (true) {
+            if (ptrace(PTRACE_SYSCALL, child, nullptr, nullptr) == -1) break;
+            if (waitpid(child, &status, 0) == -1 || WIFEXITED(status) || WIFSIGNALED(status)) break;
+            if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80)) ++stops;
+        }
+        return stops / 2;  // one stop on entry, one on exit
+    };
+
+    long baseline = trace([] {}, iterations);
+    long measured = trace(body, iterations);
+    if (baseline < 0 || measured < 0) return -1;
+    return static_cast<double>(measured - baseline) / iterations;
+}
+
+// ptrace results per benchmark and argument, so repeated runs don't re-trace.
+void ReportSyscalls(benchmark::State& state, const std::string& key,
+                    const std::function<void()>& body) {
+    static std::map<std::string, double> cache;
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        it = cache.emplace(key, CountSyscallsPerCall(body, 50)).first;
+    }
+    state.counters["syscalls/call"] = it->second;
+}
+
+SyntheticHost& HostWith(int interface_count) {
+    static std::map<int, std::unique_ptr<SyntheticHost>> hosts;
+    auto& host = hosts[interface_count];
+    if (!host) {
+        host = std::make_unique<SyntheticHost>(interface_count);
+    }
+    NetworkServiceLinux::SetSysfsRoot(host->root());
+    return *host;
+}
+
+// GetNetworkType() on a warm classification cache: the steady state of a
+// running monitor.
+void BM_GetNetworkType(benchmark::State& state) {
+    SyntheticHost& host = HostWith(static_cast<int>(state.range(0)));
+    NetworkServiceLinux::ClearInterfaceCache();
+    auto body = [&] {
+        benchmark::DoNotOptimize(NetworkServiceLinux::BuildSnapshot(host.interfaces()).network_type);
+    };
+    body();
+    for (auto _ : state) body();
+    ReportSyscalls(state, "BM_GetNetworkType/" + std::to_string(state.range(0)), body);
+}
+BENCHMARK(BM_GetNetworkType)->Arg(1)->Arg(50)->Arg(1000);
+
+// GetNetworkType() with an empty cache, i.e. after every interface changed.
+void BM_GetNetworkTypeColdCache(benchmark::State& state) {
+    SyntheticHost& host = HostWith(static_cast<int>(state.range(0)));
+    auto body = [&] {
+        NetworkServiceLinux::ClearInterfaceCache();
+        benchmark::DoNotOptimize(NetworkServiceLinux::BuildSnapshot(host.interfaces()).network_type);
+    };
+    for (auto _ : state) body();
+    ReportSyscalls(state, "BM_GetNetworkTypeColdCache/" + std::to_string(state.range(0)), body);
+}
+BENCHMARK(BM_GetNetworkTypeColdCache)->Arg(1)->Arg(50)->Arg(1000);
+
+// ppp0 has to come out as a connected mobile link, the tunnel and the bridge
+// as nothing of their own.
+void BM_GetNetworkTypeCellular(benchmark::State& state) {
+    static std::unique_ptr<SyntheticHost> host = SyntheticHost::Cellular();
+    NetworkServiceLinux::SetSysfsRoot(host->root());
+    NetworkServiceLinux::ClearInterfaceCache();
+    NetworkSnapshot snapshot = NetworkServiceLinux::BuildSnapshot(host->interfaces());
+    if (!snapshot.is_connected || snapshot.network_type != "mobile" ||
+        snapshot.interfaces.size() != 1 || snapshot.interfaces[0].name != "ppp0") {
+        state.SkipWithError("ppp0 is not classified as a connected mobile link");
+        return;
+    }
+    auto body = [&] {
+        benchmark::DoNotOptimize(NetworkServiceLinux::BuildSnapshot(host->interfaces()).network_type);
+    };
+    for (auto _ : state) body();
+}
+BENCHMARK(BM_GetNetworkTypeCellular);
+
+void BM_IsConnected(benchmark::State& state) {
+    SyntheticHost& host = HostWith(static_cast<int>(state.range(0)));
+    NetworkServiceLinux::ClearInterfaceCache();
+    auto body = [&] {
+        benchmark::DoNotOptimize(NetworkServiceLinux::BuildSnapshot(host.interfaces()).is_connected);
+    };
+    body();
+    for (auto _ : state) body();
+    ReportSyscalls(state, "BM_IsConnected/" + std::to_string(state.range(0)), body);
+}
+BENCHMARK(BM_IsConnected)->Arg(1)->Arg(50)->Arg(1000);
+
+// One wakeup of NetworkMonitorLinux: drain netlink, snapshot, probe link
+// quality (sysfs only; nl80211 needs real hardware), compare, and on a change
+// publish the status page and encode the event. Every other
+// iteration flips the state so both paths are exercised.
+void BM_MonitorTick(benchmark::State& state) {
+    SyntheticHost& host = HostWith(static_cast<int>(state.range(0)));
+    NetworkServiceLinux::ClearInterfaceCache();
+    NetlinkMonitorLinux netlink;
+    netlink.Open();
+    NetworkSnapshot last;
+    bool flip = false;
+    auto body = [&] {
+        netlink.DrainEvents();
+        NetworkSnapshot current = NetworkServiceLinux::BuildSnapshot(host.interfaces());
+        for (auto& interface : current.interfaces) {
+            if (interface.is_up) {
+                interface.quality = NetworkServiceLinux::ReadLinkQuality(interface.name);
+            }
+        }
+        if (flip) current.network_type = "none";
+        flip = !flip;
+        if (!current.SameStateAs(last)) {
+            current.generation = PublishNetworkStatusPage(current);
+            uint8_t payload[kNetworkEventSize];
+            EncodeNetworkEvent(current, payload);
+            benchmark::DoNotOptimize(payload);
+            last = current;
+        }
+    };
+    body();
+    for (auto _ : state) body();
+    ReportSyscalls(state, "BM_MonitorTick/" + std::to_string(state.range(0)), body);
+}
+BENCHMARK(BM_MonitorTick)->Arg(1)->Arg(50)->Arg(1000);
+
+// The real thing on this machine, including getifaddrs().
+void BM_GetNetworkType_Host(benchmark::State& state) {
+    NetworkServiceLinux::SetSysfsRoot("/sys");
+    NetworkServiceLinux::ClearInterfaceCache();
+    auto body = [] {
+        benchmark::DoNotOptimize(NetworkServiceLinux::GetNetworkType());
+    };
+    body();
+    for (auto _ : state) body();
+    ReportSyscalls(state, "BM_GetNetworkType_Host", body);
+}
+BENCHMARK(BM_GetNetworkType_Host);
+
+void BM_IsConnected_Host(benchmark::State& state) {
+    NetworkServiceLinux::SetSysfsRoot("/sys");
+    NetworkServiceLinux::ClearInterfaceCache();
+    auto body = [] {
+        benchmark::DoNotOptimize(NetworkServiceLinux::IsConnected());
+    };
+    body();
+    for (auto _ : state) body();
+    ReportSyscalls(state, "BM_IsConnected_Host", body);
+}
+BENCHMARK(BM_IsConnected_Host);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,14 @@
+#include "app_data_linux.h"
+#include <cstdlib>
+
+std::string AppDataPath(const char* application_id, const char* file_name) {
+    const char* data_home = getenv("XDG_DATA_HOME");
+    std::string base;
+    if (data_home != nullptr && data_home[0] != '\0') {
+        base = data_home;
+    } else {
+        const char* home = getenv("HOME");
+        base = std::string(home != nullptr ? home : ".") + "/.local/share";
+    }
+    return base + "/" + application_id + "/" + file_name;
+}
@@ -0,0 +1,11 @@
+#ifndef APP_DATA_LINUX_H_
+#define APP_DATA_LINUX_H_
+
+#include <string>
+
+// Path of |file_name| in the runner's data directory:
+// $XDG_DATA_HOME/<application id>/, else ~/.local/share/<application id>/.
+// The directory itself is created by whoever opens the file.
+std::string AppDataPath(const char* application_id, const char* file_name);
+
+#endif  // APP_DATA_LINUX_H_
@@ -0,0 +1,397 @@
+#include "archive_extractor_linux.h"
+#include "storage_space_linux.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zstd.h>
+
+namespace {
+
+constexpr size_t kBlockSize = 512;
+constexpr uint8_t kZstdMagic[4] = {0x28, 0xB5, 0x2F, 0xFD};
+// GNU long names and pax records are a few hundred bytes in practice.
+constexpr int64_t kMaxExtendedSize = 64 * 1024;
+
+// Header field offsets and sizes (POSIX ustar).
+constexpr size_t kNameOffset = 0;
+constexpr size_t kNameSize = 100;
+constexpr size_t kSizeOffset = 124;
+constexpr size_t kSizeSize = 12;
+constexpr size_t kChecksumOffset = 148;
+constexpr size_t kChecksumSize = 8;
+constexpr size_t kTypeOffset = 156;
+constexpr size_t kMagicOffset = 257;
+constexpr size_t kPrefixOffset = 345;
+constexpr size_t kPrefixSize = 155;
+
+std::string Field(const uint8_t* header, size_t offset, size_t size) {
+    const char* start = reinterpret_cast<const char*>(header + offset);
+    return std::string(start, strnlen(start, size));
+}
+
+// Octal, space or NUL terminated; or base-256 (GNU) when the top bit is set.
+bool ParseNumber(const uint8_t* field, size_t size, int64_t* value) {
+    if (field[0] & 0x80) {
+        if (field[0] != 0x80) {
+            return false;  // negative or too large
+        }
+        int64_t result = 0;
+        for (size_t i = 1; i < size; ++i) {
+            if (result > (INT64_MAX >> 8)) return false;
+            result = (result << 8) | field[i];
+        }
+        *value = result;
+        return true;
+    }
+    size_t i = 0;
+    while (i < size && field[i] == ' ') ++i;
+    int64_t result = 0;
+    bool digits = false;
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i) {
+        if (result > (INT64_MAX >> 3)) return false;
+        result = (result << 3) | (field[i] - '0');
+        digits = true;
+    }
+    if (i < size && field[i] != ' ' && field[i] != '\0') {
+        return false;
+    }
+    *value = result;
+    return digits;
+}
+
+bool IsZeroBlock(const uint8_t* block) {
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        if (block[i] != 0) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+ArchiveExtractorLinux::ArchiveExtractorLinux(const std::string& directory)
+    : directory_(directory),
+      out_of_space_(false),
+      magic_size_(0),
+      detected_(false),
+      zstd_(nullptr),
+      zstd_frame_done_(true),
+      state_(State::kHeader),
+      header_size_(0),
+      remaining_(0),
+      padding_(0),
+      fd_(-1) {}
+
+ArchiveExtractorLinux::~ArchiveExtractorLinux() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    if (zstd_ != nullptr) {
+        ZSTD_freeDCtx(zstd_);
+    }
+}
+
+bool ArchiveExtractorLinux::Feed(const char* data, size_t length) {
+    if (!error_.empty()) {
+        return false;
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+
+    if (!detected_) {
+        size_t take = std::min(length, sizeof(magic_) - magic_size_);
+        memcpy(magic_ + magic_size_, bytes, take);
+        magic_size_ += take;
+        bytes += take;
+        length -= take;
+        if (magic_size_ < sizeof(magic_)) {
+            return true;
+        }
+        detected_ = true;
+        if (memcmp(magic_, kZstdMagic, sizeof(kZstdMagic)) == 0) {
+            zstd_ = ZSTD_createDCtx();
+            if (zstd_ == nullptr) {
+                return Fail("cannot create zstd context");
+            }
+            zstd_output_.resize(ZSTD_DStreamOutSize());
+            if (!Decompress(magic_, sizeof(magic_))) {
+                return false;
+            }
+        } else if (!FeedTar(magic_, sizeof(magic_))) {
+            return false;
+        }
+    }
+
+    if (length == 0) {
+        return true;
+    }
+    return zstd_ != nullptr ? Decompress(bytes, length) : FeedTar(bytes, length);
+}
+
+bool ArchiveExtractorLinux::Decompress(const uint8_t* data, size_t length) {
+    ZSTD_inBuffer input = {data, length, 0};
+    // Drain the output even after the input is used up: a full output buffer
+    // may mean more is pending.
+    while (true) {
+        ZSTD_outBuffer output = {zstd_output_.data(), zstd_output_.size(), 0};
+        size_t result = ZSTD_decompressStream(zstd_, &output, &input);
+        if (ZSTD_isError(result)) {
+            return Fail(std::string("zstd: ") + ZSTD_getErrorName(result));
+        }
+        zstd_frame_done_ = result == 0;
+        if (output.pos > 0 && !FeedTar(zstd_output_.data(), output.pos)) {
+            return false;
+        }
+        if (input.pos == input.size && output.pos < output.size) {
+            return true;
+        }
+    }
+}
+
+bool ArchiveExtractorLinux::FeedTar(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        switch (state_) {
+            case State::kHeader: {
+                size_t take = std::min(length, kBlockSize - header_size_);
+                memcpy(header_ + header_size_, data, take);
+                header_size_ += take;
+                data += take;
+                length -= take;
+                if (header_size_ == kBlockSize) {
+                    header_size_ = 0;
+                    if (!ParseHeader()) {
+                        return false;
+                    }
+                }
+                break;
+            }
+            case State::kData:
+            case State::kSkip:
+            case State::kLongName:
+            case State::kPax: {
+                size_t take = static_cast<size_t>(
+                    std::min<int64_t>(remaining_, static_cast<int64_t>(length)));
+                if (state_ == State::kData && !WriteEntry(data, take)) {
+                    return false;
+                }
+                if (state_ == State::kLongName || state_ == State::kPax) {
+                    extended_.append(reinterpret_cast<const char*>(data), take);
+                }
+                data += take;
+                length -= take;
+                remaining_ -= static_cast<int64_t>(take);
+                if (remaining_ > 0) {
+                    break;
+                }
+                if (state_ == State::kData && !EndEntry()) {
+                    return false;
+                }
+                if (state_ == State::kLongName) {
+                    next_name_ = extended_.substr(0, strnlen(extended_.c_str(), extended_.size()));
+                } else if (state_ == State::kPax) {
+                    ParsePax();
+                }
+                state_ = padding_ > 0 ? State::kPadding : State::kHeader;
+                break;
+            }
+            case State::kPadding: {
+                size_t take = static_cast<size_t>(
+                    std::min<int64_t>(padding_, static_cast<int64_t>(length)));
+                data += take;
+                length -= take;
+                padding_ -= static_cast<int64_t>(take);
+                if (padding_ == 0) {
+                    state_ = State::kHeader;
+                }
+                break;
+            }
+            case State::kEnd:
+                // Trailing zero blocks and record padding.
+                return true;
+        }
+    }
+    return true;
+}
+
+bool ArchiveExtractorLinux::ParseHeader() {
+    if (IsZeroBlock(header_)) {
+        state_ = State::kEnd;
+        return true;
+    }
+
+    int64_t checksum;
+    if (!ParseNumber(header_ + kChecksumOffset, kChecksumSize, &checksum)) {
+        return Fail("malformed tar header");
+    }
+    // The checksum field itself counts as spaces. Some old writers summed
+    // signed bytes, so accept either sum.
+    int64_t sum = 0;
+    int64_t signed_sum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        bool in_field = i >= kChecksumOffset && i < kChecksumOffset + kChecksumSize;
+        uint8_t byte = in_field ? ' ' : header_[i];
+        sum += byte;
+        signed_sum += static_cast<int8_t>(byte);
+    }
+    int64_t size;
+    if ((checksum != sum && checksum != signed_sum) ||
+        !ParseNumber(header_ + kSizeOffset, kSizeSize, &size)) {
+        return Fail("malformed tar header");
+    }
+
+    char type = static_cast<char>(header_[kTypeOffset]);
+    remaining_ = size;
+    padding_ = (kBlockSize - size % kBlockSize) % kBlockSize;
+
+    if (type == 'L' || type == 'x') {
+        if (size > kMaxExtendedSize) {
+            return Fail("tar extended header too large");
+        }
+        extended_.clear();
+        state_ = type == 'L' ? State::kLongName : State::kPax;
+        return true;
+    }
+
+    std::string name = next_name_;
+    next_name_.clear();
+    if (name.empty()) {
+        name = Field(header_, kNameOffset, kNameSize);
+        std::string prefix = Field(header_, kPrefixOffset, kPrefixSize);
+        if (memcmp(header_ + kMagicOffset, "ustar", 5) == 0 && !prefix.empty()) {
+            name = prefix + "/" + name;
+        }
+    }
+
+    bool regular = type == '0' || type == '\0' || type == '7';
+    if (!regular || !BeginEntry(name)) {
+        if (!error_.empty()) {
+            return false;
+        }
+        state_ = State::kSkip;
+    } else {
+        state_ = State::kData;
+    }
+    // An empty file has no data blocks.
+    if (remaining_ == 0) {
+        if (state_ == State::kData && !EndEntry()) {
+            return false;
+        }
+        state_ = State::kHeader;
+    }
+    return true;
+}
+
+// Returns false without setting an error for entries that are skipped.
+bool ArchiveExtractorLinux::BeginEntry(const std::string& name) {
+    std::string base = name;
+    while (!base.empty() && base.back() == '/') {
+        base.pop_back();
+    }
+    size_t slash = base.rfind('/');
+    if (slash != std::string::npos) {
+        base = base.substr(slash + 1);
+    }
+    // Hidden names would collide with the staging files.
+    if (base.empty() || base[0] == '.') {
+        return false;
+    }
+
+    current_ = ExtractedEntry();
+    current_.name = base;
+    current_.path = directory_ + "/." + base + ".partial";
+    // A journal left by an interrupted single download of this image would
+    // describe the file about to be replaced.
+    unlink((current_.path + ".journal").c_str());
+    fd_ = open(current_.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return Fail("cannot create " + current_.path + ": " + strerror(errno));
+    }
+    if (!StorageSpaceLinux::Preallocate(fd_, remaining_)) {
+        out_of_space_ = true;
+        return Fail("not enough free space for " + base);
+    }
+    hasher_.Reset();
+    return true;
+}
+
+bool ArchiveExtractorLinux::WriteEntry(const uint8_t* data, size_t length) {
+    hasher_.Update(data, length);
+    current_.size += static_cast<int64_t>(length);
+    while (length > 0) {
+        ssize_t written = write(fd_, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            out_of_space_ = StorageSpaceLinux::IsOutOfSpace(errno);
+            return Fail("write failed: " + std::string(strerror(errno)));
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool ArchiveExtractorLinux::EndEntry() {
+    int result = close(fd_);
+    fd_ = -1;
+    if (result != 0) {
+        unlink(current_.path.c_str());
+        return Fail("close failed: " + std::string(strerror(errno)));
+    }
+    current_.content_hash = hasher_.Digest();
+    entries_.push_back(current_);
+    return true;
+}
+
+// Records are "<length> <key>=<value>\n"; only the path matters here.
+void ArchiveExtractorLinux::ParsePax() {
+    size_t position = 0;
+    while (position < extended_.size()) {
+        size_t space = extended_.find(' ', position);
+        if (space == std::string::npos) {
+            return;
+        }
+        size_t length = strtoul(extended_.c_str() + position, nullptr, 10);
+        if (length <= space - position || position + length > extended_.size()) {
+            return;
+        }
+        std::string record = extended_.substr(space + 1, position + length - space - 2);
+        if (record.compare(0, 5, "path=") == 0) {
+            next_name_ = record.substr(5);
+        }
+        position += length;
+    }
+}
+
+bool ArchiveExtractorLinux::Finish() {
+    if (!error_.empty()) {
+        return false;
+    }
+    if (!detected_ || (zstd_ != nullptr && !zstd_frame_done_)) {
+        return Fail("archive truncated");
+    }
+    // Tolerate writers that stop without the closing zero blocks, but not
+    // a stream that stops inside an entry.
+    if (state_ != State::kEnd && (state_ != State::kHeader || header_size_ != 0)) {
+        return Fail("archive truncated");
+    }
+    return true;
+}
+
+void ArchiveExtractorLinux::Discard() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+        unlink(current_.path.c_str());
+    }
+    for (const ExtractedEntry& entry : entries_) {
+        unlink(entry.path.c_str());
+    }
+    entries_.clear();
+}
+
+bool ArchiveExtractorLinux::Fail(const std::string& error) {
+    if (error_.empty()) {
+        error_ = error;
+    }
+    return false;
+}
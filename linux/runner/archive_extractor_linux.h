@@ -0,0 +1,94 @@
+#ifndef ARCHIVE_EXTRACTOR_LINUX_H_
+#define ARCHIVE_EXTRACTOR_LINUX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "content_hash.h"
+
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+
+struct ExtractedEntry {
+    // File name from the archive, without any directory part.
+    std::string name;
+    // Where it was written: the hidden ".<name>.partial" in the target
+    // directory, the same staging name single downloads use.
+    std::string path;
+    int64_t size = 0;
+    // XXH64 of the content (see content_hash.h).
+    uint64_t content_hash = 0;
+};
+
+// Unpacks a tar stream into a directory as it arrives, without holding the
+// archive anywhere.
+//
+// The stream may be zstd-compressed; that is detected from its first bytes.
+// Regular files are preallocated from their header's size, then written
+// sequentially and hashed on the way in. Only the
+// last path component of an entry name is used, and directories, links,
+// devices and hidden names are skipped, so an archive can't write outside
+// the directory. GNU long names and pax "path" records are understood.
+class ArchiveExtractorLinux {
+public:
+    explicit ArchiveExtractorLinux(const std::string& directory);
+    ~ArchiveExtractorLinux();
+
+    // Takes the next bytes of the stream. Returns false on a malformed
+    // archive or a write error; error() says which.
+    bool Feed(const char* data, size_t length);
+
+    // Call at the end of the stream. Returns false if it ended mid-entry.
+    bool Finish();
+
+    // Removes every file written so far, e.g. after a failed transfer.
+    void Discard();
+
+    const std::vector<ExtractedEntry>& entries() const { return entries_; }
+    const std::string& error() const { return error_; }
+    // Whether the failure was the filesystem running out of space.
+    bool out_of_space() const { return out_of_space_; }
+
+private:
+    enum class State { kHeader, kData, kSkip, kPadding, kLongName, kPax, kEnd };
+
+    bool Decompress(const uint8_t* data, size_t length);
+    bool FeedTar(const uint8_t* data, size_t length);
+    bool ParseHeader();
+    bool BeginEntry(const std::string& name);
+    bool WriteEntry(const uint8_t* data, size_t length);
+    bool EndEntry();
+    void ParsePax();
+    bool Fail(const std::string& error);
+
+    std::string directory_;
+    std::string error_;
+    bool out_of_space_;
+
+    // Bytes seen before the format is known (the zstd magic is 4 bytes).
+    uint8_t magic_[4];
+    size_t magic_size_;
+    bool detected_;
+    ZSTD_DCtx* zstd_;
+    std::vector<uint8_t> zstd_output_;
+    // Whether the last zstd frame was complete.
+    bool zstd_frame_done_;
+
+    State state_;
+    uint8_t header_[512];
+    size_t header_size_;
+    // Data bytes left in the current entry, then padding to the next block.
+    int64_t remaining_;
+    int64_t padding_;
+    // Name for the next entry, from a GNU long-name or pax record.
+    std::string next_name_;
+    std::string extended_;
+
+    int fd_;
+    ExtractedEntry current_;
+    ContentHasher hasher_;
+    std::vector<ExtractedEntry> entries_;
+};
+
+#endif  // ARCHIVE_EXTRACTOR_LINUX_H_
@@ -0,0 +1,227 @@
+#include "content_hash.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Unaligned little-endian loads; compiles to a single mov on x86/arm64.
+inline uint64_t Read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t Round(uint64_t lane, uint64_t input) {
+    lane += input * kPrime2;
+    lane = RotateLeft(lane, 31);
+    return lane * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t hash, uint64_t lane) {
+    hash ^= Round(0, lane);
+    return hash * kPrime1 + kPrime4;
+}
+
+// Consumes whole 32-byte stripes; the four lanes are independent, which is
+// what lets this keep up with memory bandwidth.
+const uint8_t* ConsumeStripes(uint64_t* lanes, const uint8_t* p, const uint8_t* end) {
+    uint64_t v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+    while (p + 32 <= end) {
+        v1 = Round(v1, Read64(p));
+        v2 = Round(v2, Read64(p + 8));
+        v3 = Round(v3, Read64(p + 16));
+        v4 = Round(v4, Read64(p + 24));
+        p += 32;
+    }
+    lanes[0] = v1;
+    lanes[1] = v2;
+    lanes[2] = v3;
+    lanes[3] = v4;
+    return p;
+}
+
+}  // namespace
+
+ContentHasher::ContentHasher(uint64_t seed) {
+    Reset(seed);
+}
+
+void ContentHasher::Reset(uint64_t seed) {
+    seed_ = seed;
+    lanes_[0] = seed + kPrime1 + kPrime2;
+    lanes_[1] = seed + kPrime2;
+    lanes_[2] = seed;
+    lanes_[3] = seed - kPrime1;
+    buffered_ = 0;
+    total_length_ = 0;
+}
+
+void ContentHasher::Update(const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + length;
+    total_length_ += length;
+
+    if (buffered_ + length < sizeof(buffer_)) {
+        memcpy(buffer_ + buffered_, p, length);
+        buffered_ += length;
+        return;
+    }
+
+    if (buffered_ > 0) {
+        size_t fill = sizeof(buffer_) - buffered_;
+        memcpy(buffer_ + buffered_, p, fill);
+        ConsumeStripes(lanes_, buffer_, buffer_ + sizeof(buffer_));
+        p += fill;
+        buffered_ = 0;
+    }
+
+    p = ConsumeStripes(lanes_, p, end);
+    buffered_ = static_cast<size_t>(end - p);
+    memcpy(buffer_, p, buffered_);
+}
+
+uint64_t ContentHasher::Digest() const {
+    uint64_t hash;
+    if (total_length_ >= 32) {
+        hash = RotateLeft(lanes_[0], 1) + RotateLeft(lanes_[1], 7) +
+               RotateLeft(lanes_[2], 12) + RotateLeft(lanes_[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            hash = MergeRound(hash, lanes_[i]);
+        }
+    } else {
+        hash = seed_ + kPrime5;
+    }
+    hash += total_length_;
+
+    const uint8_t* p = buffer_;
+    const uint8_t* end = buffer_ + buffered_;
+    while (p + 8 <= end) {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+        hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= (*p) * kPrime5;
+        hash = RotateLeft(hash, 11) * kPrime1;
+        ++p;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+ContentHasher::State ContentHasher::SaveState() const {
+    State state;
+    memcpy(state.lanes, lanes_, sizeof(lanes_));
+    memcpy(state.buffer, buffer_, sizeof(buffer_));
+    state.buffered = buffered_;
+    state.total_length = total_length_;
+    state.seed = seed_;
+    return state;
+}
+
+bool ContentHasher::RestoreState(const State& state) {
+    if (state.buffered >= sizeof(buffer_) || state.buffered > state.total_length) {
+        return false;
+    }
+    memcpy(lanes_, state.lanes, sizeof(lanes_));
+    memcpy(buffer_, state.buffer, sizeof(buffer_));
+    buffered_ = static_cast<size_t>(state.buffered);
+    total_length_ = state.total_length;
+    seed_ = state.seed;
+    return true;
+}
+
+uint64_t ContentHasher::Hash(const void* data, size_t length, uint64_t seed) {
+    ContentHasher hasher(seed);
+    hasher.Update(data, length);
+    return hasher.Digest();
+}
+
+std::string FormatContentHash(uint64_t hash) {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+bool ParseContentHash(const std::string& text, uint64_t* hash) {
+    if (text.size() != 16) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (char c : text) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        value = (value << 4) | static_cast<uint64_t>(digit);
+    }
+    *hash = value;
+    return true;
+}
+
+bool HashFile(const std::string& path, uint64_t* hash, int64_t* size) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    ContentHasher hasher;
+    std::vector<uint8_t> buffer(1 << 20);
+    int64_t total = 0;
+    bool ok = true;
+    while (true) {
+        ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        if (n == 0) break;
+        hasher.Update(buffer.data(), static_cast<size_t>(n));
+        total += n;
+    }
+    close(fd);
+
+    if (ok) {
+        *hash = hasher.Digest();
+        *size = total;
+    }
+    return ok;
+}
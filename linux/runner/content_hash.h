@@ -0,0 +1,50 @@
+#ifndef CONTENT_HASH_H_
+#define CONTENT_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Streaming XXH64. Fast enough to run over every byte of every download and
+// stable across platforms, so digests can be stored and compared later.
+class ContentHasher {
+public:
+    explicit ContentHasher(uint64_t seed = 0);
+
+    void Reset(uint64_t seed = 0);
+    void Update(const void* data, size_t length);
+
+    // Digest of everything passed to Update() so far; more data may follow.
+    uint64_t Digest() const;
+
+    // Everything needed to carry on hashing later, e.g. after a restart.
+    // Plain data, safe to write to a file as is.
+    struct State {
+        uint64_t lanes[4];
+        uint8_t buffer[32];
+        uint64_t buffered;
+        uint64_t total_length;
+        uint64_t seed;
+    };
+    State SaveState() const;
+    // Returns false, leaving the hasher untouched, if |state| is inconsistent.
+    bool RestoreState(const State& state);
+
+    static uint64_t Hash(const void* data, size_t length, uint64_t seed = 0);
+
+private:
+    uint64_t lanes_[4];
+    uint8_t buffer_[32];
+    size_t buffered_;
+    uint64_t total_length_;
+    uint64_t seed_;
+};
+
+// 16 lowercase hex digits, as sent to and from Dart.
+std::string FormatContentHash(uint64_t hash);
+bool ParseContentHash(const std::string& text, uint64_t* hash);
+
+// Hashes a whole file. Returns false if it can't be read.
+bool HashFile(const std::string& path, uint64_t* hash, int64_t* size);
+
+#endif  // CONTENT_HASH_H_
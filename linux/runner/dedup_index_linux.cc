@@ -0,0 +1,413 @@
+#include "dedup_index_linux.h"
+#include "app_data_linux.h"
+#include "content_hash.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct DedupIndexLinux::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;
+    uint64_t count;
+    // Entries in the content table, including ones left behind when a name
+    // was re-recorded with different content.
+    uint64_t content_count;
+};
+
+struct DedupIndexLinux::Slot {
+    // XXH64 of the full name; 0 marks an empty slot and is written last.
+    uint64_t name_hash;
+    uint64_t content_hash;
+    int64_t size;
+    int64_t recorded_ms;
+    // Truncated copy, for reporting duplicates.
+    char name[96];
+    // Directory under the image folder, "" for the folder itself.
+    char shard[DedupIndexLinux::kMaxShardLength + 1];
+};
+
+// Slot layout of version 1 indexes, which predate shards.
+struct DedupIndexLinux::SlotV1 {
+    uint64_t name_hash;
+    uint64_t content_hash;
+    int64_t size;
+    int64_t recorded_ms;
+    char name[96];
+};
+
+namespace {
+
+constexpr char kMagic[8] = {'I', 'D', 'D', 'E', 'D', 'U', 'P', '1'};
+constexpr uint32_t kVersion = 2;
+constexpr uint64_t kInitialCapacity = 4096;
+
+size_t FileSizeFor(uint64_t capacity, size_t header_size, size_t slot_size) {
+    return header_size + capacity * slot_size + capacity * sizeof(uint32_t);
+}
+
+uint64_t NameHash(const std::string& name) {
+    uint64_t hash = ContentHasher::Hash(name.data(), name.size());
+    return hash == 0 ? 1 : hash;
+}
+
+// A relative path that stays inside the image folder.
+bool IsValidShard(const std::string& shard) {
+    if (shard.size() > DedupIndexLinux::kMaxShardLength ||
+        (!shard.empty() && shard.front() == '/')) {
+        return false;
+    }
+    return ("/" + shard + "/").find("/../") == std::string::npos;
+}
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+DedupIndexLinux::DedupIndexLinux(const std::string& path)
+    : path_(path),
+      fd_(-1),
+      mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      slots_(nullptr),
+      content_slots_(nullptr) {}
+
+DedupIndexLinux::~DedupIndexLinux() {
+    Close();
+}
+
+bool DedupIndexLinux::Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ != nullptr) {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path_).parent_path(), ec);
+
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        Header header;
+        struct stat info;
+        bool valid = pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                     fstat(fd, &info) == 0 &&
+                     memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                     header.capacity >= kInitialCapacity &&
+                     (header.capacity & (header.capacity - 1)) == 0;
+        close(fd);
+        bool current = valid && header.version == kVersion &&
+                       header.slot_size == sizeof(Slot) &&
+                       static_cast<size_t>(info.st_size) ==
+                           FileSizeFor(header.capacity, sizeof(Header), sizeof(Slot));
+        bool version1 = valid && header.version == 1 && header.slot_size == sizeof(SlotV1) &&
+                        static_cast<size_t>(info.st_size) ==
+                            FileSizeFor(header.capacity, sizeof(Header), sizeof(SlotV1));
+        if (current && Map(path_, header.capacity, false)) {
+            return true;
+        }
+        if (version1 && Upgrade(header.capacity)) {
+            return true;
+        }
+        unlink(path_.c_str());
+    }
+    return Map(path_, kInitialCapacity, true);
+}
+
+void DedupIndexLinux::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Unmap();
+}
+
+bool DedupIndexLinux::Map(const std::string& path, uint64_t capacity, bool create) {
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t size = FileSizeFor(capacity, sizeof(Header), sizeof(Slot));
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    mapping_ = mapping;
+    mapping_size_ = size;
+    header_ = static_cast<Header*>(mapping);
+    slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+    content_slots_ = reinterpret_cast<uint32_t*>(slots_ + capacity);
+
+    if (create) {
+        // ftruncate() zero-filled the tables; only the header needs writing.
+        memcpy(header_->magic, kMagic, sizeof(kMagic));
+        header_->version = kVersion;
+        header_->slot_size = sizeof(Slot);
+        header_->capacity = capacity;
+        header_->count = 0;
+        header_->content_count = 0;
+    }
+    return true;
+}
+
+void DedupIndexLinux::Unmap() {
+    if (mapping_ != nullptr) {
+        msync(mapping_, mapping_size_, MS_ASYNC);
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    slots_ = nullptr;
+    content_slots_ = nullptr;
+}
+
+bool DedupIndexLinux::Grow() {
+    int old_fd = fd_;
+    void* old_mapping = mapping_;
+    size_t old_size = mapping_size_;
+    Slot* old_slots = slots_;
+    uint64_t old_capacity = header_->capacity;
+
+    // Build the bigger table next to the live one and swap it in with a
+    // rename, so a crash mid-way leaves the old index intact.
+    std::string rebuilt = path_ + ".tmp";
+    if (!Map(rebuilt, old_capacity * 2, true)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < old_capacity; ++i) {
+        if (old_slots[i].name_hash != 0) {
+            Reinsert(old_slots[i]);
+        }
+    }
+
+    bool renamed = msync(mapping_, mapping_size_, MS_SYNC) == 0 &&
+                   rename(rebuilt.c_str(), path_.c_str()) == 0;
+    if (!renamed) {
+        Unmap();
+        unlink(rebuilt.c_str());
+        fd_ = old_fd;
+        mapping_ = old_mapping;
+        mapping_size_ = old_size;
+        header_ = static_cast<Header*>(old_mapping);
+        slots_ = old_slots;
+        content_slots_ = reinterpret_cast<uint32_t*>(old_slots + old_capacity);
+        return false;
+    }
+
+    munmap(old_mapping, old_size);
+    close(old_fd);
+    return true;
+}
+
+bool DedupIndexLinux::Upgrade(uint64_t capacity) {
+    int old_fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (old_fd < 0) {
+        return false;
+    }
+    size_t old_size = FileSizeFor(capacity, sizeof(Header), sizeof(SlotV1));
+    void* old_mapping = mmap(nullptr, old_size, PROT_READ, MAP_SHARED, old_fd, 0);
+    close(old_fd);
+    if (old_mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // Same swap as Grow(): the version 1 file stays until the new one is
+    // complete. Every image recorded so far was saved unsharded.
+    std::string rebuilt = path_ + ".tmp";
+    bool upgraded = Map(rebuilt, capacity, true);
+    if (upgraded) {
+        const SlotV1* old_slots = reinterpret_cast<const SlotV1*>(
+            static_cast<const char*>(old_mapping) + sizeof(Header));
+        for (uint64_t i = 0; i < capacity; ++i) {
+            const SlotV1& old_slot = old_slots[i];
+            if (old_slot.name_hash == 0) continue;
+            Slot slot;
+            memset(&slot, 0, sizeof(slot));
+            slot.name_hash = old_slot.name_hash;
+            slot.content_hash = old_slot.content_hash;
+            slot.size = old_slot.size;
+            slot.recorded_ms = old_slot.recorded_ms;
+            memcpy(slot.name, old_slot.name, sizeof(slot.name));
+            Reinsert(slot);
+        }
+        upgraded = msync(mapping_, mapping_size_, MS_SYNC) == 0 &&
+                   rename(rebuilt.c_str(), path_.c_str()) == 0;
+        if (!upgraded) {
+            Unmap();
+            unlink(rebuilt.c_str());
+        }
+    }
+    munmap(old_mapping, old_size);
+    return upgraded;
+}
+
+void DedupIndexLinux::Reinsert(const Slot& old_slot) {
+    Slot* slot = InsertName(old_slot.name_hash);
+    *slot = old_slot;
+    header_->count++;
+    if (FindContent(slot->content_hash) == nullptr) {
+        InsertContent(slot->content_hash, static_cast<uint32_t>(slot - slots_));
+    }
+}
+
+DedupIndexLinux::Slot* DedupIndexLinux::FindName(uint64_t name_hash, const std::string& name) {
+    uint64_t mask = header_->capacity - 1;
+    for (uint64_t i = name_hash & mask;; i = (i + 1) & mask) {
+        Slot* slot = &slots_[i];
+        if (slot->name_hash == 0) {
+            return nullptr;
+        }
+        if (slot->name_hash == name_hash &&
+            strncmp(slot->name, name.c_str(), sizeof(slot->name) - 1) == 0) {
+            return slot;
+        }
+    }
+}
+
+DedupIndexLinux::Slot* DedupIndexLinux::InsertName(uint64_t name_hash) {
+    uint64_t mask = header_->capacity - 1;
+    uint64_t i = name_hash & mask;
+    while (slots_[i].name_hash != 0) {
+        i = (i + 1) & mask;
+    }
+    return &slots_[i];
+}
+
+const DedupIndexLinux::Slot* DedupIndexLinux::FindContent(uint64_t content_hash) {
+    uint64_t mask = header_->capacity - 1;
+    for (uint64_t i = content_hash & mask;; i = (i + 1) & mask) {
+        uint32_t entry = content_slots_[i];
+        if (entry == 0) {
+            return nullptr;
+        }
+        const Slot* slot = &slots_[entry - 1];
+        // Entries go stale when their name is re-recorded with other content.
+        if (slot->name_hash != 0 && slot->content_hash == content_hash) {
+            return slot;
+        }
+    }
+}
+
+void DedupIndexLinux::InsertContent(uint64_t content_hash, uint32_t slot_index) {
+    uint64_t mask = header_->capacity - 1;
+    uint64_t i = content_hash & mask;
+    while (content_slots_[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    content_slots_[i] = slot_index + 1;
+    header_->content_count++;
+}
+
+bool DedupIndexLinux::Contains(const std::string& name, int64_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ == nullptr) {
+        return false;
+    }
+    const Slot* slot = FindName(NameHash(name), name);
+    return slot != nullptr && (size <= 0 || slot->size == size);
+}
+
+bool DedupIndexLinux::Locate(const std::string& name, std::string* shard) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ == nullptr) {
+        return false;
+    }
+    const Slot* slot = FindName(NameHash(name), name);
+    if (slot == nullptr) {
+        return false;
+    }
+    *shard = slot->shard;
+    return true;
+}
+
+bool DedupIndexLinux::Record(const std::string& name, const std::string& shard, int64_t size,
+                             uint64_t content_hash, std::string* duplicate_of,
+                             std::string* duplicate_shard) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ == nullptr || !IsValidShard(shard)) {
+        return false;
+    }
+
+    // Keep both tables at most half full so probe sequences stay short.
+    uint64_t capacity = header_->capacity;
+    if ((header_->count + 1) * 2 > capacity || (header_->content_count + 1) * 2 > capacity) {
+        if (!Grow() && (header_->count + 1 >= capacity ||
+                        header_->content_count + 1 >= capacity)) {
+            return false;
+        }
+    }
+
+    uint64_t name_hash = NameHash(name);
+    const Slot* same_content = FindContent(content_hash);
+    if (same_content != nullptr &&
+        strncmp(same_content->name, name.c_str(), sizeof(same_content->name) - 1) != 0) {
+        *duplicate_of = same_content->name;
+        *duplicate_shard = same_content->shard;
+    }
+
+    Slot* slot = FindName(name_hash, name);
+    bool is_new = slot == nullptr;
+    if (is_new) {
+        slot = InsertName(name_hash);
+    }
+    slot->content_hash = content_hash;
+    slot->size = size;
+    slot->recorded_ms = NowMs();
+    strncpy(slot->name, name.c_str(), sizeof(slot->name) - 1);
+    slot->name[sizeof(slot->name) - 1] = '\0';
+    strncpy(slot->shard, shard.c_str(), sizeof(slot->shard) - 1);
+    slot->shard[sizeof(slot->shard) - 1] = '\0';
+    if (is_new) {
+        // Publish the slot only once it is complete.
+        __atomic_store_n(&slot->name_hash, name_hash, __ATOMIC_RELEASE);
+        header_->count++;
+    }
+
+    if (same_content == nullptr) {
+        InsertContent(content_hash, static_cast<uint32_t>(slot - slots_));
+    }
+
+    msync(mapping_, mapping_size_, MS_ASYNC);
+    return true;
+}
+
+bool DedupIndexLinux::Move(const std::string& name, const std::string& shard) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ == nullptr || !IsValidShard(shard)) {
+        return false;
+    }
+    Slot* slot = FindName(NameHash(name), name);
+    if (slot == nullptr) {
+        return false;
+    }
+    strncpy(slot->shard, shard.c_str(), sizeof(slot->shard) - 1);
+    slot->shard[sizeof(slot->shard) - 1] = '\0';
+    msync(mapping_, mapping_size_, MS_ASYNC);
+    return true;
+}
+
+size_t DedupIndexLinux::Count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_ != nullptr ? static_cast<size_t>(header_->count) : 0;
+}
+
+std::string DedupIndexLinux::DefaultPath(const char* application_id) {
+    return AppDataPath(application_id, "dedup.idx");
+}
@@ -0,0 +1,84 @@
+#ifndef DEDUP_INDEX_LINUX_H_
+#define DEDUP_INDEX_LINUX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Persistent record of every image saved, for "already have it?" checks.
+//
+// The index is a memory-mapped file holding an open-addressing hash table
+// keyed by server filename, plus a second table keyed by content hash so a
+// renamed copy of a known image is recognised too. Lookups are a few probes
+// in mapped memory and never touch the image folder. Writes go to the page
+// cache and survive an app crash; the table doubles when half full.
+//
+// Each record also keeps the image's shard, the directory under the image
+// folder it was saved in ("" for the folder itself, "2026/10/16" or "a7"
+// for the sharded layouts), so finding a saved image never lists a folder.
+class DedupIndexLinux {
+public:
+    explicit DedupIndexLinux(const std::string& path);
+    ~DedupIndexLinux();
+
+    // Maps the index file, creating it (and its directory) if needed. An
+    // index from before shards were recorded is upgraded in place; a file
+    // that fails validation is replaced by an empty index.
+    bool Open();
+    void Close();
+
+    // True if |name| was recorded, with the given size when |size| > 0.
+    bool Contains(const std::string& name, int64_t size);
+
+    // True if |name| was recorded; its shard is returned in |shard|.
+    bool Locate(const std::string& name, std::string* shard);
+
+    // Records |name|, saved in |shard|, with its size and content hash,
+    // replacing an older record of the same name. If other content-identical
+    // images were recorded under a different name, the earliest is returned
+    // in |duplicate_of| and its shard in |duplicate_shard|. Fails if |shard|
+    // is not a relative path of at most kMaxShardLength bytes.
+    bool Record(const std::string& name, const std::string& shard, int64_t size,
+                uint64_t content_hash, std::string* duplicate_of,
+                std::string* duplicate_shard);
+
+    // Notes that the image recorded as |name| moved to |shard|. False if
+    // |name| was never recorded or |shard| is invalid.
+    bool Move(const std::string& name, const std::string& shard);
+
+    size_t Count();
+
+    // Location used by the runner: $XDG_DATA_HOME/<application id>/dedup.idx
+    static std::string DefaultPath(const char* application_id);
+
+    static constexpr size_t kMaxShardLength = 15;
+
+private:
+    struct Header;
+    struct Slot;
+    struct SlotV1;
+
+    bool Map(const std::string& path, uint64_t capacity, bool create);
+    void Unmap();
+    bool Grow();
+    bool Upgrade(uint64_t capacity);
+    void Reinsert(const Slot& old_slot);
+    Slot* FindName(uint64_t name_hash, const std::string& name);
+    Slot* InsertName(uint64_t name_hash);
+    const Slot* FindContent(uint64_t content_hash);
+    void InsertContent(uint64_t content_hash, uint32_t slot_index);
+
+    std::string path_;
+    std::mutex mutex_;
+
+    int fd_;
+    void* mapping_;
+    size_t mapping_size_;
+    Header* header_;
+    Slot* slots_;
+    // slot index + 1 per entry, 0 when empty.
+    uint32_t* content_slots_;
+};
+
+#endif  // DEDUP_INDEX_LINUX_H_
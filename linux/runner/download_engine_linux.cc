@@ -0,0 +1,1047 @@
+#include "download_engine_linux.h"
+#include "content_hash.h"
+#include "download_journal_linux.h"
+#include "file_placement_linux.h"
+#include "network_service_linux.h"
+#include "storage_space_linux.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct DownloadEngineLinux::Job {
+    uint64_t id = 0;
+    DownloadRequest request;
+    int fd = -1;
+
+    // URL after redirects, so follow-up ranges skip the redirect round trip.
+    std::string effective_url;
+    // Object size from Content-Range, -1 until known.
+    int64_t total = -1;
+    // First byte not yet assigned to a transfer.
+    int64_t next_offset = 0;
+    int64_t bytes_written = 0;
+    long http_status = 0;
+
+    std::vector<Transfer*> transfers;
+    int peak_transfers = 0;
+    int started_transfers = 0;
+    bool failed = false;
+    // Set once a bound request failed to connect, or when the default route
+    // isn't one of the ranked links; the rest of the download follows the
+    // default route.
+    bool unbound = false;
+
+    // Content hash of [0, hashed). Data written past the cursor is listed in
+    // unhashed (start -> end) until the cursor reaches it.
+    ContentHasher hasher;
+    int64_t hashed = 0;
+    std::map<int64_t, int64_t> unhashed;
+
+    // Validator, size and ranges on disk; saved to journal_path while a
+    // resumable download runs. The validator also feeds If-Range.
+    DownloadJournal journal;
+    std::string journal_path;
+    std::chrono::steady_clock::time_point journal_saved;
+    // Holes an earlier attempt left, fetched before next_offset.
+    std::deque<std::pair<int64_t, int64_t>> pending;
+    int64_t resumed_bytes = 0;
+    // Set once the object changed under the download and it started over.
+    bool restarted = false;
+
+    // Unpacks extract_archive downloads in place of fd.
+    std::unique_ptr<ArchiveExtractorLinux> extractor;
+
+    // Bytes of the destination preallocated so far.
+    int64_t reserved = 0;
+    bool insufficient_space = false;
+};
+
+struct DownloadEngineLinux::Transfer {
+    DownloadEngineLinux* engine = nullptr;
+    Job* job = nullptr;
+    CURL* easy = nullptr;
+
+    // Next file offset to write and the end of the requested range
+    // (exclusive); end is -1 when the response is not a byte range.
+    int64_t offset = 0;
+    int64_t end = -1;
+    int64_t range_begin = 0;
+    bool ranged = false;
+    bool checked_response = false;
+
+    // From the Content-Range header of the final response.
+    int64_t range_start = -1;
+    int64_t range_total = -1;
+
+    // Interface the socket is bound to, empty for the default route.
+    std::string interface;
+
+    // If-Range with the job's validator, for ranged requests.
+    curl_slist* headers = nullptr;
+    // Validators of the final response.
+    std::string etag;
+    std::string last_modified;
+    // The object changed since the validator was taken; start over.
+    bool restart = false;
+
+    char error[CURL_ERROR_SIZE] = {0};
+    // Kind of the failure, if OnBody() aborted the transfer; curl's own
+    // errors are the network's.
+    DownloadFailure failure = DownloadFailure::kNetwork;
+};
+
+namespace {
+
+// Large receive buffer: fewer write callbacks and pwrite() calls per MB.
+constexpr long kReceiveBufferSize = 512 * 1024;
+// Read-back size when the hash cursor catches up with an earlier range.
+constexpr size_t kHashReadSize = 1 << 20;
+constexpr long kConnectTimeoutSeconds = 15;
+// A transfer slower than 1 KB/s for this long is considered stalled.
+constexpr long kStallTimeoutSeconds = 30;
+// Journal saves sync the file, so not after every chunk on fast links.
+constexpr std::chrono::seconds kJournalInterval(2);
+// Twice the rate the UI samples at (10 Hz), so samples are never stale by
+// more than half a frame of the progress display.
+constexpr std::chrono::milliseconds kProgressInterval(50);
+
+bool PwriteAll(int fd, const char* data, size_t length, int64_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+// Header value without the surrounding whitespace and line ending.
+std::string HeaderValue(const char* value, size_t length) {
+    while (length > 0 && (*value == ' ' || *value == '\t')) {
+        ++value;
+        --length;
+    }
+    while (length > 0 && isspace(static_cast<unsigned char>(value[length - 1]))) {
+        --length;
+    }
+    return std::string(value, length);
+}
+
+// Failures that say nothing about the object, only about the path to it, so
+// a later attempt can pick up where this one stopped.
+bool IsTransient(CURLcode code) {
+    switch (code) {
+        case CURLE_COULDNT_RESOLVE_PROXY:
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_INTERFACE_FAILED:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+const char* DownloadFailureName(DownloadFailure failure) {
+    switch (failure) {
+        case DownloadFailure::kNone:
+            return "none";
+        case DownloadFailure::kCancelled:
+            return "cancelled";
+        case DownloadFailure::kNetwork:
+            return "network";
+        case DownloadFailure::kServer:
+            return "server";
+        case DownloadFailure::kContent:
+            return "content";
+        case DownloadFailure::kLocal:
+            return "local";
+        case DownloadFailure::kNoSpace:
+            return "noSpace";
+    }
+    return "none";
+}
+
+DownloadEngineLinux::DownloadEngineLinux(CompletionCallback callback, gpointer user_data)
+    : callback_(callback),
+      user_data_(user_data),
+      multi_(nullptr),
+      running_(false),
+      next_id_(1),
+      dispatch_scheduled_(false) {}
+
+DownloadEngineLinux::~DownloadEngineLinux() {
+    Stop();
+}
+
+bool DownloadEngineLinux::Start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        return false;
+    }
+    multi_ = curl_multi_init();
+    if (multi_ == nullptr) {
+        curl_global_cleanup();
+        return false;
+    }
+    // Parallel ranges only help if they travel over separate TCP connections,
+    // so never multiplex them onto one HTTP/2 stream.
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+
+    running_.store(true);
+    thread_ = std::thread(&DownloadEngineLinux::Run, this);
+    return true;
+}
+
+void DownloadEngineLinux::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    curl_multi_wakeup(multi_);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    curl_multi_cleanup(multi_);
+    multi_ = nullptr;
+    curl_global_cleanup();
+
+    // Everything the worker reported, including the downloads it cancelled
+    // on the way out, is delivered now rather than from an idle callback
+    // that may never run.
+    g_source_remove_by_user_data(this);
+    DispatchCompleted(this);
+}
+
+uint64_t DownloadEngineLinux::Enqueue(const DownloadRequest& request) {
+    if (!running_.load()) {
+        return 0;
+    }
+
+    auto job = std::make_unique<Job>();
+    job->request = request;
+    job->request.max_connections = std::max(1, request.max_connections);
+    job->request.chunk_size = std::max<int64_t>(64 * 1024, request.chunk_size);
+    job->effective_url = request.url;
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(incoming_mutex_);
+        id = next_id_++;
+        job->id = id;
+        incoming_.push_back(std::move(job));
+    }
+    curl_multi_wakeup(multi_);
+    return id;
+}
+
+void DownloadEngineLinux::SetInterfaces(const std::vector<std::string>& interfaces) {
+    std::lock_guard<std::mutex> lock(interfaces_mutex_);
+    interfaces_.assign(interfaces.begin(),
+                       interfaces.begin() + std::min<size_t>(interfaces.size(), 2));
+}
+
+std::vector<DownloadProgress> DownloadEngineLinux::Progress() const {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    return progress_;
+}
+
+void DownloadEngineLinux::PublishProgress() {
+    auto now = std::chrono::steady_clock::now();
+    // Once idle, publish right away so finished downloads drop out.
+    if (!jobs_.empty() && now - progress_published_ < kProgressInterval) {
+        return;
+    }
+    progress_published_ = now;
+
+    std::vector<DownloadProgress> progress;
+    progress.reserve(jobs_.size());
+    for (const auto& entry : jobs_) {
+        const Job* job = entry.second.get();
+        DownloadProgress item;
+        item.id = job->id;
+        item.destination = job->request.destination;
+        item.bytes = job->bytes_written;
+        item.total = job->total;
+        progress.push_back(std::move(item));
+    }
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    progress_.swap(progress);
+}
+
+void DownloadEngineLinux::Run() {
+    while (running_.load()) {
+        std::vector<std::unique_ptr<Job>> incoming;
+        {
+            std::lock_guard<std::mutex> lock(incoming_mutex_);
+            incoming.swap(incoming_);
+        }
+        for (auto& job : incoming) {
+            StartJob(std::move(job));
+        }
+
+        int still_running = 0;
+        curl_multi_perform(multi_, &still_running);
+
+        CURLMsg* message;
+        int queued = 0;
+        while ((message = curl_multi_info_read(multi_, &queued)) != nullptr) {
+            if (message->msg != CURLMSG_DONE) continue;
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+            OnTransferDone(transfer, message->data.result);
+        }
+
+        // Ranges are scheduled here rather than from the body callback that
+        // learns the object size: handles can't be added from a callback.
+        for (auto it = jobs_.begin(); it != jobs_.end();) {
+            Job* job = (it++)->second.get();  // FillTransfers may erase it
+            FillTransfers(job);
+        }
+        PublishProgress();
+
+        // Wakes for progress too while downloads run, so the snapshot keeps
+        // up with transfers that deliver data less often than that.
+        int timeout_ms = jobs_.empty() ? 1000 : static_cast<int>(kProgressInterval.count());
+        curl_multi_poll(multi_, nullptr, 0, timeout_ms, nullptr);
+    }
+
+    std::vector<std::unique_ptr<Job>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(incoming_mutex_);
+        abandoned.swap(incoming_);
+    }
+    for (auto& job : abandoned) {
+        DownloadResult result;
+        result.id = job->id;
+        result.error = "cancelled";
+        result.failure = DownloadFailure::kCancelled;
+        // Never started, so whatever an earlier attempt left is untouched.
+        result.resumable = true;
+        result.context = job->request.context;
+        Complete(result);
+    }
+    while (!jobs_.empty()) {
+        FailJob(jobs_.begin()->second.get(), DownloadFailure::kCancelled, "cancelled", true);
+    }
+}
+
+void DownloadEngineLinux::StartJob(std::unique_ptr<Job> job) {
+    Job* raw = job.get();
+    jobs_[raw->id] = std::move(job);
+
+    if (raw->request.extract_archive) {
+        // The extractor preallocates each file from its tar header.
+        if (!StorageSpaceLinux::Admit(raw->request.destination, raw->request.expected_size,
+                                      raw->request.min_free_bytes)) {
+            raw->insufficient_space = true;
+            FailJob(raw, DownloadFailure::kNoSpace, "not enough free space", false);
+            return;
+        }
+        // Streamed into the extractor as it arrives; no ranges, no journal.
+        raw->extractor = std::make_unique<ArchiveExtractorLinux>(raw->request.destination);
+        raw->next_offset = INT64_MAX;
+        if (!AddTransfer(raw, 0, -1)) {
+            FailJob(raw, DownloadFailure::kLocal, "cannot create transfer", false);
+        }
+        return;
+    }
+
+    raw->journal_path = DownloadJournal::PathFor(raw->request.destination);
+
+    if (raw->request.resume && ResumeJob(raw)) {
+        return;
+    }
+    // Left by an attempt that can't be continued; the file is truncated.
+    unlink(raw->journal_path.c_str());
+
+    raw->fd = open(raw->request.destination.c_str(),
+                   O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (raw->fd < 0) {
+        FailJob(raw, DownloadFailure::kLocal, std::string("cannot open destination: ") + strerror(errno), false);
+        return;
+    }
+    if (!ReserveSpace(raw, raw->request.expected_size)) {
+        FailJob(raw, DownloadFailure::kNoSpace, "not enough free space", false);
+        return;
+    }
+
+    // Ask for the first chunk only; the answer tells whether the server
+    // supports ranges and how large the object is.
+    raw->next_offset = raw->request.chunk_size;
+    if (!AddTransfer(raw, 0, raw->request.chunk_size)) {
+        FailJob(raw, DownloadFailure::kLocal, "cannot create transfer", false);
+    }
+}
+
+// Picks up the journal of an interrupted attempt. Returns false, leaving the
+// job untouched, if there is none or it doesn't match the file on disk; the
+// download then starts over.
+bool DownloadEngineLinux::ResumeJob(Job* job) {
+    DownloadJournal journal;
+    if (!journal.Load(job->journal_path) || journal.url != job->request.url ||
+        journal.validator.empty() || journal.total <= 0 || journal.ranges.empty()) {
+        return false;
+    }
+    // Everything behind the hash cursor must be on disk (see SaveJournal).
+    auto first = journal.ranges.begin();
+    if (journal.hashed > 0 && (first->first != 0 || first->second < journal.hashed)) {
+        return false;
+    }
+    ContentHasher hasher;
+    if (journal.hash_state.total_length != static_cast<uint64_t>(journal.hashed) ||
+        !hasher.RestoreState(journal.hash_state)) {
+        return false;
+    }
+    int fd = open(job->request.destination.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < journal.ranges.rbegin()->second) {
+        close(fd);
+        return false;
+    }
+
+    job->fd = fd;
+    job->hasher = hasher;
+    job->hashed = journal.hashed;
+    job->total = journal.total;
+    job->next_offset = journal.total;
+    job->bytes_written = journal.BytesWritten();
+    job->resumed_bytes = job->bytes_written;
+    int64_t cursor = 0;
+    for (const auto& range : journal.ranges) {
+        if (range.first > cursor) {
+            job->pending.emplace_back(cursor, range.first);
+        }
+        if (range.second > job->hashed) {
+            job->unhashed[std::max(range.first, job->hashed)] = range.second;
+        }
+        cursor = range.second;
+    }
+    if (cursor < journal.total) {
+        job->pending.emplace_back(cursor, journal.total);
+    }
+    job->journal = std::move(journal);
+    if (!ReserveSpace(job, job->total)) {
+        // Keeps what the earlier attempts wrote for when space is freed.
+        FailJob(job, DownloadFailure::kNoSpace, "not enough free space", true);
+        return true;
+    }
+    g_message("Resuming %s at %" PRId64 " of %" PRId64 " bytes", job->request.url.c_str(),
+              job->resumed_bytes, job->total);
+
+    if (!DrainUnhashed(job)) {
+        FailJob(job, DownloadFailure::kLocal, std::string("read back failed: ") + strerror(errno), false);
+    } else if (job->pending.empty()) {
+        FinishJob(job);
+    } else {
+        FillTransfers(job);
+    }
+    return true;
+}
+
+// Checks that |size| bytes fit with the request's free-space floor and
+// preallocates them. Only the part not reserved or written yet counts
+// against the floor. Returns false, marking the job, if they don't fit.
+bool DownloadEngineLinux::ReserveSpace(Job* job, int64_t size) {
+    if (size <= job->reserved) {
+        return true;
+    }
+    int64_t needed = size - std::max(job->reserved, job->bytes_written);
+    if (!StorageSpaceLinux::Admit(FilePlacementLinux::DirectoryOf(job->request.destination),
+                                  needed, job->request.min_free_bytes) ||
+        !StorageSpaceLinux::Preallocate(job->fd, size)) {
+        job->insufficient_space = true;
+        return false;
+    }
+    job->reserved = size;
+    return true;
+}
+
+// The object no longer matches the validator the download started with:
+// drop what was written and fetch it again from the start, once.
+void DownloadEngineLinux::RestartJob(Job* job) {
+    g_message("%s changed on the server, downloading it again", job->request.url.c_str());
+    job->restarted = true;
+    while (!job->transfers.empty()) {
+        RemoveTransfer(job->transfers.back());
+    }
+    unlink(job->journal_path.c_str());
+    if (ftruncate(job->fd, 0) != 0) {
+        FailJob(job, DownloadFailure::kLocal, std::string("truncate failed: ") + strerror(errno), false);
+        return;
+    }
+
+    job->journal = DownloadJournal();
+    // Truncating dropped the preallocation along with the data.
+    job->reserved = 0;
+    job->pending.clear();
+    job->unhashed.clear();
+    job->hasher.Reset();
+    job->hashed = 0;
+    job->total = -1;
+    job->bytes_written = 0;
+    job->resumed_bytes = 0;
+    job->effective_url = job->request.url;
+    job->next_offset = job->request.chunk_size;
+    if (!AddTransfer(job, 0, job->request.chunk_size)) {
+        FailJob(job, DownloadFailure::kLocal, "cannot create transfer", false);
+    }
+}
+
+bool DownloadEngineLinux::AddTransfer(Job* job, int64_t offset, int64_t end) {
+    CURL* easy = curl_easy_init();
+    if (easy == nullptr) {
+        return false;
+    }
+
+    Transfer* transfer = new Transfer();
+    transfer->engine = this;
+    transfer->job = job;
+    transfer->easy = easy;
+    transfer->offset = offset;
+    transfer->end = end;
+    transfer->range_begin = offset;
+    transfer->ranged = end >= 0;
+    transfer->interface = ChooseInterface(job);
+
+    curl_easy_setopt(easy, CURLOPT_URL, job->effective_url.c_str());
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(easy, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(easy, CURLOPT_BUFFERSIZE, kReceiveBufferSize);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, kConnectTimeoutSeconds);
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, kStallTimeoutSeconds);
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, transfer->error);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, &DownloadEngineLinux::OnHeader);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &DownloadEngineLinux::OnBody);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer);
+    if (transfer->ranged) {
+        char range[64];
+        snprintf(range, sizeof(range), "%" PRId64 "-%" PRId64, offset, end - 1);
+        curl_easy_setopt(easy, CURLOPT_RANGE, range);
+        if (!job->journal.validator.empty()) {
+            // A changed object comes back whole (200) instead of as a range
+            // of the new version.
+            std::string if_range = "If-Range: " + job->journal.validator;
+            transfer->headers = curl_slist_append(nullptr, if_range.c_str());
+        }
+    }
+    if (!job->request.post_body.empty()) {
+        curl_easy_setopt(easy, CURLOPT_COPYPOSTFIELDS, job->request.post_body.c_str());
+        transfer->headers = curl_slist_append(transfer->headers, "Content-Type: application/json");
+    }
+    if (job->extractor) {
+        transfer->headers =
+            curl_slist_append(transfer->headers, "Accept: application/zstd, application/x-tar");
+    }
+    if (transfer->headers != nullptr) {
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    }
+    if (!transfer->interface.empty()) {
+        // "if!" binds with SO_BINDTODEVICE, so the route lookup is confined
+        // to that link; where that isn't permitted curl binds to the link's
+        // address instead.
+        std::string device = "if!" + transfer->interface;
+        curl_easy_setopt(easy, CURLOPT_INTERFACE, device.c_str());
+    }
+
+    if (curl_multi_add_handle(multi_, easy) != CURLM_OK) {
+        curl_easy_cleanup(easy);
+        curl_slist_free_all(transfer->headers);
+        delete transfer;
+        return false;
+    }
+
+    job->transfers.push_back(transfer);
+    job->peak_transfers = std::max(job->peak_transfers, static_cast<int>(job->transfers.size()));
+    return true;
+}
+
+std::string DownloadEngineLinux::ChooseInterface(Job* job) {
+    int index = job->started_transfers++;
+    if (!job->request.bind_interface || job->unbound) {
+        return std::string();
+    }
+    // A VPN's tunnel is virtual, so it is never ranked; binding to a
+    // physical link under it would route around the tunnel.
+    std::string route = index == 0 ? NetworkServiceLinux::GetRouteInterface() : std::string();
+    std::lock_guard<std::mutex> lock(interfaces_mutex_);
+    if (interfaces_.empty()) {
+        return std::string();
+    }
+    if (index == 0) {
+        if (std::find(interfaces_.begin(), interfaces_.end(), route) == interfaces_.end()) {
+            job->unbound = true;
+            return std::string();
+        }
+    }
+    // The first request always takes the best link; with striping the
+    // ranges that follow alternate between the two.
+    if (job->request.stripe_interfaces && interfaces_.size() > 1) {
+        return interfaces_[index % 2];
+    }
+    return interfaces_[0];
+}
+
+void DownloadEngineLinux::FillTransfers(Job* job) {
+    if (job->failed || job->total < 0) {
+        return;
+    }
+    while (static_cast<int>(job->transfers.size()) < job->request.max_connections) {
+        int64_t begin;
+        int64_t end;
+        if (!job->pending.empty()) {
+            auto& hole = job->pending.front();
+            begin = hole.first;
+            end = std::min(hole.first + job->request.chunk_size, hole.second);
+            if (end == hole.second) {
+                job->pending.pop_front();
+            } else {
+                hole.first = end;
+            }
+        } else if (job->next_offset < job->total) {
+            begin = job->next_offset;
+            end = std::min(job->next_offset + job->request.chunk_size, job->total);
+            job->next_offset = end;
+        } else {
+            break;
+        }
+        if (!AddTransfer(job, begin, end)) {
+            FailJob(job, DownloadFailure::kLocal, "cannot create transfer", false);
+            return;
+        }
+    }
+}
+
+size_t DownloadEngineLinux::OnHeader(char* buffer, size_t size, size_t count, void* user_data) {
+    Transfer* transfer = static_cast<Transfer*>(user_data);
+    size_t length = size * count;
+
+    // Headers of every response in a redirect chain arrive here; only the
+    // last one counts, so start over at each status line.
+    if (length >= 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        transfer->range_start = -1;
+        transfer->range_total = -1;
+        transfer->etag.clear();
+        transfer->last_modified.clear();
+    } else if (length > 5 && strncasecmp(buffer, "ETag:", 5) == 0) {
+        std::string value = HeaderValue(buffer + 5, length - 5);
+        // Weak ETags don't qualify for If-Range.
+        if (value.compare(0, 2, "W/") != 0) {
+            transfer->etag = value;
+        }
+    } else if (length > 14 && strncasecmp(buffer, "Last-Modified:", 14) == 0) {
+        transfer->last_modified = HeaderValue(buffer + 14, length - 14);
+    } else if (length > 14 && strncasecmp(buffer, "Content-Range:", 14) == 0) {
+        std::string value(buffer + 14, length - 14);
+        int64_t start, last, total;
+        if (sscanf(value.c_str(), " bytes %" SCNd64 "-%" SCNd64 "/%" SCNd64,
+                   &start, &last, &total) == 3) {
+            transfer->range_start = start;
+            transfer->range_total = total;
+        }
+    }
+    return length;
+}
+
+size_t DownloadEngineLinux::OnBody(char* buffer, size_t size, size_t count, void* user_data) {
+    Transfer* transfer = static_cast<Transfer*>(user_data);
+    Job* job = transfer->job;
+    size_t length = size * count;
+
+    if (!transfer->checked_response) {
+        transfer->checked_response = true;
+        long status = 0;
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &status);
+        job->http_status = status;
+
+        bool is_first = transfer->offset == 0 && job->total < 0;
+        if (status == 206 && transfer->range_start == transfer->offset) {
+            if (is_first) {
+                job->total = transfer->range_total;
+                if (!transfer->engine->ReserveSpace(job, job->total)) {
+                    transfer->failure = DownloadFailure::kNoSpace;
+                    snprintf(transfer->error, sizeof(transfer->error), "not enough free space");
+                    return 0;
+                }
+                transfer->end = std::min(transfer->end, job->total);
+                job->next_offset = transfer->end;
+                job->journal.validator =
+                    !transfer->etag.empty() ? transfer->etag : transfer->last_modified;
+                char* url = nullptr;
+                if (curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK &&
+                    url != nullptr) {
+                    job->effective_url = url;
+                }
+            } else if (transfer->range_total != job->total) {
+                transfer->restart = true;
+            }
+        } else if (is_first && status == 200) {
+            // Range ignored: the whole object comes over this request.
+            curl_off_t length = -1;
+            curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+            job->total = length;
+            if (job->fd >= 0 && !transfer->engine->ReserveSpace(job, job->total)) {
+                transfer->failure = DownloadFailure::kNoSpace;
+                snprintf(transfer->error, sizeof(transfer->error), "not enough free space");
+                return 0;
+            }
+            transfer->end = -1;
+            job->next_offset = INT64_MAX;
+        } else if (status == 200 && !job->journal.validator.empty()) {
+            // If-Range didn't match.
+            transfer->restart = true;
+        } else {
+            transfer->failure = DownloadFailure::kServer;
+            snprintf(transfer->error, sizeof(transfer->error),
+                     "unexpected response %ld for range at %" PRId64, status, transfer->offset);
+            return 0;
+        }
+        if (transfer->restart) {
+            transfer->failure = DownloadFailure::kContent;
+            snprintf(transfer->error, sizeof(transfer->error), "object changed on the server");
+            return 0;
+        }
+    }
+
+    if (transfer->end >= 0 && transfer->offset + static_cast<int64_t>(length) > transfer->end) {
+        transfer->failure = DownloadFailure::kServer;
+        snprintf(transfer->error, sizeof(transfer->error),
+                 "server sent more than the requested range at %" PRId64, transfer->offset);
+        return 0;
+    }
+    if (job->extractor) {
+        if (!job->extractor->Feed(buffer, length)) {
+            job->insufficient_space = job->extractor->out_of_space();
+            transfer->failure = DownloadFailure::kContent;
+            snprintf(transfer->error, sizeof(transfer->error), "archive: %s",
+                     job->extractor->error().c_str());
+            return 0;
+        }
+        transfer->offset += length;
+        job->bytes_written += length;
+        return length;
+    }
+    if (!PwriteAll(job->fd, buffer, length, transfer->offset)) {
+        job->insufficient_space = StorageSpaceLinux::IsOutOfSpace(errno);
+        transfer->failure = DownloadFailure::kLocal;
+        snprintf(transfer->error, sizeof(transfer->error), "write failed: %s", strerror(errno));
+        return 0;
+    }
+    if (!transfer->engine->HashWritten(job, transfer, buffer, length, transfer->offset)) {
+        transfer->failure = DownloadFailure::kLocal;
+        snprintf(transfer->error, sizeof(transfer->error), "read back failed: %s", strerror(errno));
+        return 0;
+    }
+    transfer->offset += length;
+    job->bytes_written += length;
+    return length;
+}
+
+// Feeds the job's hasher in file order. Data at the cursor is hashed straight
+// from the receive buffer, which covers the whole file for single-stream
+// downloads and the leading range otherwise. Ranges that land ahead of the
+// cursor are read back once it reaches them; they were just written, so that
+// read is served from the page cache rather than the disk.
+bool DownloadEngineLinux::HashWritten(Job* job, Transfer* transfer, const char* data,
+                                      size_t length, int64_t offset) {
+    if (offset == job->hashed) {
+        job->hasher.Update(data, length);
+        job->hashed += length;
+    } else {
+        job->unhashed[transfer->range_begin] = offset + static_cast<int64_t>(length);
+    }
+    return DrainUnhashed(job);
+}
+
+// Moves the hash cursor over ranges already written ahead of it.
+bool DownloadEngineLinux::DrainUnhashed(Job* job) {
+    for (auto it = job->unhashed.find(job->hashed); it != job->unhashed.end();
+         it = job->unhashed.find(job->hashed)) {
+        int64_t end = it->second;
+        job->unhashed.erase(it);
+        if (hash_buffer_.empty()) {
+            hash_buffer_.resize(kHashReadSize);
+        }
+        while (job->hashed < end) {
+            size_t want = static_cast<size_t>(
+                std::min<int64_t>(end - job->hashed, static_cast<int64_t>(hash_buffer_.size())));
+            ssize_t n = pread(job->fd, hash_buffer_.data(), want, job->hashed);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            job->hasher.Update(hash_buffer_.data(), static_cast<size_t>(n));
+            job->hashed += n;
+        }
+    }
+    return true;
+}
+
+void DownloadEngineLinux::OnTransferDone(Transfer* transfer, CURLcode code) {
+    Job* job = transfer->job;
+
+    if (transfer->restart) {
+        RemoveTransfer(transfer);
+        if (job->restarted) {
+            FailJob(job, DownloadFailure::kContent,
+                    "object changed on the server during the download", false);
+        } else {
+            RestartJob(job);
+        }
+        return;
+    }
+
+    std::string error;
+    bool resumable = true;
+    DownloadFailure failure = DownloadFailure::kNetwork;
+    if (code != CURLE_OK) {
+        long status = 0;
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &status);
+        if (status == 416 && transfer->offset == 0 && job->total < 0) {
+            // An empty object can't satisfy any range; fetch it plainly.
+            RemoveTransfer(transfer);
+            job->next_offset = INT64_MAX;
+            if (!AddTransfer(job, 0, -1)) {
+                FailJob(job, DownloadFailure::kLocal, "cannot create transfer", false);
+            }
+            return;
+        }
+        if (!transfer->interface.empty() && transfer->offset == transfer->range_begin &&
+            (code == CURLE_INTERFACE_FAILED || code == CURLE_COULDNT_CONNECT)) {
+            // The link went away or has no route to the server. Nothing of
+            // this range was written; retry it on the default route.
+            g_message("Download could not use %s (%s), using the default route",
+                      transfer->interface.c_str(), curl_easy_strerror(code));
+            int64_t begin = transfer->range_begin;
+            int64_t end = transfer->end;
+            job->unbound = true;
+            RemoveTransfer(transfer);
+            if (!AddTransfer(job, begin, end)) {
+                FailJob(job, DownloadFailure::kLocal, "cannot create transfer", false);
+            }
+            return;
+        }
+        if (status >= 400) {
+            job->http_status = status;
+        }
+        resumable = status < 400 && IsTransient(code);
+        failure = status >= 400 ? DownloadFailure::kServer : transfer->failure;
+        error = transfer->error[0] != '\0' ? transfer->error : curl_easy_strerror(code);
+        if (job->insufficient_space) {
+            // curl reports the aborted write in its own words.
+            error = "not enough free space";
+        }
+    } else if (!transfer->checked_response) {
+        // Body-less 200/206: only possible for an empty object.
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &job->http_status);
+        if (transfer->offset == 0 && job->total < 0) {
+            job->total = 0;
+        }
+    } else if (transfer->end >= 0 && transfer->offset != transfer->end) {
+        char message[96];
+        snprintf(message, sizeof(message), "range ended early at %" PRId64 " of %" PRId64,
+                 transfer->offset, transfer->end);
+        error = message;
+    } else if (transfer->end >= 0) {
+        job->journal.AddRange(transfer->range_begin, transfer->end);
+    }
+
+    RemoveTransfer(transfer);
+    if (!error.empty()) {
+        FailJob(job, failure, error, resumable);
+        return;
+    }
+
+    if (job->transfers.empty() && job->pending.empty() && job->next_offset >= job->total) {
+        FinishJob(job);
+    } else if (job->request.resume) {
+        SaveJournal(job, false);
+    }
+}
+
+// Records the download's progress for a later attempt. Returns false if the
+// download can't be resumed or the journal couldn't be written.
+bool DownloadEngineLinux::SaveJournal(Job* job, bool force) {
+    if (!job->request.resume || job->journal.validator.empty() || job->total <= 0 ||
+        job->fd < 0) {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - job->journal_saved < kJournalInterval) {
+        return true;
+    }
+    job->journal_saved = now;
+    // The journal vouches for the ranges it lists, so they go to disk first.
+    if (fdatasync(job->fd) != 0) {
+        return false;
+    }
+    // Every byte behind the hash cursor was written before it was hashed.
+    job->journal.AddRange(0, job->hashed);
+    job->journal.url = job->request.url;
+    job->journal.total = job->total;
+    job->journal.hashed = job->hashed;
+    job->journal.hash_state = job->hasher.SaveState();
+    return job->journal.Save(job->journal_path);
+}
+
+void DownloadEngineLinux::RemoveTransfer(Transfer* transfer) {
+    Job* job = transfer->job;
+    job->transfers.erase(std::remove(job->transfers.begin(), job->transfers.end(), transfer),
+                         job->transfers.end());
+    curl_multi_remove_handle(multi_, transfer->easy);
+    curl_easy_cleanup(transfer->easy);
+    curl_slist_free_all(transfer->headers);
+    delete transfer;
+}
+
+void DownloadEngineLinux::FailJob(Job* job, DownloadFailure failure, const std::string& error,
+                                  bool resumable) {
+    job->failed = true;
+    // Ranges cut short are kept up to where they got.
+    for (Transfer* transfer : job->transfers) {
+        if (transfer->end >= 0) {
+            job->journal.AddRange(transfer->range_begin, transfer->offset);
+        }
+    }
+    bool keep = resumable && SaveJournal(job, true);
+    while (!job->transfers.empty()) {
+        RemoveTransfer(job->transfers.back());
+    }
+    if (job->extractor) {
+        job->extractor->Discard();
+    }
+    if (job->fd >= 0) {
+        close(job->fd);
+        job->fd = -1;
+        if (!keep) {
+            unlink(job->request.destination.c_str());
+        }
+    }
+    if (!keep && !job->journal_path.empty()) {
+        unlink(job->journal_path.c_str());
+    }
+
+    DownloadResult result;
+    result.id = job->id;
+    result.http_status = job->http_status;
+    result.bytes = job->bytes_written;
+    result.connections = job->peak_transfers;
+    result.resumed_bytes = job->resumed_bytes;
+    result.resumable = keep;
+    result.insufficient_space = job->insufficient_space;
+    // A write that hit a full disk is reported as such, whatever aborted it.
+    result.failure = job->insufficient_space ? DownloadFailure::kNoSpace : failure;
+    result.error = error;
+    result.context = job->request.context;
+    jobs_.erase(job->id);
+    Complete(result);
+}
+
+void DownloadEngineLinux::FinishJob(Job* job) {
+    if (job->total >= 0 && job->bytes_written != job->total) {
+        FailJob(job, DownloadFailure::kContent, "size mismatch", false);
+        return;
+    }
+    if (job->extractor) {
+        if (!job->extractor->Finish()) {
+            FailJob(job, DownloadFailure::kContent, "archive: " + job->extractor->error(), false);
+            return;
+        }
+        DownloadResult result;
+        result.id = job->id;
+        result.success = true;
+        result.http_status = job->http_status;
+        result.bytes = job->bytes_written;
+        result.connections = job->peak_transfers;
+        result.entries = job->extractor->entries();
+        result.context = job->request.context;
+        jobs_.erase(job->id);
+        Complete(result);
+        return;
+    }
+    bool hashed = job->hashed == job->bytes_written;
+    uint64_t content_hash = job->hasher.Digest();
+    if (job->request.has_expected_hash &&
+        (!hashed || content_hash != job->request.expected_hash)) {
+        FailJob(job, DownloadFailure::kContent,
+                "checksum mismatch: got " + FormatContentHash(content_hash) + ", expected " +
+                    FormatContentHash(job->request.expected_hash),
+                false);
+        return;
+    }
+    StorageSpaceLinux::Release(job->fd, job->bytes_written, job->reserved);
+    if (close(job->fd) != 0) {
+        job->fd = -1;
+        FailJob(job, DownloadFailure::kLocal, std::string("close failed: ") + strerror(errno), false);
+        return;
+    }
+    job->fd = -1;
+    unlink(job->journal_path.c_str());
+
+    DownloadResult result;
+    result.id = job->id;
+    result.success = true;
+    result.http_status = job->http_status;
+    result.bytes = job->bytes_written;
+    result.connections = job->peak_transfers;
+    result.hashed = hashed;
+    result.content_hash = content_hash;
+    result.resumed_bytes = job->resumed_bytes;
+    result.context = job->request.context;
+    jobs_.erase(job->id);
+    Complete(result);
+}
+
+void DownloadEngineLinux::Complete(const DownloadResult& result) {
+    std::lock_guard<std::mutex> lock(completed_mutex_);
+    completed_.push_back(result);
+    if (!dispatch_scheduled_ && running_.load()) {
+        dispatch_scheduled_ = true;
+        g_idle_add(DispatchCompleted, this);
+    }
+}
+
+gboolean DownloadEngineLinux::DispatchCompleted(gpointer user_data) {
+    DownloadEngineLinux* self = static_cast<DownloadEngineLinux*>(user_data);
+    std::deque<DownloadResult> completed;
+    {
+        std::lock_guard<std::mutex> lock(self->completed_mutex_);
+        completed.swap(self->completed_);
+        self->dispatch_scheduled_ = false;
+    }
+    for (const DownloadResult& result : completed) {
+        self->callback_(result, self->user_data_);
+    }
+    return G_SOURCE_REMOVE;
+}
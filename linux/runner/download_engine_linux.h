@@ -0,0 +1,219 @@
+#ifndef DOWNLOAD_ENGINE_LINUX_H_
+#define DOWNLOAD_ENGINE_LINUX_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <curl/curl.h>
+#include <glib.h>
+
+#include "archive_extractor_linux.h"
+
+struct DownloadRequest {
+    std::string url;
+    // Written in place; truncated first, removed again if the download fails
+    // (but see resume).
+    std::string destination;
+    // Upper bound on parallel ranged requests for this download.
+    int max_connections = 4;
+    // Size of each ranged request. Objects smaller than this use one request.
+    int64_t chunk_size = 8 << 20;
+    // XXH64 the content must have (see content_hash.h); the download fails
+    // and the file is removed on a mismatch.
+    bool has_expected_hash = false;
+    uint64_t expected_hash = 0;
+    // Bind the sockets to the engine's preferred interface (SetInterfaces)
+    // instead of following the default route. Ignored while the default
+    // route leaves through a link that isn't preferred, e.g. a VPN tunnel.
+    bool bind_interface = false;
+    // With two preferred interfaces, alternate ranged requests between them.
+    bool stripe_interfaces = false;
+    // Continue from the journal (download_journal_linux.h) an earlier,
+    // interrupted attempt left next to the destination, and leave one behind
+    // if this attempt is interrupted too. Only servers that send a validator
+    // (strong ETag or Last-Modified) with their ranges can be resumed.
+    bool resume = false;
+    // The response is a tar stream, optionally zstd-compressed, to unpack
+    // into destination, which is then a directory (see
+    // archive_extractor_linux.h). Archives are fetched with one request and
+    // can't be resumed.
+    bool extract_archive = false;
+    // Sent as a JSON POST body instead of a GET.
+    std::string post_body;
+    // Size the caller expects, 0 if unknown. Space for it is checked and
+    // reserved (see storage_space_linux.h) before the first request; an
+    // unannounced size is checked once the server tells it.
+    int64_t expected_size = 0;
+    // Fail with insufficient_space rather than leave less than this free on
+    // the destination's filesystem.
+    int64_t min_free_bytes = 0;
+    // Opaque caller data, handed back unchanged in the result.
+    gpointer context = nullptr;
+};
+
+// Why a download failed, for callers that react differently to each; the
+// error text is for people and may be reworded.
+enum class DownloadFailure {
+    kNone,
+    // The engine shut down first.
+    kCancelled,
+    // Timeouts, resets, refused connections and bodies cut short: the link
+    // or the route to the server.
+    kNetwork,
+    // An error status, or a response that broke the range protocol.
+    kServer,
+    // The content isn't what was asked for: checksum or size mismatch, an
+    // object that kept changing, a malformed archive.
+    kContent,
+    // Opening, writing or reading back the destination failed.
+    kLocal,
+    // See DownloadResult::insufficient_space.
+    kNoSpace,
+};
+
+// Stable name of |failure| for the Dart side ("network", "noSpace", ...).
+const char* DownloadFailureName(DownloadFailure failure);
+
+struct DownloadResult {
+    uint64_t id = 0;
+    bool success = false;
+    long http_status = 0;
+    int64_t bytes = 0;
+    // Most ranged requests that were in flight at the same time.
+    int connections = 0;
+    // XXH64 of the content, computed while it was written.
+    bool hashed = false;
+    uint64_t content_hash = 0;
+    // Bytes taken over from an earlier attempt instead of being fetched.
+    int64_t resumed_bytes = 0;
+    // Failed, but the partial file and its journal were kept: enqueueing the
+    // same request with resume set continues where this attempt stopped.
+    bool resumable = false;
+    // Files unpacked by an extract_archive download.
+    std::vector<ExtractedEntry> entries;
+    // Failed for lack of disk space (admission or a full disk), before or
+    // while writing; worth retrying once space is freed.
+    bool insufficient_space = false;
+    DownloadFailure failure = DownloadFailure::kNone;
+    std::string error;
+    gpointer context = nullptr;
+};
+
+struct DownloadProgress {
+    uint64_t id = 0;
+    std::string destination;
+    // Bytes in the destination so far, including resumed ones.
+    int64_t bytes = 0;
+    // Object size, -1 until the server has said.
+    int64_t total = -1;
+};
+
+// Fetches URLs into files on a background thread driven by libcurl multi.
+//
+// Each download starts with a request for its first chunk. If the server
+// answers 206 the object is split into chunk-sized Range requests, up to
+// max_connections at a time, each written straight to its offset in the
+// destination with pwrite(). A server that ignores Range gets a single
+// streaming request. Every byte is also fed to a content hash in file order,
+// so the digest is ready when the last byte lands. Completions are delivered
+// on the GLib main context.
+//
+// Later ranges carry If-Range with the validator of the first response, so an
+// object that changes mid-download is fetched again from the start instead of
+// being stitched together from two versions.
+class DownloadEngineLinux {
+public:
+    // Invoked on the main context once per enqueued download.
+    typedef void (*CompletionCallback)(const DownloadResult& result, gpointer user_data);
+
+    DownloadEngineLinux(CompletionCallback callback, gpointer user_data);
+    ~DownloadEngineLinux();
+
+    bool Start();
+
+    // Joins the worker thread. Downloads that have not finished are reported
+    // as failed ("cancelled") before this returns.
+    void Stop();
+
+    bool IsRunning() const { return running_.load(); }
+
+    // Queues a download and returns its id, or 0 if the engine isn't running.
+    uint64_t Enqueue(const DownloadRequest& request);
+
+    // Interfaces downloads may bind to, best first; only the first two are
+    // used. Takes effect for requests started after the call, so bound
+    // downloads follow link changes. May be called from any thread.
+    void SetInterfaces(const std::vector<std::string>& interfaces);
+
+    // Downloads in flight, as of at most 50 ms ago. Cheap enough
+    // to poll at UI rates from any thread; the worker publishes a snapshot
+    // rather than taking a lock per received buffer.
+    std::vector<DownloadProgress> Progress() const;
+
+private:
+    struct Job;
+    struct Transfer;
+
+    void Run();
+    void StartJob(std::unique_ptr<Job> job);
+    bool ResumeJob(Job* job);
+    void RestartJob(Job* job);
+    bool ReserveSpace(Job* job, int64_t size);
+    bool AddTransfer(Job* job, int64_t offset, int64_t end);
+    std::string ChooseInterface(Job* job);
+    void FillTransfers(Job* job);
+    bool HashWritten(Job* job, Transfer* transfer, const char* data, size_t length,
+                     int64_t offset);
+    bool DrainUnhashed(Job* job);
+    bool SaveJournal(Job* job, bool force);
+    void OnTransferDone(Transfer* transfer, CURLcode code);
+    void RemoveTransfer(Transfer* transfer);
+    // |resumable| failures (network trouble, cancellation) keep the partial
+    // file and journal when the request asked for resume.
+    void FailJob(Job* job, DownloadFailure failure, const std::string& error, bool resumable);
+    void FinishJob(Job* job);
+    void Complete(const DownloadResult& result);
+    void PublishProgress();
+
+    static size_t OnHeader(char* buffer, size_t size, size_t count, void* user_data);
+    static size_t OnBody(char* buffer, size_t size, size_t count, void* user_data);
+    static gboolean DispatchCompleted(gpointer user_data);
+
+    CompletionCallback callback_;
+    gpointer user_data_;
+
+    CURLM* multi_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+
+    // Worker thread only.
+    std::map<uint64_t, std::unique_ptr<Job>> jobs_;
+    std::vector<char> hash_buffer_;
+    std::chrono::steady_clock::time_point progress_published_;
+
+    // Requests handed from Enqueue() to the worker.
+    std::mutex incoming_mutex_;
+    std::vector<std::unique_ptr<Job>> incoming_;
+    uint64_t next_id_;
+
+    std::mutex interfaces_mutex_;
+    std::vector<std::string> interfaces_;
+
+    mutable std::mutex progress_mutex_;
+    std::vector<DownloadProgress> progress_;
+
+    // Results waiting for the main context.
+    std::mutex completed_mutex_;
+    std::deque<DownloadResult> completed_;
+    bool dispatch_scheduled_;
+};
+
+#endif  // DOWNLOAD_ENGINE_LINUX_H_
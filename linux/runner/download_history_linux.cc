@@ -0,0 +1,361 @@
+#include "download_history_linux.h"
+#include "app_data_linux.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct DownloadHistoryLinux::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;
+    // Complete records; Recover() checks it against the slots.
+    uint64_t count;
+    // Running totals over every record, for Stats(0).
+    int64_t total_size;
+    int64_t total_bytes;
+    int64_t total_duration_ms;
+    int64_t first_ms;
+    int64_t last_ms;
+    // Pads the header to one slot, so slots stay sector-aligned.
+    char reserved[184];
+};
+
+struct DownloadHistoryLinux::Slot {
+    // 1-based position in the journal, written last; 0 until complete.
+    uint64_t sequence;
+    uint64_t content_hash;
+    int64_t size;
+    int64_t bytes;
+    int64_t started_ms;
+    int64_t finished_ms;
+    int64_t duration_ms;
+    char link_type[16];
+    // Truncated copy.
+    char filename[184];
+};
+
+namespace {
+
+constexpr char kMagic[8] = {'I', 'D', 'H', 'I', 'S', 'T', 'O', '1'};
+constexpr uint32_t kVersion = 1;
+// 1 MiB of records.
+constexpr uint64_t kGrowSlots = 4096;
+
+size_t FileSizeFor(uint64_t capacity, size_t header_size, size_t slot_size) {
+    return header_size + capacity * slot_size;
+}
+
+void CopyString(char* destination, size_t size, const std::string& source) {
+    strncpy(destination, source.c_str(), size - 1);
+    destination[size - 1] = '\0';
+}
+
+}  // namespace
+
+DownloadHistoryLinux::DownloadHistoryLinux(const std::string& path)
+    : path_(path),
+      fd_(-1),
+      mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      slots_(nullptr),
+      appended_(0),
+      committed_(0),
+      stopping_(false) {}
+
+DownloadHistoryLinux::~DownloadHistoryLinux() {
+    Close();
+}
+
+bool DownloadHistoryLinux::Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ != nullptr) {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path_).parent_path(), ec);
+
+    bool mapped = false;
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        Header header;
+        struct stat info;
+        bool valid = pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                     fstat(fd, &info) == 0 &&
+                     memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                     header.version == kVersion && header.slot_size == sizeof(Slot) &&
+                     header.capacity > 0 &&
+                     static_cast<size_t>(info.st_size) ==
+                         FileSizeFor(header.capacity, sizeof(Header), sizeof(Slot));
+        close(fd);
+        mapped = valid && Map(header.capacity, false);
+        if (mapped) {
+            Recover();
+        } else {
+            // An audit trail is never thrown away, only set aside.
+            std::string bad = path_ + ".bad";
+            rename(path_.c_str(), bad.c_str());
+        }
+    }
+    if (!mapped && !Map(kGrowSlots, true)) {
+        return false;
+    }
+
+    appended_ = committed_ = header_->count;
+    stopping_ = false;
+    committer_ = std::thread(&DownloadHistoryLinux::RunCommitter, this);
+    return true;
+}
+
+void DownloadHistoryLinux::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (header_ == nullptr) {
+            return;
+        }
+        stopping_ = true;
+    }
+    commit_wanted_.notify_all();
+    if (committer_.joinable()) {
+        committer_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Unmap();
+}
+
+bool DownloadHistoryLinux::Map(uint64_t capacity, bool create) {
+    static_assert(sizeof(Header) == 256 && sizeof(Slot) == 256,
+                  "slots must not straddle a sector");
+    int fd = open(path_.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t size = FileSizeFor(capacity, sizeof(Header), sizeof(Slot));
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    mapping_ = mapping;
+    mapping_size_ = size;
+    header_ = static_cast<Header*>(mapping);
+    slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+
+    if (create) {
+        // ftruncate() zero-filled everything else.
+        memcpy(header_->magic, kMagic, sizeof(kMagic));
+        header_->version = kVersion;
+        header_->slot_size = sizeof(Slot);
+        header_->capacity = capacity;
+    }
+    return true;
+}
+
+void DownloadHistoryLinux::Unmap() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    slots_ = nullptr;
+}
+
+bool DownloadHistoryLinux::Grow() {
+    uint64_t capacity = header_->capacity + kGrowSlots;
+    size_t size = FileSizeFor(capacity, sizeof(Header), sizeof(Slot));
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    void* mapping = mremap(mapping_, mapping_size_, size, MREMAP_MAYMOVE);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    mapping_ = mapping;
+    mapping_size_ = size;
+    header_ = static_cast<Header*>(mapping);
+    slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+    header_->capacity = capacity;
+    return true;
+}
+
+void DownloadHistoryLinux::Recover() {
+    // The header and the slots reach the disk in no particular order, so
+    // the count may be ahead of the records or behind them.
+    uint64_t count = std::min(header_->count, header_->capacity);
+    while (count > 0 && slots_[count - 1].sequence != count) {
+        --count;
+    }
+    while (count < header_->capacity && slots_[count].sequence == count + 1) {
+        ++count;
+    }
+    if (count == header_->count) {
+        return;
+    }
+
+    header_->count = count;
+    header_->total_size = 0;
+    header_->total_bytes = 0;
+    header_->total_duration_ms = 0;
+    header_->first_ms = count > 0 ? slots_[0].finished_ms : 0;
+    header_->last_ms = count > 0 ? slots_[count - 1].finished_ms : 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        header_->total_size += slots_[i].size;
+        header_->total_bytes += slots_[i].bytes;
+        header_->total_duration_ms += slots_[i].duration_ms;
+    }
+}
+
+bool DownloadHistoryLinux::Append(const DownloadHistoryRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_ == nullptr) {
+        return false;
+    }
+    if (header_->count == header_->capacity && !Grow()) {
+        return false;
+    }
+
+    uint64_t index = header_->count;
+    Slot* slot = &slots_[index];
+    memset(slot, 0, sizeof(*slot));
+    slot->content_hash = record.content_hash;
+    slot->size = record.size;
+    slot->bytes = record.bytes;
+    slot->started_ms = record.started_ms;
+    slot->finished_ms = record.finished_ms;
+    slot->duration_ms = record.duration_ms;
+    CopyString(slot->link_type, sizeof(slot->link_type), record.link_type);
+    CopyString(slot->filename, sizeof(slot->filename), record.filename);
+    __atomic_store_n(&slot->sequence, index + 1, __ATOMIC_RELEASE);
+
+    header_->count = index + 1;
+    header_->total_size += record.size;
+    header_->total_bytes += record.bytes;
+    header_->total_duration_ms += record.duration_ms;
+    if (index == 0) {
+        header_->first_ms = record.finished_ms;
+    }
+    header_->last_ms = record.finished_ms;
+
+    appended_ = header_->count;
+    commit_wanted_.notify_one();
+    return true;
+}
+
+DownloadHistoryRecord DownloadHistoryLinux::Read(uint64_t index) const {
+    const Slot& slot = slots_[index];
+    DownloadHistoryRecord record;
+    record.filename.assign(slot.filename, strnlen(slot.filename, sizeof(slot.filename)));
+    record.link_type.assign(slot.link_type, strnlen(slot.link_type, sizeof(slot.link_type)));
+    record.size = slot.size;
+    record.bytes = slot.bytes;
+    record.content_hash = slot.content_hash;
+    record.started_ms = slot.started_ms;
+    record.finished_ms = slot.finished_ms;
+    record.duration_ms = slot.duration_ms;
+    return record;
+}
+
+std::vector<DownloadHistoryRecord> DownloadHistoryLinux::Last(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DownloadHistoryRecord> records;
+    if (header_ == nullptr) {
+        return records;
+    }
+    for (uint64_t i = header_->count; i > 0 && records.size() < count; --i) {
+        records.push_back(Read(i - 1));
+    }
+    return records;
+}
+
+std::vector<DownloadHistoryRecord> DownloadHistoryLinux::Since(int64_t since_ms, size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DownloadHistoryRecord> records;
+    if (header_ == nullptr) {
+        return records;
+    }
+    for (uint64_t i = header_->count; i > 0 && records.size() < limit; --i) {
+        if (slots_[i - 1].finished_ms < since_ms) break;
+        records.push_back(Read(i - 1));
+    }
+    return records;
+}
+
+DownloadHistoryStats DownloadHistoryLinux::Stats(int64_t since_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DownloadHistoryStats stats;
+    if (header_ == nullptr) {
+        return stats;
+    }
+    if (since_ms <= 0) {
+        stats.count = static_cast<int64_t>(header_->count);
+        stats.size = header_->total_size;
+        stats.bytes = header_->total_bytes;
+        stats.duration_ms = header_->total_duration_ms;
+        stats.first_ms = header_->first_ms;
+        stats.last_ms = header_->last_ms;
+        return stats;
+    }
+    for (uint64_t i = header_->count; i > 0; --i) {
+        const Slot& slot = slots_[i - 1];
+        if (slot.finished_ms < since_ms) break;
+        if (stats.count == 0) {
+            stats.last_ms = slot.finished_ms;
+        }
+        stats.count++;
+        stats.size += slot.size;
+        stats.bytes += slot.bytes;
+        stats.duration_ms += slot.duration_ms;
+        stats.first_ms = slot.finished_ms;
+    }
+    return stats;
+}
+
+size_t DownloadHistoryLinux::Count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_ != nullptr ? static_cast<size_t>(header_->count) : 0;
+}
+
+void DownloadHistoryLinux::RunCommitter() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        commit_wanted_.wait(lock, [this] { return stopping_ || appended_ > committed_; });
+        if (appended_ == committed_) {
+            return;  // stopping, and everything is on disk
+        }
+        // Let the rest of a burst join this commit.
+        if (!stopping_) {
+            commit_wanted_.wait_for(lock, std::chrono::milliseconds(kCommitDelayMs),
+                                    [this] { return stopping_; });
+        }
+        uint64_t target = appended_;
+        int fd = fd_;
+        // Appends go on while the disk catches up; fdatasync() also flushes
+        // pages written through the mapping.
+        lock.unlock();
+        fdatasync(fd);
+        lock.lock();
+        committed_ = target;
+    }
+}
+
+std::string DownloadHistoryLinux::DefaultPath(const char* application_id) {
+    return AppDataPath(application_id, "history.log");
+}
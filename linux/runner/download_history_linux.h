@@ -0,0 +1,111 @@
+#ifndef DOWNLOAD_HISTORY_LINUX_H_
+#define DOWNLOAD_HISTORY_LINUX_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One completed download. Times are wall clock, in ms since the epoch.
+struct DownloadHistoryRecord {
+    std::string filename;
+    // Network type the download ran on ("wifi", "ethernet", ...).
+    std::string link_type;
+    // Size of the saved file.
+    int64_t size = 0;
+    // Bytes transferred; less than |size| when the download was resumed.
+    int64_t bytes = 0;
+    uint64_t content_hash = 0;
+    int64_t started_ms = 0;
+    int64_t finished_ms = 0;
+    // Time spent transferring, which excludes queueing and saving.
+    int64_t duration_ms = 0;
+};
+
+// Totals over a range of records.
+struct DownloadHistoryStats {
+    int64_t count = 0;
+    int64_t size = 0;
+    int64_t bytes = 0;
+    int64_t duration_ms = 0;
+    int64_t first_ms = 0;
+    int64_t last_ms = 0;
+};
+
+// Append-only journal of every completed download, for auditing.
+//
+// Records are fixed 256-byte slots in a memory-mapped file, so an append is
+// a copy into the page cache under a mutex and never waits for the disk;
+// the file grows a megabyte at a time. Durability is group-committed: a
+// background thread flushes everything appended within kCommitDelayMs with
+// one fdatasync(). A record's sequence number is written last and slots
+// never straddle a sector, so after a crash the journal ends at the last
+// complete record; at most the uncommitted tail is lost.
+//
+// The header keeps running totals, so all-time stats cost nothing; "last N"
+// and "since T" read backwards from the end and touch only what they return.
+class DownloadHistoryLinux {
+public:
+    explicit DownloadHistoryLinux(const std::string& path);
+    // Commits what is pending first.
+    ~DownloadHistoryLinux();
+
+    // Maps the journal, creating it (and its directory) if needed. A file
+    // that fails validation is set aside as <path>.bad and a new one begun.
+    bool Open();
+    void Close();
+
+    bool Append(const DownloadHistoryRecord& record);
+
+    // The newest |count| records, newest first.
+    std::vector<DownloadHistoryRecord> Last(size_t count);
+
+    // Records finished at or after |since_ms|, newest first, at most |limit|.
+    // Assumes records were appended in time order, so a clock stepped back
+    // can hide older ones.
+    std::vector<DownloadHistoryRecord> Since(int64_t since_ms, size_t limit);
+
+    // Totals over the records finished at or after |since_ms| (0 for all).
+    DownloadHistoryStats Stats(int64_t since_ms);
+
+    size_t Count();
+
+    // Location used by the runner: $XDG_DATA_HOME/<application id>/history.log
+    static std::string DefaultPath(const char* application_id);
+
+private:
+    static constexpr int kCommitDelayMs = 200;
+
+    struct Header;
+    struct Slot;
+
+    bool Map(uint64_t capacity, bool create);
+    void Unmap();
+    bool Grow();
+    // Finds the last complete record after a crash; fixes the totals.
+    void Recover();
+    DownloadHistoryRecord Read(uint64_t index) const;
+    void RunCommitter();
+
+    std::string path_;
+    std::mutex mutex_;
+
+    int fd_;
+    void* mapping_;
+    size_t mapping_size_;
+    Header* header_;
+    Slot* slots_;
+
+    // Group commit: records up to |appended_| are in the page cache, up to
+    // |committed_| on disk.
+    std::condition_variable commit_wanted_;
+    std::thread committer_;
+    uint64_t appended_;
+    uint64_t committed_;
+    bool stopping_;
+};
+
+#endif  // DOWNLOAD_HISTORY_LINUX_H_
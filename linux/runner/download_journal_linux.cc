@@ -0,0 +1,178 @@
+#include "download_journal_linux.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'I', 'D', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr uint32_t kVersion = 1;
+// Far more than any real journal; guards against reading garbage.
+constexpr size_t kMaxJournalSize = 1 << 20;
+
+// File layout: Header, url, validator, range_count x {start, end}, then the
+// XXH64 of everything before it.
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t range_count;
+    int64_t total;
+    int64_t hashed;
+    ContentHasher::State hash_state;
+    uint32_t url_size;
+    uint32_t validator_size;
+};
+
+void Append(std::vector<uint8_t>* out, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+}  // namespace
+
+void DownloadJournal::AddRange(int64_t start, int64_t end) {
+    if (end <= start) {
+        return;
+    }
+    // Absorb a range that starts before |start| and reaches it.
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin()) {
+        auto previous = std::prev(it);
+        if (previous->second >= start) {
+            start = previous->first;
+            end = std::max(end, previous->second);
+            it = ranges.erase(previous);
+        }
+    }
+    // Absorb ranges that start inside [start, end].
+    while (it != ranges.end() && it->first <= end) {
+        end = std::max(end, it->second);
+        it = ranges.erase(it);
+    }
+    ranges[start] = end;
+}
+
+int64_t DownloadJournal::BytesWritten() const {
+    int64_t bytes = 0;
+    for (const auto& range : ranges) {
+        bytes += range.second - range.first;
+    }
+    return bytes;
+}
+
+bool DownloadJournal::Load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    std::vector<uint8_t> data(kMaxJournalSize);
+    size_t size = 0;
+    while (size < data.size()) {
+        ssize_t n = read(fd, data.data() + size, data.size() - size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        size += static_cast<size_t>(n);
+    }
+    close(fd);
+
+    Header header;
+    if (size < sizeof(header) + sizeof(uint64_t)) {
+        return false;
+    }
+    uint64_t checksum;
+    memcpy(&checksum, data.data() + size - sizeof(checksum), sizeof(checksum));
+    if (ContentHasher::Hash(data.data(), size - sizeof(checksum)) != checksum) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    size_t expected = sizeof(header) + header.url_size + header.validator_size +
+                      static_cast<size_t>(header.range_count) * 2 * sizeof(int64_t) +
+                      sizeof(checksum);
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.url_size > kMaxJournalSize || header.validator_size > kMaxJournalSize ||
+        header.range_count > kMaxJournalSize || expected != size || header.total < 0 ||
+        header.hashed < 0 || header.hashed > header.total) {
+        return false;
+    }
+
+    const uint8_t* p = data.data() + sizeof(header);
+    url.assign(reinterpret_cast<const char*>(p), header.url_size);
+    p += header.url_size;
+    validator.assign(reinterpret_cast<const char*>(p), header.validator_size);
+    p += header.validator_size;
+    ranges.clear();
+    int64_t previous_end = 0;
+    for (uint32_t i = 0; i < header.range_count; ++i) {
+        int64_t range[2];
+        memcpy(range, p, sizeof(range));
+        p += sizeof(range);
+        if (range[0] < previous_end || range[1] <= range[0] || range[1] > header.total) {
+            return false;
+        }
+        ranges[range[0]] = range[1];
+        previous_end = range[1];
+    }
+    total = header.total;
+    hashed = header.hashed;
+    hash_state = header.hash_state;
+    return true;
+}
+
+bool DownloadJournal::Save(const std::string& path) const {
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.range_count = static_cast<uint32_t>(ranges.size());
+    header.total = total;
+    header.hashed = hashed;
+    header.hash_state = hash_state;
+    header.url_size = static_cast<uint32_t>(url.size());
+    header.validator_size = static_cast<uint32_t>(validator.size());
+
+    std::vector<uint8_t> data;
+    data.reserve(sizeof(header) + url.size() + validator.size() + ranges.size() * 16 + 8);
+    Append(&data, &header, sizeof(header));
+    Append(&data, url.data(), url.size());
+    Append(&data, validator.data(), validator.size());
+    for (const auto& range : ranges) {
+        int64_t entry[2] = {range.first, range.second};
+        Append(&data, entry, sizeof(entry));
+    }
+    uint64_t checksum = ContentHasher::Hash(data.data(), data.size());
+    Append(&data, &checksum, sizeof(checksum));
+
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = WriteAll(fd, data.data(), data.size());
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string DownloadJournal::PathFor(const std::string& destination) {
+    return destination + ".journal";
+}
@@ -0,0 +1,41 @@
+#ifndef DOWNLOAD_JOURNAL_LINUX_H_
+#define DOWNLOAD_JOURNAL_LINUX_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "content_hash.h"
+
+// Progress of an interrupted download, kept in a small file next to the
+// partial download so it can be continued, even after a restart.
+//
+// Besides the byte ranges already written it records the validator the
+// server sent (a strong ETag, or Last-Modified), which goes out as If-Range
+// when resuming so a changed object is fetched afresh instead of being
+// spliced together, and the content hash state, so the hash of the finished
+// file doesn't need a second pass over the bytes from before the restart.
+struct DownloadJournal {
+    std::string url;
+    std::string validator;
+    int64_t total = -1;
+    // Bytes [0, hashed) are folded into hash_state.
+    int64_t hashed = 0;
+    ContentHasher::State hash_state = {};
+    // Written ranges, start -> end (exclusive), non-overlapping.
+    std::map<int64_t, int64_t> ranges;
+
+    // Adds [start, end), merging it with the ranges it touches.
+    void AddRange(int64_t start, int64_t end);
+    int64_t BytesWritten() const;
+
+    // Reads a journal; false if it is missing or fails validation.
+    bool Load(const std::string& path);
+    // Replaces the journal at |path| atomically (write, then rename).
+    bool Save(const std::string& path) const;
+
+    // "<destination>.journal"
+    static std::string PathFor(const std::string& destination);
+};
+
+#endif  // DOWNLOAD_JOURNAL_LINUX_H_
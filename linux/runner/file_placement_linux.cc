@@ -0,0 +1,163 @@
+#include "file_placement_linux.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Copies |length| bytes in the kernel. copy_file_range() can't cross
+// filesystems before Linux 5.3 (and again between 5.3 and 5.18 for most of
+// them), so sendfile() picks up where it refuses.
+bool CopyInKernel(int in, int out, off_t length) {
+    bool use_sendfile = false;
+    off_t copied = 0;
+    while (copied < length) {
+        ssize_t n;
+        if (!use_sendfile) {
+            n = copy_file_range(in, nullptr, out, nullptr, length - copied, 0);
+            if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                          errno == EOPNOTSUPP)) {
+                use_sendfile = true;
+                continue;
+            }
+        } else {
+            n = sendfile(out, in, nullptr, length - copied);
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) break;  // source shrank underneath us
+        copied += n;
+    }
+    return copied == length;
+}
+
+std::string ErrnoMessage(const char* what) {
+    return std::string(what) + ": " + strerror(errno);
+}
+
+bool SyncPath(const std::string& path, int flags) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = (flags & O_DIRECTORY) ? fsync(fd) == 0 : fdatasync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+}  // namespace
+
+FilePlacementLinux::Method FilePlacementLinux::Place(const std::string& source,
+                                                     const std::string& destination,
+                                                     bool sync, std::string* error) {
+    if (sync && !SyncPath(source, 0)) {
+        *error = ErrnoMessage("cannot sync source");
+        return Method::kFailed;
+    }
+    if (rename(source.c_str(), destination.c_str()) == 0) {
+        if (sync) {
+            // Best effort: the file is in place either way.
+            SyncPath(DirectoryOf(destination), O_DIRECTORY);
+        }
+        return Method::kRenamed;
+    }
+    if (errno != EXDEV) {
+        *error = ErrnoMessage("rename failed");
+        return Method::kFailed;
+    }
+
+    int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        *error = ErrnoMessage("cannot open source");
+        return Method::kFailed;
+    }
+    struct stat info;
+    if (fstat(in, &info) != 0) {
+        *error = ErrnoMessage("cannot stat source");
+        close(in);
+        return Method::kFailed;
+    }
+
+    std::string partial = PartialPath(destination);
+    int out = open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        *error = ErrnoMessage("cannot create destination");
+        close(in);
+        return Method::kFailed;
+    }
+
+    Method method = Method::kReflinked;
+    if (ioctl(out, FICLONE, in) != 0) {
+        method = Method::kCopied;
+        // Reserve the space in one extent up front; a full disk then fails
+        // here rather than part way through the copy.
+        if (info.st_size > 0 && fallocate(out, 0, 0, info.st_size) != 0 &&
+            errno != EOPNOTSUPP) {
+            *error = ErrnoMessage("cannot allocate destination");
+            method = Method::kFailed;
+        } else if (!CopyInKernel(in, out, info.st_size)) {
+            *error = ErrnoMessage("copy failed");
+            method = Method::kFailed;
+        }
+    }
+    close(in);
+
+    if (sync && method != Method::kFailed && fdatasync(out) != 0) {
+        *error = ErrnoMessage("cannot sync destination");
+        method = Method::kFailed;
+    }
+    if (close(out) != 0 && method != Method::kFailed) {
+        *error = ErrnoMessage("cannot write destination");
+        method = Method::kFailed;
+    }
+    if (method != Method::kFailed && rename(partial.c_str(), destination.c_str()) != 0) {
+        *error = ErrnoMessage("cannot move destination into place");
+        method = Method::kFailed;
+    }
+    if (method == Method::kFailed) {
+        unlink(partial.c_str());
+        return method;
+    }
+    if (sync) {
+        SyncPath(DirectoryOf(destination), O_DIRECTORY);
+    }
+
+    unlink(source.c_str());
+    return method;
+}
+
+const char* FilePlacementLinux::MethodName(Method method) {
+    switch (method) {
+        case Method::kRenamed:
+            return "rename";
+        case Method::kReflinked:
+            return "reflink";
+        case Method::kCopied:
+            return "copy";
+        case Method::kFailed:
+            break;
+    }
+    return "failed";
+}
+
+std::string FilePlacementLinux::PartialPath(const std::string& destination) {
+    size_t slash = destination.rfind('/');
+    std::string directory = slash == std::string::npos ? "" : destination.substr(0, slash + 1);
+    std::string name = slash == std::string::npos ? destination : destination.substr(slash + 1);
+    return directory + "." + name + ".partial";
+}
+
+std::string FilePlacementLinux::DirectoryOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
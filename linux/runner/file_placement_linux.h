@@ -0,0 +1,39 @@
+#ifndef FILE_PLACEMENT_LINUX_H_
+#define FILE_PLACEMENT_LINUX_H_
+
+#include <string>
+
+// Moves a finished download to its final path with as little I/O as the
+// filesystems allow.
+class FilePlacementLinux {
+public:
+    enum class Method {
+        kFailed,
+        // Same filesystem: a metadata-only rename.
+        kRenamed,
+        // Different mount of a filesystem with shared extents (btrfs, XFS).
+        kReflinked,
+        // Data copied in the kernel with copy_file_range()/sendfile().
+        kCopied,
+    };
+
+    // Places |source| at |destination|, replacing any file already there.
+    // The destination only ever appears complete: anything other than a
+    // rename is written to a hidden ".partial" sibling first and renamed over
+    // it. |source| is gone afterwards unless the placement failed, in which
+    // case |error| says why.
+    // With |sync| the data is on disk before the destination name appears
+    // and the name itself is on disk when this returns.
+    static Method Place(const std::string& source, const std::string& destination, bool sync,
+                        std::string* error);
+
+    static const char* MethodName(Method method);
+
+    // "<dir>/.<name>.partial" for "<dir>/<name>".
+    static std::string PartialPath(const std::string& destination);
+
+    // "<dir>" for "<dir>/<name>", "." for a bare name.
+    static std::string DirectoryOf(const std::string& path);
+};
+
+#endif  // FILE_PLACEMENT_LINUX_H_
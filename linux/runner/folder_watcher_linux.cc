@@ -0,0 +1,292 @@
+#include "folder_watcher_linux.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iterator>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+int DepthOf(const std::string& shard) {
+    return shard.empty() ? 0 : 1 + static_cast<int>(std::count(shard.begin(), shard.end(), '/'));
+}
+
+std::string Join(const std::string& shard, const std::string& name) {
+    return shard.empty() ? name : shard + "/" + name;
+}
+
+}  // namespace
+
+FolderWatcherLinux::FolderWatcherLinux(UpdateCallback callback, gpointer user_data)
+    : callback_(callback),
+      user_data_(user_data),
+      inotify_fd_(-1),
+      wake_fd_(-1),
+      running_(false),
+      rescan_(false),
+      dispatch_scheduled_(false) {}
+
+FolderWatcherLinux::~FolderWatcherLinux() {
+    Stop();
+}
+
+bool FolderWatcherLinux::Start(const std::string& root) {
+    if (running_.load()) {
+        if (root == root_) {
+            return true;
+        }
+        Stop();
+    }
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        return false;
+    }
+
+    root_ = root;
+    rescan_.store(true);
+    running_.store(true);
+    thread_ = std::thread(&FolderWatcherLinux::Run, this);
+    return true;
+}
+
+void FolderWatcherLinux::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) == -1) {
+        g_warning("Failed to wake folder watcher thread");
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    g_source_remove_by_user_data(this);
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_ = FolderUpdate();
+        dispatch_scheduled_ = false;
+    }
+
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    shards_.clear();
+    close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+void FolderWatcherLinux::Rescan() {
+    if (!running_.load()) {
+        return;
+    }
+    rescan_.store(true);
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) == -1) {
+        g_warning("Failed to wake folder watcher thread");
+    }
+}
+
+void FolderWatcherLinux::Run() {
+    bool live = false;
+    while (running_.load()) {
+        if (rescan_.exchange(false)) {
+            FolderUpdate update;
+            update.reset = true;
+            live = ScanAll(&update);
+            if (!live) {
+                update.live = false;
+                update.changes.clear();
+            }
+            Publish(std::move(update));
+        }
+
+        struct pollfd fds[2];
+        fds[0].fd = wake_fd_;
+        fds[0].events = POLLIN;
+        fds[1].fd = inotify_fd_;
+        fds[1].events = POLLIN;
+        int ready = poll(fds, live ? 2 : 1, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            g_warning("Folder watcher poll failed: %d", errno);
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            // Stop() or Rescan(); the flags say which.
+            uint64_t count;
+            if (read(wake_fd_, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                g_warning("Failed to clear folder watcher wakeup: %d", errno);
+            }
+            continue;
+        }
+        if (!live || !(fds[1].revents & POLLIN)) continue;
+
+        FolderUpdate update;
+        if (!DrainEvents(&update)) {
+            rescan_.store(true);
+            continue;
+        }
+        if (!update.live) {
+            // The folder itself is gone; wait for Rescan().
+            live = false;
+            update.reset = true;
+            update.changes.clear();
+            Publish(std::move(update));
+        } else if (!update.changes.empty()) {
+            Publish(std::move(update));
+        }
+    }
+}
+
+bool FolderWatcherLinux::ScanAll(FolderUpdate* update) {
+    // A fresh descriptor drops every old watch and any queued events.
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+    }
+    shards_.clear();
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        g_warning("inotify unavailable: %d", errno);
+        return false;
+    }
+    return Scan("", 0, update);
+}
+
+bool FolderWatcherLinux::Scan(const std::string& shard, int depth, FolderUpdate* update) {
+    // Watched before it is listed, so no file can slip in between.
+    if (!Watch(shard)) {
+        // A shard removed meanwhile is simply gone.
+        return depth > 0 && (errno == ENOENT || errno == ENOTDIR);
+    }
+
+    std::string path = shard.empty() ? root_ : root_ + "/" + shard;
+    DIR* directory = opendir(path.c_str());
+    if (directory == nullptr) {
+        return depth > 0;
+    }
+    bool ok = true;
+    while (struct dirent* entry = readdir(directory)) {
+        // Also skips "." and "..".
+        if (entry->d_name[0] == '.') continue;
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat info;
+            if (fstatat(dirfd(directory), entry->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+        if (type == DT_REG) {
+            update->changes.push_back(FolderChange{entry->d_name, shard, true});
+        } else if (type == DT_DIR && depth < kMaxDepth) {
+            ok = Scan(Join(shard, entry->d_name), depth + 1, update) && ok;
+        }
+    }
+    closedir(directory);
+    return ok;
+}
+
+bool FolderWatcherLinux::Watch(const std::string& shard) {
+    std::string path = shard.empty() ? root_ : root_ + "/" + shard;
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE |
+                    IN_ONLYDIR;
+    if (shard.empty()) {
+        mask |= IN_DELETE_SELF | IN_MOVE_SELF;
+    }
+    int wd = inotify_add_watch(inotify_fd_, path.c_str(), mask);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            g_warning("Out of inotify watches for %s", path.c_str());
+        }
+        return false;
+    }
+    shards_[wd] = shard;
+    return true;
+}
+
+bool FolderWatcherLinux::DrainEvents(FolderUpdate* update) {
+    alignas(struct inotify_event) char buffer[16384];
+    while (true) {
+        ssize_t len = read(inotify_fd_, buffer, sizeof(buffer));
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            break;  // EAGAIN: queue is empty
+        }
+        if (len == 0) break;
+
+        for (char* next = buffer; next < buffer + len;) {
+            const struct inotify_event* event = reinterpret_cast<struct inotify_event*>(next);
+            next += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                return false;  // events were lost
+            }
+            auto found = shards_.find(event->wd);
+            if (found == shards_.end()) continue;
+            std::string shard = found->second;
+            if (event->mask & IN_IGNORED) {
+                shards_.erase(found);
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                update->live = false;
+                return true;
+            }
+            if (event->len == 0 || event->name[0] == '.') continue;
+
+            if (event->mask & IN_ISDIR) {
+                // Its files left with it, unreported.
+                if (event->mask & IN_MOVED_FROM) {
+                    return false;
+                }
+                int depth = DepthOf(shard) + 1;
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && depth <= kMaxDepth &&
+                    !Scan(Join(shard, event->name), depth, update)) {
+                    return false;
+                }
+            } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                update->changes.push_back(FolderChange{event->name, shard, true});
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                update->changes.push_back(FolderChange{event->name, shard, false});
+            }
+        }
+    }
+    return true;
+}
+
+void FolderWatcherLinux::Publish(FolderUpdate&& update) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    if (update.reset) {
+        pending_ = std::move(update);
+    } else {
+        pending_.changes.insert(pending_.changes.end(),
+                                std::make_move_iterator(update.changes.begin()),
+                                std::make_move_iterator(update.changes.end()));
+    }
+    if (!dispatch_scheduled_) {
+        dispatch_scheduled_ = true;
+        g_idle_add(DispatchPending, this);
+    }
+}
+
+gboolean FolderWatcherLinux::DispatchPending(gpointer user_data) {
+    FolderWatcherLinux* self = static_cast<FolderWatcherLinux*>(user_data);
+    FolderUpdate update;
+    {
+        std::lock_guard<std::mutex> lock(self->pending_mutex_);
+        std::swap(update, self->pending_);
+        self->dispatch_scheduled_ = false;
+    }
+    self->callback_(update, self->user_data_);
+    return G_SOURCE_REMOVE;
+}
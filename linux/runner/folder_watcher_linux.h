@@ -0,0 +1,96 @@
+#ifndef FOLDER_WATCHER_LINUX_H_
+#define FOLDER_WATCHER_LINUX_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glib.h>
+
+// A file that appeared in or left the watched folder.
+struct FolderChange {
+    std::string name;
+    // Directory under the folder, "" for the folder itself.
+    std::string shard;
+    bool present = true;
+};
+
+struct FolderUpdate {
+    // |changes| lists every file, replacing whatever was delivered before.
+    bool reset = false;
+    // False once the folder can't be followed any more (removed, or out of
+    // inotify watches); nothing is delivered after that until Rescan().
+    bool live = true;
+    std::vector<FolderChange> changes;
+};
+
+// Keeps an up-to-date list of the image folder's files without polling it.
+//
+// A background thread lists the folder and its shard directories once, then
+// sleeps in poll() on an inotify descriptor watching each of them and an
+// eventfd. Files count once complete: closed after writing, or renamed in.
+// Removals, including the user's, are reported as they happen. Hidden files
+// (downloads in progress) are left out. Moving a directory out, or an
+// overflowed event queue, costs a fresh listing.
+//
+// Changes from one wakeup are delivered together on the GLib main context;
+// updates the main context hasn't picked up yet are merged, so a burst of
+// saves costs one dispatch.
+class FolderWatcherLinux {
+public:
+    // Invoked on the main context with each delivered update.
+    typedef void (*UpdateCallback)(const FolderUpdate& update, gpointer user_data);
+
+    FolderWatcherLinux(UpdateCallback callback, gpointer user_data);
+    ~FolderWatcherLinux();
+
+    // Starts watching |root|; the first update is a full listing. Watching
+    // another folder restarts the thread.
+    bool Start(const std::string& root);
+
+    // Wakes the thread and joins it; undelivered updates are discarded.
+    void Stop();
+
+    // Lists the folder again from scratch, e.g. after it was re-created.
+    void Rescan();
+
+    bool IsRunning() const { return running_.load(); }
+    const std::string& root() const { return root_; }
+
+private:
+    // Shard directories below the root that are followed: YYYY/MM/DD.
+    static constexpr int kMaxDepth = 3;
+
+    void Run();
+    // Re-creates the inotify descriptor and lists everything under root_.
+    bool ScanAll(FolderUpdate* update);
+    bool Scan(const std::string& shard, int depth, FolderUpdate* update);
+    bool Watch(const std::string& shard);
+    // Handles every queued event; returns false if a full rescan is needed.
+    bool DrainEvents(FolderUpdate* update);
+    void Publish(FolderUpdate&& update);
+    static gboolean DispatchPending(gpointer user_data);
+
+    UpdateCallback callback_;
+    gpointer user_data_;
+
+    std::string root_;
+    int inotify_fd_;
+    int wake_fd_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> rescan_;
+
+    // Watch descriptor to shard, owned by the thread.
+    std::map<int, std::string> shards_;
+
+    // Update not yet delivered, merged across publishes.
+    std::mutex pending_mutex_;
+    FolderUpdate pending_;
+    bool dispatch_scheduled_;
+};
+
+#endif  // FOLDER_WATCHER_LINUX_H_
@@ -0,0 +1,188 @@
+#include "io_uring_linux.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int Setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int Enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+int Register(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+template <typename T>
+T* At(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+IoUringLinux::IoUringLinux()
+    : fd_(-1),
+      entries_(0),
+      supported_(),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_mask_(nullptr),
+      sq_array_(nullptr),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(nullptr),
+      cqes_(nullptr),
+      sqe_tail_(0),
+      submitted_tail_(0) {}
+
+IoUringLinux::~IoUringLinux() {
+    if (sqes_ != MAP_FAILED) {
+        munmap(sqes_, entries_ * sizeof(io_uring_sqe));
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool IoUringLinux::Init(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd_ = Setup(entries, &params);
+    if (fd_ < 0) {
+        return false;
+    }
+    entries_ = params.sq_entries;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+        return false;
+    }
+    void* sqes = mmap(nullptr, entries_ * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = At<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = At<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = At<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = At<unsigned>(sq_ring_, params.sq_off.array);
+    cq_head_ = At<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = At<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = At<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = At<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+    sqe_tail_ = submitted_tail_ = *sq_tail_;
+
+    // Probing needs 5.6; older kernels lack most file opcodes anyway, so
+    // nothing counts as supported there.
+    size_t probe_size = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+    io_uring_probe* probe = static_cast<io_uring_probe*>(calloc(1, probe_size));
+    if (probe != nullptr && Register(fd_, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0) {
+        for (unsigned i = 0; i < probe->ops_len && i < IORING_OP_LAST; ++i) {
+            supported_[i] = (probe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+        }
+    }
+    free(probe);
+    return true;
+}
+
+bool IoUringLinux::Supports(uint8_t opcode) const {
+    return opcode < IORING_OP_LAST && supported_[opcode];
+}
+
+io_uring_sqe* IoUringLinux::GetSqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= entries_) {
+        return nullptr;
+    }
+    unsigned index = sqe_tail_ & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    return sqe;
+}
+
+bool IoUringLinux::Submit(unsigned wait) {
+    unsigned submit = sqe_tail_ - submitted_tail_;
+    // The SQEs must be written before the kernel can see the new tail.
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    submitted_tail_ = sqe_tail_;
+
+    unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (submit > 0 || wait > 0) {
+        int result = Enter(fd_, submit, wait, flags);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (result == 0 && submit > 0) {
+            return false;
+        }
+        submit -= std::min(submit, static_cast<unsigned>(result));
+        if (submit == 0) {
+            break;
+        }
+    }
+    // With nothing left to submit, a retry after EINTR only waits.
+    while (wait > 0) {
+        unsigned ready = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) - *cq_head_;
+        if (ready >= wait) {
+            break;
+        }
+        if (Enter(fd_, 0, wait - ready, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+io_uring_cqe* IoUringLinux::PeekCqe() {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+    return &cqes_[head & *cq_mask_];
+}
+
+void IoUringLinux::Advance() {
+    __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+unsigned IoUringLinux::InFlight() const {
+    return __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) - *cq_head_;
+}
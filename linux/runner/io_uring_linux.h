@@ -0,0 +1,65 @@
+#ifndef IO_URING_LINUX_H_
+#define IO_URING_LINUX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Minimal io_uring submission/completion ring on the raw syscalls, for
+// batching file operations: queue any number of SQEs, then submit them all
+// and wait for their completions with one io_uring_enter().
+//
+// Not thread-safe; meant to be owned by a single worker thread.
+class IoUringLinux {
+public:
+    IoUringLinux();
+    ~IoUringLinux();
+
+    // Returns false if the kernel has no io_uring or it is blocked (seccomp,
+    // io_uring_disabled); the caller should fall back to plain syscalls.
+    bool Init(unsigned entries);
+
+    // Whether the running kernel implements |opcode| (IORING_OP_*).
+    bool Supports(uint8_t opcode) const;
+
+    // Next free SQE, zeroed, or nullptr if |entries| are already queued.
+    io_uring_sqe* GetSqe();
+
+    // Submits every queued SQE and blocks until |wait| completions are
+    // available. Returns false on an io_uring_enter() error other than EINTR.
+    bool Submit(unsigned wait);
+
+    // Oldest unconsumed completion, or nullptr; Advance() consumes it.
+    io_uring_cqe* PeekCqe();
+    void Advance();
+
+    // Requests the kernel has taken whose completions haven't been consumed
+    // yet. Every supported request completes exactly once.
+    unsigned InFlight() const;
+
+private:
+    int fd_;
+    unsigned entries_;
+    bool supported_[IORING_OP_LAST];
+
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    io_uring_cqe* cqes_;
+
+    // SQEs handed out by GetSqe() but not yet made visible to the kernel.
+    unsigned sqe_tail_;
+    unsigned submitted_tail_;
+};
+
+#endif  // IO_URING_LINUX_H_
@@ -5,18 +5,39 @@
 #include <gdk/gdkx.h>
 #endif
 
+#include <algorithm>
+#include <sys/stat.h>
+
 #include "flutter/generated_plugin_registrant.h"
+#include "content_hash.h"
+#include "dedup_index_linux.h"
+#include "download_history_linux.h"
+#include "download_engine_linux.h"
+#include "file_placement_linux.h"
+#include "folder_watcher_linux.h"
+#include "network_event_codec.h"
+#include "network_monitor_linux.h"
 #include "network_service_linux.h"
-#include <thread>
-#include <chrono>
-#include <atomic>
+#include "storage_writer_linux.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
   FlEventChannel* event_channel;
-  std::thread* monitoring_thread;
-  std::atomic<bool>* is_monitoring;
+  NetworkMonitorLinux* network_monitor;
+  // Last snapshot delivered by the monitor, only touched on the main thread.
+  NetworkSnapshot* last_snapshot;
+  // Started on the first download request.
+  DownloadEngineLinux* download_engine;
+  // Opened on first use; only touched on the main thread.
+  DedupIndexLinux* dedup_index;
+  // Started on the first placement request.
+  StorageWriterLinux* storage_writer;
+  FlEventChannel* folder_channel;
+  // Started when Dart asks to watch the image folder.
+  FolderWatcherLinux* folder_watcher;
+  // Opened on first use; only touched on the main thread.
+  DownloadHistoryLinux* download_history;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
@@ -24,7 +45,24 @@ G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 // Forward declarations
 static void start_network_monitoring(MyApplication* self);
 static void stop_network_monitoring(MyApplication* self);
-static void send_network_update(MyApplication* self);
+static void send_network_update(MyApplication* self, const NetworkSnapshot& snapshot);
+static void on_network_snapshot(const NetworkSnapshot& snapshot, gpointer user_data);
+static std::vector<std::string> preferred_interfaces(const NetworkSnapshot& snapshot);
+static void handle_download(MyApplication* self, FlMethodCall* method_call);
+static void handle_download_archive(MyApplication* self, FlMethodCall* method_call);
+static void handle_download_progress(MyApplication* self, FlMethodCall* method_call);
+static void on_download_complete(const DownloadResult& result, gpointer user_data);
+static void handle_place_file(MyApplication* self, FlMethodCall* method_call);
+static void on_place_file_done(const StorageWriteResult& result, gpointer user_data);
+static void handle_has_image(MyApplication* self, FlMethodCall* method_call);
+static void handle_record_image(MyApplication* self, FlMethodCall* method_call);
+static void handle_locate_image(MyApplication* self, FlMethodCall* method_call);
+static void handle_move_images(MyApplication* self, FlMethodCall* method_call);
+static void handle_watch_folder(MyApplication* self, FlMethodCall* method_call);
+static void on_folder_update(const FolderUpdate& update, gpointer user_data);
+static void handle_history_record(MyApplication* self, FlMethodCall* method_call);
+static void handle_history_query(MyApplication* self, FlMethodCall* method_call);
+static void handle_history_stats(MyApplication* self, FlMethodCall* method_call);
 
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
@@ -84,17 +122,27 @@ static void my_application_activate(GApplication* application) {
         g_autoptr(FlMethodResponse) response = nullptr;
 
         if (strcmp(method, "isConnectedToWifiOrEthernet") == 0) {
-          bool result = NetworkServiceLinux::IsConnectedToWifiOrEthernet();
+          bool result = NetworkServiceLinux::GetSnapshot().IsWifiOrEthernet();
           g_autoptr(FlValue) fl_result = fl_value_new_bool(result);
           response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
         } else if (strcmp(method, "getNetworkType") == 0) {
-          std::string result = NetworkServiceLinux::GetNetworkType();
+          std::string result = NetworkServiceLinux::GetSnapshot().network_type;
           g_autoptr(FlValue) fl_result = fl_value_new_string(result.c_str());
           response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
         } else if (strcmp(method, "isConnected") == 0) {
-          bool result = NetworkServiceLinux::IsConnected();
+          bool result = NetworkServiceLinux::GetSnapshot().is_connected;
           g_autoptr(FlValue) fl_result = fl_value_new_bool(result);
           response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+        } else if (strcmp(method, "getStatus") == 0) {
+          // All three fields from one snapshot.
+          NetworkSnapshot snapshot = NetworkServiceLinux::GetSnapshot();
+          g_autoptr(FlValue) fl_result = fl_value_new_map();
+          fl_value_set_string_take(fl_result, "isConnected", fl_value_new_bool(snapshot.is_connected));
+          fl_value_set_string_take(fl_result, "isWifiOrEthernet",
+                                   fl_value_new_bool(snapshot.IsWifiOrEthernet()));
+          fl_value_set_string_take(fl_result, "networkType",
+                                   fl_value_new_string(snapshot.network_type.c_str()));
+          response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
         } else if (strcmp(method, "startNetworkMonitoring") == 0) {
           start_network_monitoring(app);
           response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
@@ -124,6 +172,94 @@ static void my_application_activate(GApplication* application) {
       },
       self, nullptr);
 
+  // Set up method channel for the native download engine
+  g_autoptr(FlMethodChannel) download_channel = fl_method_channel_new(
+      fl_engine_get_binary_messenger(fl_view_get_engine(view)),
+      "download_engine",
+      FL_METHOD_CODEC(fl_standard_method_codec_new()));
+
+  fl_method_channel_set_method_call_handler(download_channel,
+      [](FlMethodChannel* channel, FlMethodCall* method_call, gpointer user_data) {
+        MyApplication* app = MY_APPLICATION(user_data);
+        const gchar* method = fl_method_call_get_name(method_call);
+
+        if (strcmp(method, "download") == 0) {
+          // Responds when the download finishes, see on_download_complete.
+          handle_download(app, method_call);
+        } else if (strcmp(method, "downloadArchive") == 0) {
+          handle_download_archive(app, method_call);
+        } else if (strcmp(method, "progress") == 0) {
+          handle_download_progress(app, method_call);
+        } else {
+          g_autoptr(FlMethodResponse) response =
+              FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+          fl_method_call_respond(method_call, response, nullptr);
+        }
+      },
+      self, nullptr);
+
+  // Set up method channel for native file storage
+  g_autoptr(FlMethodChannel) storage_channel = fl_method_channel_new(
+      fl_engine_get_binary_messenger(fl_view_get_engine(view)),
+      "storage_service",
+      FL_METHOD_CODEC(fl_standard_method_codec_new()));
+
+  fl_method_channel_set_method_call_handler(storage_channel,
+      [](FlMethodChannel* channel, FlMethodCall* method_call, gpointer user_data) {
+        MyApplication* app = MY_APPLICATION(user_data);
+        const gchar* method = fl_method_call_get_name(method_call);
+
+        if (strcmp(method, "placeFile") == 0) {
+          // Responds when the storage writer has placed the file.
+          handle_place_file(app, method_call);
+        } else if (strcmp(method, "hasImage") == 0) {
+          handle_has_image(app, method_call);
+        } else if (strcmp(method, "recordImage") == 0) {
+          // Responds once the file has been hashed.
+          handle_record_image(app, method_call);
+        } else if (strcmp(method, "locateImage") == 0) {
+          handle_locate_image(app, method_call);
+        } else if (strcmp(method, "moveImages") == 0) {
+          handle_move_images(app, method_call);
+        } else if (strcmp(method, "watchFolder") == 0) {
+          handle_watch_folder(app, method_call);
+        } else {
+          g_autoptr(FlMethodResponse) response =
+              FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+          fl_method_call_respond(method_call, response, nullptr);
+        }
+      },
+      self, nullptr);
+
+  // Live listing of the image folder, see on_folder_update.
+  self->folder_channel = fl_event_channel_new(fl_engine_get_binary_messenger(fl_view_get_engine(view)),
+      "storage_service/folder", FL_METHOD_CODEC(fl_standard_method_codec_new()));
+
+  // Set up method channel for the download history journal
+  g_autoptr(FlMethodChannel) history_channel = fl_method_channel_new(
+      fl_engine_get_binary_messenger(fl_view_get_engine(view)),
+      "download_history",
+      FL_METHOD_CODEC(fl_standard_method_codec_new()));
+
+  fl_method_channel_set_method_call_handler(history_channel,
+      [](FlMethodChannel* channel, FlMethodCall* method_call, gpointer user_data) {
+        MyApplication* app = MY_APPLICATION(user_data);
+        const gchar* method = fl_method_call_get_name(method_call);
+
+        if (strcmp(method, "record") == 0) {
+          handle_history_record(app, method_call);
+        } else if (strcmp(method, "last") == 0 || strcmp(method, "since") == 0) {
+          handle_history_query(app, method_call);
+        } else if (strcmp(method, "stats") == 0) {
+          handle_history_stats(app, method_call);
+        } else {
+          g_autoptr(FlMethodResponse) response =
+              FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+          fl_method_call_respond(method_call, response, nullptr);
+        }
+      },
+      self, nullptr);
+
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
 
@@ -168,9 +304,36 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   stop_network_monitoring(self);
-  if (self->is_monitoring) {
-    delete self->is_monitoring;
-    self->is_monitoring = nullptr;
+  if (self->download_engine) {
+    // Fails the downloads still in flight, which answers their method calls.
+    delete self->download_engine;
+    self->download_engine = nullptr;
+  }
+  if (self->storage_writer) {
+    // Places what is queued first, which answers those method calls.
+    delete self->storage_writer;
+    self->storage_writer = nullptr;
+  }
+  if (self->folder_watcher) {
+    delete self->folder_watcher;
+    self->folder_watcher = nullptr;
+  }
+  if (self->dedup_index) {
+    delete self->dedup_index;
+    self->dedup_index = nullptr;
+  }
+  if (self->download_history) {
+    // Commits the records not yet on disk.
+    delete self->download_history;
+    self->download_history = nullptr;
+  }
+  if (self->network_monitor) {
+    delete self->network_monitor;
+    self->network_monitor = nullptr;
+  }
+  if (self->last_snapshot) {
+    delete self->last_snapshot;
+    self->last_snapshot = nullptr;
   }
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
@@ -186,8 +349,15 @@ static void my_application_class_init(MyApplicationClass* klass) {
 
 static void my_application_init(MyApplication* self) {
   self->event_channel = nullptr;
-  self->monitoring_thread = nullptr;
-  self->is_monitoring = new std::atomic<bool>(false);
+  self->network_monitor = new NetworkMonitorLinux(on_network_snapshot, self);
+  self->last_snapshot = new NetworkSnapshot();
+  self->download_engine = new DownloadEngineLinux(on_download_complete, self);
+  self->storage_writer = new StorageWriterLinux(on_place_file_done, self);
+  self->dedup_index = new DedupIndexLinux(DedupIndexLinux::DefaultPath(APPLICATION_ID));
+  self->folder_channel = nullptr;
+  self->folder_watcher = new FolderWatcherLinux(on_folder_update, self);
+  self->download_history =
+      new DownloadHistoryLinux(DownloadHistoryLinux::DefaultPath(APPLICATION_ID));
 }
 
 MyApplication* my_application_new() {
@@ -204,71 +374,688 @@ MyApplication* my_application_new() {
 }
 
 static void start_network_monitoring(MyApplication* self) {
-  if (self->is_monitoring->load()) {
-    return;
+  if (!self->network_monitor->Start()) {
+    g_warning("Failed to start network monitoring");
+  }
+}
+
+static void stop_network_monitoring(MyApplication* self) {
+  if (self->network_monitor) {
+    self->network_monitor->Stop();
+  }
+}
+
+// Runs on the main thread with the newest snapshot the monitor has seen.
+static void on_network_snapshot(const NetworkSnapshot& snapshot, gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  *self->last_snapshot = snapshot;
+  self->download_engine->SetInterfaces(preferred_interfaces(snapshot));
+  send_network_update(self, snapshot);
+}
+
+// Up links downloads may bind to, fastest first. Capacity is the reported
+// speed or Wi-Fi rate, else a guess from the link type. Mobile links are
+// only listed when nothing else is up, so downloads never bind or stripe
+// onto metered data while another link could carry them.
+static std::vector<std::string> preferred_interfaces(const NetworkSnapshot& snapshot) {
+  auto capacity_kbps = [](const NetworkInterfaceInfo& info) -> int64_t {
+    if (info.quality.speed_mbps > 0) return info.quality.speed_mbps * int64_t{1000};
+    if (info.quality.tx_bitrate_kbps > 0) return info.quality.tx_bitrate_kbps;
+    if (info.type == "ethernet") return 1000000;
+    if (info.type == "wifi") return 100000;
+    return 10000;
+  };
+
+  std::vector<const NetworkInterfaceInfo*> up;
+  bool unmetered = false;
+  for (const auto& info : snapshot.interfaces) {
+    if (!info.is_up) continue;
+    up.push_back(&info);
+    unmetered = unmetered || info.type != "mobile";
+  }
+  std::stable_sort(up.begin(), up.end(),
+                   [&](const NetworkInterfaceInfo* a, const NetworkInterfaceInfo* b) {
+                     return capacity_kbps(*a) > capacity_kbps(*b);
+                   });
+
+  std::vector<std::string> names;
+  for (const NetworkInterfaceInfo* info : up) {
+    if (info->type == "mobile" && (unmetered || !names.empty())) continue;
+    names.push_back(info->name);
   }
-  
-  self->is_monitoring->store(true);
-  
-  if (self->monitoring_thread) {
-    delete self->monitoring_thread;
-  }
-  
-  self->monitoring_thread = new std::thread([self]() {
-    std::string lastNetworkType = "";
-    bool lastIsConnected = false;
-    bool lastIsWifiOrEthernet = false;
+  return names;
+}
+
+static void send_network_update(MyApplication* self, const NetworkSnapshot& snapshot) {
+  if (self->event_channel) {
+    // Fixed-size binary payload, see network_event_codec.h.
+    uint8_t payload[kNetworkEventSize];
+    EncodeNetworkEvent(snapshot, payload);
+    g_autoptr(FlValue) network_data = fl_value_new_uint8_list(payload, sizeof(payload));
     
-    while (self->is_monitoring->load()) {
-      std::string currentNetworkType = NetworkServiceLinux::GetNetworkType();
-      bool currentIsConnected = NetworkServiceLinux::IsConnected();
-      bool currentIsWifiOrEthernet = NetworkServiceLinux::IsConnectedToWifiOrEthernet();
-      
-      // Check if network state changed
-      if (currentNetworkType != lastNetworkType || 
-          currentIsConnected != lastIsConnected ||
-          currentIsWifiOrEthernet != lastIsWifiOrEthernet) {
-        
-        lastNetworkType = currentNetworkType;
-        lastIsConnected = currentIsConnected;
-        lastIsWifiOrEthernet = currentIsWifiOrEthernet;
-        
-        send_network_update(self);
-      }
-      
-      std::this_thread::sleep_for(std::chrono::milliseconds(1000)); // Check every second
+    fl_event_channel_send(self->event_channel, network_data, nullptr, nullptr);
+  }
+}
+
+// "expectedSize": int? and "minFreeBytes": int?, shared by the download methods.
+static void read_space_arguments(FlValue* args, DownloadRequest* request) {
+  FlValue* expected_size = fl_value_lookup_string(args, "expectedSize");
+  if (expected_size != nullptr && fl_value_get_type(expected_size) == FL_VALUE_TYPE_INT) {
+    request->expected_size = fl_value_get_int(expected_size);
+  }
+  FlValue* min_free = fl_value_lookup_string(args, "minFreeBytes");
+  if (min_free != nullptr && fl_value_get_type(min_free) == FL_VALUE_TYPE_INT) {
+    request->min_free_bytes = fl_value_get_int(min_free);
+  }
+}
+
+// Arguments: {"url": String, "path": String, "connections": int?, "chunkSize": int?,
+//             "checksum": String?, "bindInterface": bool?, "stripe": bool?,
+//             "resume": bool?, "expectedSize": int?, "minFreeBytes": int?}
+static void handle_download(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* url = nullptr;
+  FlValue* path = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    url = fl_value_lookup_string(args, "url");
+    path = fl_value_lookup_string(args, "path");
+  }
+  if (url == nullptr || fl_value_get_type(url) != FL_VALUE_TYPE_STRING ||
+      path == nullptr || fl_value_get_type(path) != FL_VALUE_TYPE_STRING) {
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "url and path are required", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  DownloadRequest request;
+  request.url = fl_value_get_string(url);
+  request.destination = fl_value_get_string(path);
+  FlValue* connections = fl_value_lookup_string(args, "connections");
+  if (connections != nullptr && fl_value_get_type(connections) == FL_VALUE_TYPE_INT) {
+    request.max_connections = static_cast<int>(fl_value_get_int(connections));
+  }
+  FlValue* chunk_size = fl_value_lookup_string(args, "chunkSize");
+  if (chunk_size != nullptr && fl_value_get_type(chunk_size) == FL_VALUE_TYPE_INT) {
+    request.chunk_size = fl_value_get_int(chunk_size);
+  }
+  FlValue* checksum = fl_value_lookup_string(args, "checksum");
+  if (checksum != nullptr && fl_value_get_type(checksum) == FL_VALUE_TYPE_STRING) {
+    request.has_expected_hash =
+        ParseContentHash(fl_value_get_string(checksum), &request.expected_hash);
+    if (!request.has_expected_hash) {
+      g_warning("Ignoring checksum in unsupported format: %s", fl_value_get_string(checksum));
     }
+  }
+  FlValue* bind_interface = fl_value_lookup_string(args, "bindInterface");
+  if (bind_interface != nullptr && fl_value_get_type(bind_interface) == FL_VALUE_TYPE_BOOL) {
+    request.bind_interface = fl_value_get_bool(bind_interface);
+  }
+  FlValue* stripe = fl_value_lookup_string(args, "stripe");
+  if (stripe != nullptr && fl_value_get_type(stripe) == FL_VALUE_TYPE_BOOL) {
+    request.stripe_interfaces = fl_value_get_bool(stripe);
+  }
+  FlValue* resume = fl_value_lookup_string(args, "resume");
+  if (resume != nullptr && fl_value_get_type(resume) == FL_VALUE_TYPE_BOOL) {
+    request.resume = fl_value_get_bool(resume);
+  }
+  read_space_arguments(args, &request);
+  // Released in on_download_complete.
+  request.context = g_object_ref(method_call);
+
+  if (!self->download_engine->Start() || self->download_engine->Enqueue(request) == 0) {
+    g_object_unref(method_call);
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Download engine failed to start", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+  }
+}
+
+// Arguments: {"url": String, "directory": String, "body": String?,
+//             "bindInterface": bool?, "expectedSize": int?, "minFreeBytes": int?}
+// Unpacks the tar (or tar.zst) response into directory; the result lists the
+// files under "entries".
+static void handle_download_archive(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* url = nullptr;
+  FlValue* directory = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    url = fl_value_lookup_string(args, "url");
+    directory = fl_value_lookup_string(args, "directory");
+  }
+  if (url == nullptr || fl_value_get_type(url) != FL_VALUE_TYPE_STRING ||
+      directory == nullptr || fl_value_get_type(directory) != FL_VALUE_TYPE_STRING) {
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "url and directory are required", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  DownloadRequest request;
+  request.url = fl_value_get_string(url);
+  request.destination = fl_value_get_string(directory);
+  request.extract_archive = true;
+  FlValue* body = fl_value_lookup_string(args, "body");
+  if (body != nullptr && fl_value_get_type(body) == FL_VALUE_TYPE_STRING) {
+    request.post_body = fl_value_get_string(body);
+  }
+  read_space_arguments(args, &request);
+  FlValue* bind_interface = fl_value_lookup_string(args, "bindInterface");
+  if (bind_interface != nullptr && fl_value_get_type(bind_interface) == FL_VALUE_TYPE_BOOL) {
+    request.bind_interface = fl_value_get_bool(bind_interface);
+  }
+  // Released in on_download_complete.
+  request.context = g_object_ref(method_call);
+
+  if (!self->download_engine->Start() || self->download_engine->Enqueue(request) == 0) {
+    g_object_unref(method_call);
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Download engine failed to start", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+  }
+}
+
+// Returns [{"path": String, "bytes": int, "total": int}] for the downloads in
+// flight; total is -1 until known. Polled by the Dart progress sampler.
+static void handle_download_progress(MyApplication* self, FlMethodCall* method_call) {
+  g_autoptr(FlValue) list = fl_value_new_list();
+  if (self->download_engine != nullptr) {
+    for (const DownloadProgress& progress : self->download_engine->Progress()) {
+      FlValue* item = fl_value_new_map();
+      fl_value_set_string_take(item, "path", fl_value_new_string(progress.destination.c_str()));
+      fl_value_set_string_take(item, "bytes", fl_value_new_int(progress.bytes));
+      fl_value_set_string_take(item, "total", fl_value_new_int(progress.total));
+      fl_value_append_take(list, item);
+    }
+  }
+  g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(list));
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+// Runs on the main thread once per download.
+static void on_download_complete(const DownloadResult& result, gpointer user_data) {
+  FlMethodCall* method_call = FL_METHOD_CALL(result.context);
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  g_autoptr(FlValue) details = fl_value_new_map();
+  fl_value_set_string_take(details, "statusCode", fl_value_new_int(result.http_status));
+  fl_value_set_string_take(details, "bytes", fl_value_new_int(result.bytes));
+  fl_value_set_string_take(details, "connections", fl_value_new_int(result.connections));
+  fl_value_set_string_take(details, "resumedBytes", fl_value_new_int(result.resumed_bytes));
+  fl_value_set_string_take(details, "resumable", fl_value_new_bool(result.resumable));
+  fl_value_set_string_take(details, "insufficientSpace",
+                           fl_value_new_bool(result.insufficient_space));
+  fl_value_set_string_take(details, "failure",
+                           fl_value_new_string(DownloadFailureName(result.failure)));
+  if (result.hashed) {
+    fl_value_set_string_take(details, "hash",
+                             fl_value_new_string(FormatContentHash(result.content_hash).c_str()));
+  }
+  if (!result.entries.empty()) {
+    FlValue* entries = fl_value_new_list();
+    for (const ExtractedEntry& entry : result.entries) {
+      FlValue* item = fl_value_new_map();
+      fl_value_set_string_take(item, "name", fl_value_new_string(entry.name.c_str()));
+      fl_value_set_string_take(item, "path", fl_value_new_string(entry.path.c_str()));
+      fl_value_set_string_take(item, "size", fl_value_new_int(entry.size));
+      fl_value_set_string_take(item, "hash",
+                               fl_value_new_string(FormatContentHash(entry.content_hash).c_str()));
+      fl_value_append_take(entries, item);
+    }
+    fl_value_set_string_take(details, "entries", entries);
+  }
+
+  if (result.success) {
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(details));
+  } else {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("DOWNLOAD_FAILED", result.error.c_str(), details));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+  g_object_unref(method_call);
+}
+
+// Runs on the main thread once per placement.
+static void on_place_file_done(const StorageWriteResult& result, gpointer user_data) {
+  FlMethodCall* method_call = FL_METHOD_CALL(result.context);
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  if (result.method != FilePlacementLinux::Method::kFailed) {
+    g_autoptr(FlValue) fl_result =
+        fl_value_new_string(FilePlacementLinux::MethodName(result.method));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  } else {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("PLACEMENT_FAILED", result.error.c_str(), nullptr));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+  g_object_unref(method_call);
+}
+
+// Arguments: {"source": String, "destination": String, "sync": bool?}
+// Returns the method used: "rename", "reflink" or "copy". Unless sync is
+// false, the file and its name are on disk when this responds.
+static void handle_place_file(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* source = nullptr;
+  FlValue* destination = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    source = fl_value_lookup_string(args, "source");
+    destination = fl_value_lookup_string(args, "destination");
+  }
+  if (source == nullptr || fl_value_get_type(source) != FL_VALUE_TYPE_STRING ||
+      destination == nullptr || fl_value_get_type(destination) != FL_VALUE_TYPE_STRING) {
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "source and destination are required", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  StorageWriteRequest request;
+  request.source = fl_value_get_string(source);
+  request.destination = fl_value_get_string(destination);
+  FlValue* sync = fl_value_lookup_string(args, "sync");
+  if (sync != nullptr && fl_value_get_type(sync) == FL_VALUE_TYPE_BOOL) {
+    request.sync = fl_value_get_bool(sync);
+  }
+  // Released in on_place_file_done.
+  request.context = g_object_ref(method_call);
+
+  // Placements that arrive together are batched; a copy across filesystems
+  // can take a while, so none of it runs on the main thread.
+  if (!self->storage_writer->Start() || self->storage_writer->Enqueue(request) == 0) {
+    g_object_unref(method_call);
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Storage writer failed to start", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+  }
+}
+
+static DedupIndexLinux* open_dedup_index(MyApplication* self) {
+  if (self->dedup_index == nullptr || !self->dedup_index->Open()) {
+    g_warning("Failed to open dedup index");
+    return nullptr;
+  }
+  return self->dedup_index;
+}
+
+// Arguments: {"name": String, "size": int?}
+// Returns whether an image of that name (and size, if given) was recorded.
+static void handle_has_image(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* name = nullptr;
+  FlValue* size = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    name = fl_value_lookup_string(args, "name");
+    size = fl_value_lookup_string(args, "size");
+  }
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DedupIndexLinux* index = open_dedup_index(self);
+  if (name == nullptr || fl_value_get_type(name) != FL_VALUE_TYPE_STRING) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "name is required", nullptr));
+  } else if (index == nullptr) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Dedup index unavailable", nullptr));
+  } else {
+    int64_t expected_size = size != nullptr && fl_value_get_type(size) == FL_VALUE_TYPE_INT
+                                ? fl_value_get_int(size)
+                                : 0;
+    bool result = index->Contains(fl_value_get_string(name), expected_size);
+    g_autoptr(FlValue) fl_result = fl_value_new_bool(result);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+struct RecordImageTask {
+  FlMethodCall* method_call;
+  std::string name;
+  std::string path;
+  std::string shard;
+  bool hashed;
+  uint64_t hash;
+  int64_t size;
+};
+
+// Runs on the main thread once the file has been hashed; the index itself is
+// only ever touched here.
+static void on_record_image_hashed(GObject* source_object, GAsyncResult* result,
+                                   gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(source_object);
+  RecordImageTask* data = static_cast<RecordImageTask*>(g_task_get_task_data(G_TASK(result)));
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DedupIndexLinux* index = open_dedup_index(self);
+  std::string duplicate_of;
+  std::string duplicate_shard;
+  if (!data->hashed) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("READ_FAILED", "Cannot read image", nullptr));
+  } else if (index == nullptr ||
+             !index->Record(data->name, data->shard, data->size, data->hash, &duplicate_of,
+                            &duplicate_shard)) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Dedup index unavailable", nullptr));
+  } else {
+    g_autoptr(FlValue) fl_result = fl_value_new_map();
+    fl_value_set_string_take(fl_result, "hash",
+                             fl_value_new_string(FormatContentHash(data->hash).c_str()));
+    fl_value_set_string_take(fl_result, "size", fl_value_new_int(data->size));
+    fl_value_set_string_take(fl_result, "duplicateOf",
+                             duplicate_of.empty() ? fl_value_new_null()
+                                                  : fl_value_new_string(duplicate_of.c_str()));
+    fl_value_set_string_take(fl_result, "duplicateShard",
+                             duplicate_of.empty() ? fl_value_new_null()
+                                                  : fl_value_new_string(duplicate_shard.c_str()));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(data->method_call, response, nullptr);
+}
+
+// Arguments: {"name": String, "path": String, "hash": String?, "shard": String?}
+// Returns {"hash": String, "size": int, "duplicateOf": String?,
+// "duplicateShard": String?}. Passing the hash from the download result
+// skips reading the file again; "shard" is the directory under the image
+// folder the file was saved in.
+static void handle_record_image(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* name = nullptr;
+  FlValue* path = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    name = fl_value_lookup_string(args, "name");
+    path = fl_value_lookup_string(args, "path");
+  }
+  if (name == nullptr || fl_value_get_type(name) != FL_VALUE_TYPE_STRING ||
+      path == nullptr || fl_value_get_type(path) != FL_VALUE_TYPE_STRING) {
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "name and path are required", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  RecordImageTask* data = new RecordImageTask();
+  data->method_call = FL_METHOD_CALL(g_object_ref(method_call));
+  data->name = fl_value_get_string(name);
+  data->path = fl_value_get_string(path);
+  FlValue* shard = fl_value_lookup_string(args, "shard");
+  if (shard != nullptr && fl_value_get_type(shard) == FL_VALUE_TYPE_STRING) {
+    data->shard = fl_value_get_string(shard);
+  }
+  FlValue* hash = fl_value_lookup_string(args, "hash");
+  data->hashed = hash != nullptr && fl_value_get_type(hash) == FL_VALUE_TYPE_STRING &&
+                 ParseContentHash(fl_value_get_string(hash), &data->hash);
+
+  // The task holds a reference to the application until it completes.
+  GTask* task = g_task_new(self, nullptr, on_record_image_hashed, nullptr);
+  g_task_set_task_data(task, data, [](gpointer p) {
+    RecordImageTask* data = static_cast<RecordImageTask*>(p);
+    g_object_unref(data->method_call);
+    delete data;
+  });
+  g_task_run_in_thread(task, [](GTask* task, gpointer source_object, gpointer task_data,
+                                GCancellable* cancellable) {
+    RecordImageTask* data = static_cast<RecordImageTask*>(task_data);
+    if (data->hashed) {
+      struct stat info;
+      data->hashed = stat(data->path.c_str(), &info) == 0;
+      data->size = data->hashed ? info.st_size : 0;
+    } else {
+      data->hashed = HashFile(data->path, &data->hash, &data->size);
+    }
+    g_task_return_boolean(task, TRUE);
   });
-  
-  // Send initial state
-  send_network_update(self);
+  g_object_unref(task);
 }
 
-static void stop_network_monitoring(MyApplication* self) {
-  if (self->is_monitoring && self->is_monitoring->load()) {
-    self->is_monitoring->store(false);
-    if (self->monitoring_thread && self->monitoring_thread->joinable()) {
-      self->monitoring_thread->join();
-      delete self->monitoring_thread;
-      self->monitoring_thread = nullptr;
+// Arguments: {"name": String}
+// Returns the shard the image was recorded in ("" for the image folder
+// itself), or null if it was never recorded.
+static void handle_locate_image(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* name = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    name = fl_value_lookup_string(args, "name");
+  }
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DedupIndexLinux* index = open_dedup_index(self);
+  std::string shard;
+  if (name == nullptr || fl_value_get_type(name) != FL_VALUE_TYPE_STRING) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "name is required", nullptr));
+  } else if (index == nullptr) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Dedup index unavailable", nullptr));
+  } else {
+    g_autoptr(FlValue) fl_result = index->Locate(fl_value_get_string(name), &shard)
+                                       ? fl_value_new_string(shard.c_str())
+                                       : fl_value_new_null();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+// Arguments: {"shards": Map<String, String>}, image name to its new shard
+// Returns how many recorded images were updated; names never recorded are
+// skipped.
+static void handle_move_images(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* shards = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    shards = fl_value_lookup_string(args, "shards");
+  }
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DedupIndexLinux* index = open_dedup_index(self);
+  if (shards == nullptr || fl_value_get_type(shards) != FL_VALUE_TYPE_MAP) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "shards is required", nullptr));
+  } else if (index == nullptr) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Dedup index unavailable", nullptr));
+  } else {
+    int64_t moved = 0;
+    for (size_t i = 0; i < fl_value_get_length(shards); ++i) {
+      FlValue* name = fl_value_get_map_key(shards, i);
+      FlValue* shard = fl_value_get_map_value(shards, i);
+      if (fl_value_get_type(name) == FL_VALUE_TYPE_STRING &&
+          fl_value_get_type(shard) == FL_VALUE_TYPE_STRING &&
+          index->Move(fl_value_get_string(name), fl_value_get_string(shard))) {
+        ++moved;
+      }
     }
+    g_autoptr(FlValue) fl_result = fl_value_new_int(moved);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
   }
+
+  fl_method_call_respond(method_call, response, nullptr);
 }
 
-static void send_network_update(MyApplication* self) {
-  if (self->event_channel) {
-    g_autoptr(FlValue) network_data = fl_value_new_map();
-    
-    fl_value_set_string_take(network_data, "isConnected", 
-        fl_value_new_bool(NetworkServiceLinux::IsConnected()));
-    fl_value_set_string_take(network_data, "isWifiOrEthernet", 
-        fl_value_new_bool(NetworkServiceLinux::IsConnectedToWifiOrEthernet()));
-    fl_value_set_string_take(network_data, "networkType", 
-        fl_value_new_string(NetworkServiceLinux::GetNetworkType().c_str()));
-    fl_value_set_string_take(network_data, "timestamp", 
-        fl_value_new_int(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count())));
-    
-    fl_event_channel_send(self->event_channel, network_data, nullptr, nullptr, nullptr);
+// Arguments: {"path": String}
+// Starts following the image folder; its files arrive as events on
+// "storage_service/folder". Asking again for the same folder lists it anew,
+// e.g. after it was re-created.
+static void handle_watch_folder(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* path = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    path = fl_value_lookup_string(args, "path");
+  }
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  if (path == nullptr || fl_value_get_type(path) != FL_VALUE_TYPE_STRING) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "path is required", nullptr));
+  } else {
+    std::string root = fl_value_get_string(path);
+    bool started;
+    if (self->folder_watcher->IsRunning() && self->folder_watcher->root() == root) {
+      self->folder_watcher->Rescan();
+      started = true;
+    } else {
+      started = self->folder_watcher->Start(root);
+    }
+    g_autoptr(FlValue) fl_result = fl_value_new_bool(started);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+// Sends {"reset": bool, "live": bool, "changes": [[name, shard, present]]}.
+static void on_folder_update(const FolderUpdate& update, gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  if (self->folder_channel == nullptr) {
+    return;
+  }
+
+  FlValue* changes = fl_value_new_list();
+  for (const FolderChange& change : update.changes) {
+    FlValue* entry = fl_value_new_list();
+    fl_value_append_take(entry, fl_value_new_string(change.name.c_str()));
+    fl_value_append_take(entry, fl_value_new_string(change.shard.c_str()));
+    fl_value_append_take(entry, fl_value_new_bool(change.present));
+    fl_value_append_take(changes, entry);
+  }
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "reset", fl_value_new_bool(update.reset));
+  fl_value_set_string_take(event, "live", fl_value_new_bool(update.live));
+  fl_value_set_string_take(event, "changes", changes);
+  fl_event_channel_send(self->folder_channel, event, nullptr, nullptr);
+}
+
+static DownloadHistoryLinux* open_download_history(MyApplication* self) {
+  if (self->download_history == nullptr || !self->download_history->Open()) {
+    g_warning("Failed to open download history");
+    return nullptr;
   }
+  return self->download_history;
+}
+
+static int64_t lookup_int(FlValue* args, const char* key, int64_t fallback) {
+  FlValue* value = fl_value_lookup_string(args, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT ? fl_value_get_int(value)
+                                                                            : fallback;
+}
+
+// Arguments: {"filename": String, "size": int, "bytes": int, "hash": String?,
+// "startedAt": int, "finishedAt": int, "durationMs": int, "linkType": String?}
+// Times are ms since the epoch. "linkType" defaults to the current network
+// type. Returns once the record is in the journal; it reaches the disk with
+// the next group commit.
+static void handle_history_record(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  FlValue* filename = nullptr;
+  if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    filename = fl_value_lookup_string(args, "filename");
+  }
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DownloadHistoryLinux* history = open_download_history(self);
+  if (filename == nullptr || fl_value_get_type(filename) != FL_VALUE_TYPE_STRING) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "filename is required", nullptr));
+  } else if (history == nullptr) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Download history unavailable", nullptr));
+  } else {
+    DownloadHistoryRecord record;
+    record.filename = fl_value_get_string(filename);
+    record.size = lookup_int(args, "size", 0);
+    record.bytes = lookup_int(args, "bytes", record.size);
+    record.finished_ms = lookup_int(args, "finishedAt", g_get_real_time() / 1000);
+    record.started_ms = lookup_int(args, "startedAt", record.finished_ms);
+    record.duration_ms = lookup_int(args, "durationMs", record.finished_ms - record.started_ms);
+    FlValue* hash = fl_value_lookup_string(args, "hash");
+    if (hash != nullptr && fl_value_get_type(hash) == FL_VALUE_TYPE_STRING) {
+      ParseContentHash(fl_value_get_string(hash), &record.content_hash);
+    }
+    FlValue* link_type = fl_value_lookup_string(args, "linkType");
+    record.link_type = link_type != nullptr && fl_value_get_type(link_type) == FL_VALUE_TYPE_STRING
+                           ? fl_value_get_string(link_type)
+                           : self->last_snapshot->network_type;
+
+    g_autoptr(FlValue) fl_result = fl_value_new_bool(history->Append(record));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+// "last" {"count": int} or "since" {"since": int, "limit": int?}
+// Returns the matching records newest first, each as {"filename", "size",
+// "bytes", "hash" (null if unknown), "startedAt", "finishedAt",
+// "durationMs", "linkType"}.
+static void handle_history_query(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  bool since = strcmp(fl_method_call_get_name(method_call), "since") == 0;
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DownloadHistoryLinux* history = open_download_history(self);
+  if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("INVALID_ARGUMENT", "arguments are required", nullptr));
+  } else if (history == nullptr) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Download history unavailable", nullptr));
+  } else {
+    std::vector<DownloadHistoryRecord> records =
+        since ? history->Since(lookup_int(args, "since", 0),
+                               static_cast<size_t>(std::max<int64_t>(lookup_int(args, "limit", 1000), 0)))
+              : history->Last(static_cast<size_t>(std::max<int64_t>(lookup_int(args, "count", 1), 0)));
+
+    g_autoptr(FlValue) fl_result = fl_value_new_list();
+    for (const DownloadHistoryRecord& record : records) {
+      FlValue* entry = fl_value_new_map();
+      fl_value_set_string_take(entry, "filename", fl_value_new_string(record.filename.c_str()));
+      fl_value_set_string_take(entry, "size", fl_value_new_int(record.size));
+      fl_value_set_string_take(entry, "bytes", fl_value_new_int(record.bytes));
+      fl_value_set_string_take(entry, "hash",
+                               record.content_hash != 0
+                                   ? fl_value_new_string(FormatContentHash(record.content_hash).c_str())
+                                   : fl_value_new_null());
+      fl_value_set_string_take(entry, "startedAt", fl_value_new_int(record.started_ms));
+      fl_value_set_string_take(entry, "finishedAt", fl_value_new_int(record.finished_ms));
+      fl_value_set_string_take(entry, "durationMs", fl_value_new_int(record.duration_ms));
+      fl_value_set_string_take(entry, "linkType", fl_value_new_string(record.link_type.c_str()));
+      fl_value_append_take(fl_result, entry);
+    }
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+// Arguments: {"since": int?}, all records when omitted
+// Returns {"count", "size", "bytes", "durationMs", "firstAt", "lastAt"};
+// the times are 0 when there are no records.
+static void handle_history_stats(MyApplication* self, FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  int64_t since = fl_value_get_type(args) == FL_VALUE_TYPE_MAP ? lookup_int(args, "since", 0) : 0;
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  DownloadHistoryLinux* history = open_download_history(self);
+  if (history == nullptr) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_error_response_new("UNAVAILABLE", "Download history unavailable", nullptr));
+  } else {
+    DownloadHistoryStats stats = history->Stats(since);
+    g_autoptr(FlValue) fl_result = fl_value_new_map();
+    fl_value_set_string_take(fl_result, "count", fl_value_new_int(stats.count));
+    fl_value_set_string_take(fl_result, "size", fl_value_new_int(stats.size));
+    fl_value_set_string_take(fl_result, "bytes", fl_value_new_int(stats.bytes));
+    fl_value_set_string_take(fl_result, "durationMs", fl_value_new_int(stats.duration_ms));
+    fl_value_set_string_take(fl_result, "firstAt", fl_value_new_int(stats.first_ms));
+    fl_value_set_string_take(fl_result, "lastAt", fl_value_new_int(stats.last_ms));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_result));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
 }
@@ -0,0 +1,85 @@
+#include "netlink_monitor_linux.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <unistd.h>
+
+NetlinkMonitorLinux::NetlinkMonitorLinux() : fd_(-1) {}
+
+NetlinkMonitorLinux::~NetlinkMonitorLinux() {
+    Close();
+}
+
+bool NetlinkMonitorLinux::Open() {
+    if (fd_ >= 0) {
+        return true;
+    }
+
+    int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (sock == -1) {
+        return false;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(sock);
+        return false;
+    }
+
+    fd_ = sock;
+    return true;
+}
+
+void NetlinkMonitorLinux::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool NetlinkMonitorLinux::DrainEvents() {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    bool changed = false;
+    alignas(struct nlmsghdr) char buffer[8192];
+
+    while (true) {
+        ssize_t len = recv(fd_, buffer, sizeof(buffer), 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            // The kernel dropped messages because we fell behind; the only
+            // safe thing to do is to re-read the full state.
+            if (errno == ENOBUFS) {
+                changed = true;
+                continue;
+            }
+            break;  // EAGAIN: queue is empty
+        }
+        if (len == 0) break;
+
+        int remaining = static_cast<int>(len);
+        for (struct nlmsghdr* nh = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(nh, remaining); nh = NLMSG_NEXT(nh, remaining)) {
+            switch (nh->nlmsg_type) {
+                case RTM_NEWLINK:
+                case RTM_DELLINK:
+                case RTM_NEWADDR:
+                case RTM_DELADDR:
+                    changed = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return changed;
+}
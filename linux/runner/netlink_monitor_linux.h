@@ -0,0 +1,29 @@
+#ifndef NETLINK_MONITOR_LINUX_H_
+#define NETLINK_MONITOR_LINUX_H_
+
+// Subscribes to RTNETLINK link and address notifications so the network
+// state is re-evaluated only when the kernel reports a change.
+class NetlinkMonitorLinux {
+public:
+    NetlinkMonitorLinux();
+    ~NetlinkMonitorLinux();
+
+    // Opens a non-blocking NETLINK_ROUTE socket bound to the link and
+    // IPv4/IPv6 address multicast groups. Returns false if the socket can't
+    // be created or bound, in which case callers should fall back to polling.
+    bool Open();
+    void Close();
+
+    int fd() const { return fd_; }
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Reads every queued message without blocking. Returns true if at least
+    // one of them was a link or address change (or the receive queue
+    // overflowed, meaning events were lost and state must be re-read).
+    bool DrainEvents();
+
+private:
+    int fd_;
+};
+
+#endif  // NETLINK_MONITOR_LINUX_H_
@@ -0,0 +1,33 @@
+#include "network_event_codec.h"
+#include "network_service_ffi.h"
+#include "network_status_page.h"
+#include <algorithm>
+
+namespace {
+
+void PutLittleEndian(uint8_t* out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+}  // namespace
+
+void EncodeNetworkEvent(const NetworkSnapshot& snapshot, uint8_t* out) {
+    out[0] = kNetworkEventVersion;
+    out[1] = static_cast<uint8_t>(NetworkServiceTypeFromString(snapshot.network_type));
+    PutLittleEndian(out + 2, NetworkServiceStatusFlags(snapshot), 2);
+    PutLittleEndian(out + 4, kNetworkEventSize, 4);
+    PutLittleEndian(out + 8, snapshot.generation, 8);
+    PutLittleEndian(out + 16, static_cast<uint64_t>(snapshot.timestamp_ms), 8);
+
+    const NetworkInterfaceInfo* primary = snapshot.PrimaryInterface();
+    LinkQuality quality = primary != nullptr ? primary->quality : LinkQuality();
+    int32_t signal = std::max(-128, std::min(127, quality.signal_dbm));
+    PutLittleEndian(out + 24, static_cast<uint32_t>(quality.speed_mbps), 4);
+    PutLittleEndian(out + 28, static_cast<uint32_t>(quality.tx_bitrate_kbps), 4);
+    PutLittleEndian(out + 32, static_cast<uint32_t>(quality.mtu), 4);
+    out[36] = static_cast<uint8_t>(static_cast<int8_t>(signal));
+    out[37] = static_cast<uint8_t>(quality.duplex);
+    PutLittleEndian(out + 38, 0, 2);
+}
@@ -0,0 +1,36 @@
+#ifndef NETWORK_EVENT_CODEC_H_
+#define NETWORK_EVENT_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "network_service_linux.h"
+
+// Compact binary payload sent on network_service/events instead of a
+// string-keyed map. Decoded by NetworkEvent.decode() in
+// lib/models/network_event.dart. All integers are little-endian.
+//
+//   offset size field
+//        0    1 version        kNetworkEventVersion
+//        1    1 network_type   NetworkServiceType (network_service_ffi.h)
+//        2    2 flags          NETWORK_SERVICE_STATUS_* bits
+//        4    4 length         total payload size in bytes
+//        8    8 generation     status page generation
+//       16    8 timestamp_ms   wall clock of the snapshot
+//   version 2 appends the primary link's quality (LinkQuality):
+//       24    4 speed_mbps     int32, -1 when unknown
+//       28    4 tx_bitrate     int32 kbit/s, -1 when unknown
+//       32    4 mtu            int32, -1 when unknown
+//       36    1 signal_dbm     int8, 0 when unknown
+//       37    1 duplex         NetworkServiceDuplex
+//       38    2 reserved       0
+//
+// New fields are only ever appended and announced through `length`, so an
+// older decoder keeps reading the prefix it knows.
+constexpr uint8_t kNetworkEventVersion = 2;
+constexpr size_t kNetworkEventSize = 40;
+
+// Encodes |snapshot| into |out|, which must hold kNetworkEventSize bytes.
+void EncodeNetworkEvent(const NetworkSnapshot& snapshot, uint8_t* out);
+
+#endif  // NETWORK_EVENT_CODEC_H_
@@ -0,0 +1,156 @@
+#include "network_monitor_linux.h"
+#include "network_status_page.h"
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+NetworkMonitorLinux::NetworkMonitorLinux(UpdateCallback callback, gpointer user_data)
+    : callback_(callback),
+      user_data_(user_data),
+      wake_fd_(-1),
+      running_(false),
+      pending_(nullptr) {}
+
+NetworkMonitorLinux::~NetworkMonitorLinux() {
+    Stop();
+}
+
+bool NetworkMonitorLinux::Start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        return false;
+    }
+
+    // Prefer kernel notifications: updates arrive within milliseconds of a
+    // link change and nothing wakes up while the link is stable. Fall back to
+    // polling when the netlink socket is unavailable (e.g. restricted
+    // sandboxes).
+    if (!netlink_.Open()) {
+        g_warning("Netlink monitor unavailable, polling network state instead");
+    }
+    // Optional: without it wireless links report unknown signal and rate.
+    wireless_.Open();
+
+    running_.store(true);
+    thread_ = std::thread(&NetworkMonitorLinux::Run, this);
+    return true;
+}
+
+void NetworkMonitorLinux::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) == -1) {
+        g_warning("Failed to wake network monitor thread");
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // The thread is gone, so nothing can publish any more. Drop a pending
+    // dispatch and whatever it would have delivered.
+    g_source_remove_by_user_data(this);
+    delete pending_.exchange(nullptr);
+
+    netlink_.Close();
+    wireless_.Close();
+    close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+void NetworkMonitorLinux::Run() {
+    bool first = true;
+    NetworkSnapshot last;
+
+    struct pollfd fds[2];
+    fds[0].fd = wake_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = netlink_.fd();
+    fds[1].events = POLLIN;
+    nfds_t nfds = netlink_.IsOpen() ? 2 : 1;
+    int timeout = netlink_.IsOpen() ? -1 : kPollingIntervalMs;
+
+    while (running_.load()) {
+        bool refresh = first;
+
+        if (!first) {
+            // Keep an eye on a wireless link's signal even when nothing else
+            // happens.
+            int wait = timeout;
+            const NetworkInterfaceInfo* primary = last.PrimaryInterface();
+            if (wireless_.IsOpen() && primary != nullptr && primary->type == "wifi" &&
+                (wait < 0 || wait > kWirelessProbeIntervalMs)) {
+                wait = kWirelessProbeIntervalMs;
+            }
+
+            int ready = poll(fds, nfds, wait);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                g_warning("Network monitor poll failed: %d", errno);
+                break;
+            }
+            if (fds[0].revents & POLLIN) {
+                break;  // Stop() was called
+            }
+            if (ready == 0) {
+                refresh = true;  // polling fallback or wireless probe tick
+            } else if (nfds > 1 && (fds[1].revents & POLLIN)) {
+                // A burst of kernel messages (link up, then address add) is
+                // drained in one go so it results in at most one state read.
+                refresh = netlink_.DrainEvents();
+            }
+        }
+
+        if (!refresh) continue;
+
+        // One enumeration per wakeup; the value compared is the value sent.
+        NetworkSnapshot current = NetworkServiceLinux::GetSnapshot();
+        ProbeLinkQuality(&current);
+        if (first || !current.SameStateAs(last)) {
+            first = false;
+            current.generation = PublishNetworkStatusPage(current);
+            last = current;
+            Publish(current);
+        }
+    }
+}
+
+void NetworkMonitorLinux::ProbeLinkQuality(NetworkSnapshot* snapshot) {
+    for (auto& interface : snapshot->interfaces) {
+        if (!interface.is_up) continue;
+        interface.quality = NetworkServiceLinux::ReadLinkQuality(interface.name);
+        if (interface.type == "wifi" && interface.index > 0) {
+            wireless_.Query(interface.index, &interface.quality.signal_dbm,
+                            &interface.quality.tx_bitrate_kbps);
+        }
+    }
+}
+
+void NetworkMonitorLinux::Publish(const NetworkSnapshot& snapshot) {
+    NetworkSnapshot* previous = pending_.exchange(new NetworkSnapshot(snapshot));
+    if (previous != nullptr) {
+        // The main context has not picked up the previous update yet; the
+        // dispatch already scheduled for it will deliver this one instead.
+        delete previous;
+        return;
+    }
+    g_idle_add(DispatchPending, this);
+}
+
+gboolean NetworkMonitorLinux::DispatchPending(gpointer user_data) {
+    NetworkMonitorLinux* self = static_cast<NetworkMonitorLinux*>(user_data);
+    NetworkSnapshot* snapshot = self->pending_.exchange(nullptr);
+    if (snapshot != nullptr) {
+        self->callback_(*snapshot, self->user_data_);
+        delete snapshot;
+    }
+    return G_SOURCE_REMOVE;
+}
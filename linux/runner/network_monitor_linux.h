@@ -0,0 +1,69 @@
+#ifndef NETWORK_MONITOR_LINUX_H_
+#define NETWORK_MONITOR_LINUX_H_
+
+#include <atomic>
+#include <thread>
+
+#include <glib.h>
+
+#include "netlink_monitor_linux.h"
+#include "network_service_linux.h"
+#include "wireless_probe_linux.h"
+
+// Watches the network state on a background thread and hands snapshots to
+// the GLib main context.
+//
+// The thread sleeps in poll() on the netlink socket and an eventfd, so it only
+// wakes up for kernel link/address events or to stop. When netlink is not
+// available it re-reads the state once per second instead. Netlink says
+// nothing about Wi-Fi signal or rate, so while a wireless link is up the
+// thread also wakes every few seconds to re-probe link quality; only
+// significant changes are published.
+//
+// Handoff is a single-slot mailbox: the monitor thread is the only producer,
+// the main context the only consumer. Publishing replaces any undelivered
+// snapshot, so however many changes happen between two main-loop iterations
+// only the newest one reaches the callback. Each change is written to the
+// shared status page (network_status_page.h) before the handoff, so Dart can
+// read it directly and use the event only as a wake-up.
+class NetworkMonitorLinux {
+public:
+    // Invoked on the main context with each delivered snapshot.
+    typedef void (*UpdateCallback)(const NetworkSnapshot& snapshot, gpointer user_data);
+
+    NetworkMonitorLinux(UpdateCallback callback, gpointer user_data);
+    ~NetworkMonitorLinux();
+
+    // Starts the monitor thread. The initial state is always delivered.
+    bool Start();
+
+    // Wakes the monitor thread and joins it. Returns without waiting for a
+    // poll interval; undelivered snapshots are discarded.
+    void Stop();
+
+    bool IsRunning() const { return running_.load(); }
+
+private:
+    static constexpr int kPollingIntervalMs = 1000;
+    static constexpr int kWirelessProbeIntervalMs = 5000;
+
+    void Run();
+    // Fills in the quality of every up interface in |snapshot|.
+    void ProbeLinkQuality(NetworkSnapshot* snapshot);
+    void Publish(const NetworkSnapshot& snapshot);
+    static gboolean DispatchPending(gpointer user_data);
+
+    UpdateCallback callback_;
+    gpointer user_data_;
+
+    NetlinkMonitorLinux netlink_;
+    WirelessProbeLinux wireless_;
+    int wake_fd_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+
+    // Newest snapshot not yet delivered, owned by whichever side swaps it out.
+    std::atomic<NetworkSnapshot*> pending_;
+};
+
+#endif  // NETWORK_MONITOR_LINUX_H_
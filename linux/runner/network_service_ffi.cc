@@ -0,0 +1,148 @@
+#include "network_service_ffi.h"
+#include "network_service_linux.h"
+#include "network_status_page.h"
+#include <cstring>
+
+namespace {
+
+NetworkStatusPage g_status_page = {};
+
+// Seqlock field access. The page stays a plain C struct so Dart can map it;
+// the GCC atomic builtins give the fields atomic semantics in place.
+template <typename T>
+void StoreRelaxed(T* field, T value) {
+    __atomic_store_n(field, value, __ATOMIC_RELAXED);
+}
+
+template <typename T>
+T LoadRelaxed(const T* field) {
+    return __atomic_load_n(field, __ATOMIC_RELAXED);
+}
+
+}  // namespace
+
+int32_t NetworkServiceTypeFromString(const std::string& network_type) {
+    if (network_type == "wifi") return NETWORK_SERVICE_TYPE_WIFI;
+    if (network_type == "ethernet") return NETWORK_SERVICE_TYPE_ETHERNET;
+    if (network_type == "mobile") return NETWORK_SERVICE_TYPE_MOBILE;
+    return NETWORK_SERVICE_TYPE_NONE;
+}
+
+uint32_t NetworkServiceStatusFlags(const NetworkSnapshot& snapshot) {
+    uint32_t flags = 0;
+    if (snapshot.is_connected) flags |= NETWORK_SERVICE_STATUS_CONNECTED;
+    if (snapshot.IsWifiOrEthernet()) flags |= NETWORK_SERVICE_STATUS_WIFI_OR_ETHERNET;
+    return flags;
+}
+
+uint32_t network_service_get_status(void) {
+    NetworkSnapshot snapshot = NetworkServiceLinux::GetSnapshot();
+    return static_cast<uint32_t>(NetworkServiceTypeFromString(snapshot.network_type)) |
+           NetworkServiceStatusFlags(snapshot);
+}
+
+int32_t network_service_get_network_type(void) {
+    return NetworkServiceTypeFromString(NetworkServiceLinux::GetSnapshot().network_type);
+}
+
+int32_t network_service_is_connected(void) {
+    return NetworkServiceLinux::GetSnapshot().is_connected ? 1 : 0;
+}
+
+int32_t network_service_is_connected_to_wifi_or_ethernet(void) {
+    return NetworkServiceLinux::GetSnapshot().IsWifiOrEthernet() ? 1 : 0;
+}
+
+const NetworkStatusPage* network_service_status_page(void) {
+    return &g_status_page;
+}
+
+const NetworkStatusPage* network_service_read_status_page(void) {
+    static thread_local NetworkStatusPage copy;
+
+    while (true) {
+        uint32_t begin = __atomic_load_n(&g_status_page.sequence, __ATOMIC_ACQUIRE);
+        if (begin & 1u) continue;  // writer in progress
+
+        copy.version = LoadRelaxed(&g_status_page.version);
+        copy.network_type = LoadRelaxed(&g_status_page.network_type);
+        copy.flags = LoadRelaxed(&g_status_page.flags);
+        copy.generation = LoadRelaxed(&g_status_page.generation);
+        copy.timestamp_ms = LoadRelaxed(&g_status_page.timestamp_ms);
+        copy.link_count = LoadRelaxed(&g_status_page.link_count);
+        for (uint32_t i = 0; i < NETWORK_STATUS_PAGE_MAX_LINKS; ++i) {
+            const NetworkStatusLink& link = g_status_page.links[i];
+            for (int c = 0; c < NETWORK_STATUS_LINK_NAME_SIZE; ++c) {
+                copy.links[i].name[c] = LoadRelaxed(&link.name[c]);
+            }
+            copy.links[i].type = LoadRelaxed(&link.type);
+            copy.links[i].speed_mbps = LoadRelaxed(&link.speed_mbps);
+            copy.links[i].duplex = LoadRelaxed(&link.duplex);
+            copy.links[i].mtu = LoadRelaxed(&link.mtu);
+            copy.links[i].signal_dbm = LoadRelaxed(&link.signal_dbm);
+            copy.links[i].tx_bitrate_kbps = LoadRelaxed(&link.tx_bitrate_kbps);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (LoadRelaxed(&g_status_page.sequence) == begin) {
+            copy.sequence = begin;
+            return &copy;
+        }
+    }
+}
+
+uint64_t PublishNetworkStatusPage(const NetworkSnapshot& snapshot) {
+    // Link quality was probed by the monitor before the snapshot got here, so
+    // the write section below is plain stores.
+    // The primary link goes first, so it is never cut off and readers don't
+    // have to guess which link of its type it is.
+    const NetworkInterfaceInfo* ordered[NETWORK_STATUS_PAGE_MAX_LINKS] = {};
+    uint32_t link_count = 0;
+    const NetworkInterfaceInfo* primary = snapshot.PrimaryInterface();
+    if (primary != nullptr) {
+        ordered[link_count++] = primary;
+    }
+    for (const NetworkInterfaceInfo& info : snapshot.interfaces) {
+        if (link_count == NETWORK_STATUS_PAGE_MAX_LINKS) break;
+        if (&info != primary) ordered[link_count++] = &info;
+    }
+
+    NetworkStatusLink links[NETWORK_STATUS_PAGE_MAX_LINKS] = {};
+    for (uint32_t i = 0; i < link_count; ++i) {
+        const NetworkInterfaceInfo& info = *ordered[i];
+        strncpy(links[i].name, info.name.c_str(), NETWORK_STATUS_LINK_NAME_SIZE - 1);
+        links[i].type = NetworkServiceTypeFromString(info.type);
+        links[i].speed_mbps = info.quality.speed_mbps;
+        links[i].duplex = info.quality.duplex;
+        links[i].mtu = info.quality.mtu;
+        links[i].signal_dbm = info.quality.signal_dbm;
+        links[i].tx_bitrate_kbps = info.quality.tx_bitrate_kbps;
+    }
+
+    uint32_t sequence = LoadRelaxed(&g_status_page.sequence);
+    StoreRelaxed(&g_status_page.sequence, sequence + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    StoreRelaxed(&g_status_page.version, static_cast<uint32_t>(NETWORK_STATUS_PAGE_VERSION));
+    StoreRelaxed(&g_status_page.network_type, NetworkServiceTypeFromString(snapshot.network_type));
+    StoreRelaxed(&g_status_page.flags, NetworkServiceStatusFlags(snapshot));
+    uint64_t generation = LoadRelaxed(&g_status_page.generation) + 1;
+    StoreRelaxed(&g_status_page.generation, generation);
+    StoreRelaxed(&g_status_page.timestamp_ms, snapshot.timestamp_ms);
+    StoreRelaxed(&g_status_page.link_count, link_count);
+    for (uint32_t i = 0; i < NETWORK_STATUS_PAGE_MAX_LINKS; ++i) {
+        NetworkStatusLink& link = g_status_page.links[i];
+        for (int c = 0; c < NETWORK_STATUS_LINK_NAME_SIZE; ++c) {
+            StoreRelaxed(&link.name[c], links[i].name[c]);
+        }
+        StoreRelaxed(&link.type, links[i].type);
+        StoreRelaxed(&link.speed_mbps, links[i].speed_mbps);
+        StoreRelaxed(&link.duplex, links[i].duplex);
+        StoreRelaxed(&link.mtu, links[i].mtu);
+        StoreRelaxed(&link.signal_dbm, links[i].signal_dbm);
+        StoreRelaxed(&link.tx_bitrate_kbps, links[i].tx_bitrate_kbps);
+    }
+
+    __atomic_store_n(&g_status_page.sequence, sequence + 2, __ATOMIC_RELEASE);
+    return generation;
+}
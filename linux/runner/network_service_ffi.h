@@ -0,0 +1,86 @@
+#ifndef NETWORK_SERVICE_FFI_H_
+#define NETWORK_SERVICE_FFI_H_
+
+#include <stdint.h>
+
+// C ABI of libnetwork_service.so, bound from Dart with dart:ffi
+// (lib/services/network_service.dart). Every call takes one snapshot of the
+// interface list; nothing allocates on the Dart side.
+
+#define NETWORK_SERVICE_EXPORT extern "C" __attribute__((visibility("default")))
+
+// Values of the network type, mirrored by NetworkType in Dart.
+enum NetworkServiceType {
+    NETWORK_SERVICE_TYPE_NONE = 0,
+    NETWORK_SERVICE_TYPE_WIFI = 1,
+    NETWORK_SERVICE_TYPE_ETHERNET = 2,
+    NETWORK_SERVICE_TYPE_MOBILE = 3,
+};
+
+// Values of LinkQuality::duplex / NetworkStatusLink.duplex.
+enum NetworkServiceDuplex {
+    NETWORK_SERVICE_DUPLEX_UNKNOWN = 0,
+    NETWORK_SERVICE_DUPLEX_HALF = 1,
+    NETWORK_SERVICE_DUPLEX_FULL = 2,
+};
+
+// Bits of the value returned by network_service_get_status(), above the
+// network type in the low byte.
+#define NETWORK_SERVICE_STATUS_TYPE_MASK 0xFFu
+#define NETWORK_SERVICE_STATUS_CONNECTED (1u << 8)
+#define NETWORK_SERVICE_STATUS_WIFI_OR_ETHERNET (1u << 9)
+
+// Connected flag, Wi-Fi/Ethernet flag and network type from one enumeration.
+NETWORK_SERVICE_EXPORT uint32_t network_service_get_status(void);
+
+NETWORK_SERVICE_EXPORT int32_t network_service_get_network_type(void);
+NETWORK_SERVICE_EXPORT int32_t network_service_is_connected(void);
+NETWORK_SERVICE_EXPORT int32_t network_service_is_connected_to_wifi_or_ethernet(void);
+
+// ---- Shared status page ----
+//
+// The native monitor publishes every state change into one fixed-layout page
+// guarded by a sequence counter (seqlock): the counter is odd while the
+// monitor thread is writing and is bumped to the next even value once the
+// write is complete. Dart maps the layout with dart:ffi structs, compares
+// `generation` as often as it likes (e.g. once per frame) and only takes a
+// consistent copy when it has changed. No messages and no allocations.
+
+#define NETWORK_STATUS_PAGE_VERSION 3
+#define NETWORK_STATUS_PAGE_MAX_LINKS 8
+#define NETWORK_STATUS_LINK_NAME_SIZE 16  // IFNAMSIZ
+
+typedef struct {
+    char name[NETWORK_STATUS_LINK_NAME_SIZE];  // NUL-terminated
+    int32_t type;                              // NetworkServiceType
+    int32_t speed_mbps;                        // -1 when unknown
+    int32_t duplex;                            // NetworkServiceDuplex
+    int32_t mtu;                               // -1 when unknown
+    int32_t signal_dbm;                        // wireless only, 0 when unknown
+    int32_t tx_bitrate_kbps;                   // wireless only, -1 when unknown
+} NetworkStatusLink;
+
+typedef struct {
+    uint32_t sequence;      // odd while a write is in progress
+    uint32_t version;       // NETWORK_STATUS_PAGE_VERSION
+    int32_t network_type;   // NetworkServiceType of the primary link
+    uint32_t flags;         // NETWORK_SERVICE_STATUS_* bits
+    uint64_t generation;    // incremented on every published change, 0 = never
+    int64_t timestamp_ms;   // wall clock of the snapshot, ms since epoch
+    uint32_t link_count;
+    uint32_t reserved;
+    // The primary link (the one network_type comes from) first whenever
+    // network_type isn't NONE, then the others in enumeration order, up or
+    // down, as many as fit.
+    NetworkStatusLink links[NETWORK_STATUS_PAGE_MAX_LINKS];
+} NetworkStatusPage;
+
+// The live page. Fields may be mid-update; only `generation` is safe to read
+// directly (a stale value just means the change is seen a frame later).
+NETWORK_SERVICE_EXPORT const NetworkStatusPage* network_service_status_page(void);
+
+// Takes a consistent copy of the live page into a per-thread buffer and
+// returns it. The copy stays valid until the next call on the same thread.
+NETWORK_SERVICE_EXPORT const NetworkStatusPage* network_service_read_status_page(void);
+
+#endif  // NETWORK_SERVICE_FFI_H_
@@ -1,126 +1,367 @@
 #include "network_service_linux.h"
+#include "network_service_ffi.h"
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <sys/socket.h>
 #include <ifaddrs.h>
+#include <net/if.h>
+#include <net/if_arp.h>
 #include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <unistd.h>
+#include <cstdlib>
+#include <cstring>
 
-bool NetworkServiceLinux::IsConnectedToWifiOrEthernet() {
-    std::string networkType = GetNetworkType();
-    return networkType == "wifi" || networkType == "ethernet";
+namespace {
+
+// Classification of an interface, filled once per ifindex. Link type and
+// whether the device is virtual never change for the lifetime of an index,
+// so only operstate has to be looked at on each enumeration.
+struct CachedInterface {
+    std::string name;
+    std::string type;
+    bool is_virtual = false;
+    // A virtual point-to-point link other than PPP: a VPN tunnel. It counts
+    // as a way out, but carries other links' traffic, so it isn't listed.
+    bool is_tunnel = false;
+};
+
+std::mutex g_interface_cache_mutex;
+std::unordered_map<int, CachedInterface> g_interface_cache;
+
+std::string& SysfsRootStorage() {
+    static std::string root = [] {
+        const char* env = getenv("IMAGEDUMPER_SYSFS_ROOT");
+        return std::string(env != nullptr && env[0] != '\0' ? env : "/sys");
+    }();
+    return root;
 }
 
-std::string NetworkServiceLinux::GetNetworkType() {
-    if (!IsConnected()) {
-        return "none";
+std::string SysfsNetPath(const std::string& interface_name) {
+    return SysfsRootStorage() + "/class/net/" + interface_name;
+}
+
+// Devices under /sys/devices/virtual/net (bridges, veth, tap, docker0,
+// virbr0, ...) never carry the host's uplink themselves. PPP sessions and
+// tunnels live there too; BuildSnapshot() sorts those out.
+bool IsVirtualInterface(const std::string& interface_name) {
+    std::error_code ec;
+    std::filesystem::path target = std::filesystem::read_symlink(
+        SysfsNetPath(interface_name), ec);
+    if (ec) {
+        return false;
     }
+    return target.string().find("/devices/virtual/") != std::string::npos;
+}
 
-    std::vector<std::string> active_interfaces;
-    
+int ReadSysfsInt(const std::string& path, int fallback) {
+    std::ifstream file(path);
+    int value;
+    return (file >> value) ? value : fallback;
+}
+
+}  // namespace
+
+bool LinkQuality::SignificantlyDifferentFrom(const LinkQuality& other) const {
+    if (speed_mbps != other.speed_mbps || duplex != other.duplex || mtu != other.mtu) {
+        return true;
+    }
+    if ((signal_dbm == 0) != (other.signal_dbm == 0) ||
+        std::abs(signal_dbm - other.signal_dbm) >= 5) {
+        return true;
+    }
+    if ((tx_bitrate_kbps < 0) != (other.tx_bitrate_kbps < 0)) {
+        return true;
+    }
+    // A rate step of a quarter or more, e.g. an MCS change.
+    int64_t delta = std::abs(static_cast<int64_t>(tx_bitrate_kbps) - other.tx_bitrate_kbps);
+    return delta * 4 >= std::max(tx_bitrate_kbps, other.tx_bitrate_kbps) && delta > 0;
+}
+
+const NetworkInterfaceInfo* NetworkSnapshot::PrimaryInterface() const {
+    for (const auto& interface : interfaces) {
+        if (interface.is_up && interface.type == network_type) {
+            return &interface;
+        }
+    }
+    return nullptr;
+}
+
+bool NetworkSnapshot::SameStateAs(const NetworkSnapshot& other) const {
+    if (is_connected != other.is_connected || network_type != other.network_type) {
+        return false;
+    }
+    const NetworkInterfaceInfo* primary = PrimaryInterface();
+    const NetworkInterfaceInfo* other_primary = other.PrimaryInterface();
+    if (primary == nullptr || other_primary == nullptr) {
+        return primary == other_primary;
+    }
+    return primary->name == other_primary->name &&
+           !primary->quality.SignificantlyDifferentFrom(other_primary->quality);
+}
+
+NetworkSnapshot NetworkServiceLinux::GetSnapshot() {
     // Get all network interfaces
-    struct ifaddrs *ifaddr, *ifa;
+    struct ifaddrs* ifaddr;
     if (getifaddrs(&ifaddr) == -1) {
-        return "none";
+        NetworkSnapshot snapshot;
+        snapshot.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return snapshot;
+    }
+
+    NetworkSnapshot snapshot = BuildSnapshot(ifaddr);
+    freeifaddrs(ifaddr);
+    return snapshot;
+}
+
+NetworkSnapshot NetworkServiceLinux::BuildSnapshot(const struct ifaddrs* ifaddr) {
+    NetworkSnapshot snapshot;
+    snapshot.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const struct ifaddrs* ifa;
+
+    // getifaddrs reports one AF_PACKET entry per link, which carries the
+    // ifindex we key the classification cache on.
+    std::unordered_map<std::string, int> indexes;
+    std::unordered_set<int> present;
+    for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == nullptr || ifa->ifa_addr->sa_family != AF_PACKET) continue;
+        int index = reinterpret_cast<struct sockaddr_ll*>(ifa->ifa_addr)->sll_ifindex;
+        indexes[ifa->ifa_name] = index;
+        present.insert(index);
     }
 
+    std::lock_guard<std::mutex> lock(g_interface_cache_mutex);
+
+    // A link with several IPv4 addresses shows up once per address.
+    std::unordered_set<int> listed;
+
     // Check each interface
     for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
         if (ifa->ifa_addr == nullptr) continue;
         
         // Only check IPv4 interfaces
-        if (ifa->ifa_addr->sa_family == AF_INET) {
-            std::string interface_name = ifa->ifa_name;
-            
-            // Skip loopback
-            if (interface_name == "lo") continue;
+        if (ifa->ifa_addr->sa_family != AF_INET) continue;
+
+        // Skip loopback
+        if (ifa->ifa_flags & IFF_LOOPBACK) continue;
+        // Address labels ("eth0:1") belong to the link they are named after,
+        // which has no AF_PACKET entry or /sys directory of its own.
+        std::string interface_name = ifa->ifa_name;
+        interface_name = interface_name.substr(0, interface_name.find(':'));
+        if (interface_name == "lo") continue;
             
-            // Check if interface has a valid IP address
-            struct sockaddr_in* addr_in = (struct sockaddr_in*)ifa->ifa_addr;
-            if (addr_in->sin_addr.s_addr != 0) {
-                if (IsInterfaceUp(interface_name)) {
-                    active_interfaces.push_back(interface_name);
-                }
+        // Check if interface has a valid IP address
+        struct sockaddr_in* addr_in = (struct sockaddr_in*)ifa->ifa_addr;
+        if (addr_in->sin_addr.s_addr == 0) continue;
+
+        auto index_it = indexes.find(interface_name);
+        int index = index_it != indexes.end()
+            ? index_it->second
+            : static_cast<int>(if_nametoindex(interface_name.c_str()));
+
+        auto cached = g_interface_cache.find(index);
+        // Indexes can be reused by a new device; re-classify on a name change.
+        if (cached == g_interface_cache.end() || cached->second.name != interface_name) {
+            CachedInterface entry;
+            entry.name = interface_name;
+            entry.is_virtual = IsVirtualInterface(interface_name);
+            if (entry.is_virtual &&
+                ReadSysfsInt(SysfsNetPath(interface_name) + "/type", -1) == ARPHRD_PPP) {
+                // A modem's PPP session is the uplink, virtual or not.
+                entry.is_virtual = false;
+            } else if (entry.is_virtual && (ifa->ifa_flags & IFF_POINTOPOINT)) {
+                entry.is_virtual = false;
+                entry.is_tunnel = true;
             }
+            if (!entry.is_virtual && !entry.is_tunnel) {
+                entry.type = GetInterfaceType(interface_name);
+            }
+            cached = g_interface_cache.insert_or_assign(index, std::move(entry)).first;
+            present.insert(index);
+        }
+
+        if (cached->second.is_virtual) continue;
+        // Bridges and container links don't reach anywhere by themselves.
+        snapshot.is_connected = true;
+        if (cached->second.is_tunnel || !listed.insert(index).second) continue;
+
+        NetworkInterfaceInfo info;
+        info.name = interface_name;
+        // IFF_RUNNING mirrors the kernel's operstate, so there is no need to
+        // read /sys/class/net/<if>/operstate on every enumeration.
+        info.is_up = (ifa->ifa_flags & IFF_UP) && (ifa->ifa_flags & IFF_RUNNING);
+        info.index = index;
+        info.type = cached->second.type;
+        snapshot.interfaces.push_back(info);
+    }
+
+    // Drop entries for interfaces that went away.
+    for (auto it = g_interface_cache.begin(); it != g_interface_cache.end();) {
+        if (present.count(it->first) == 0) {
+            it = g_interface_cache.erase(it);
+        } else {
+            ++it;
         }
     }
-    
-    freeifaddrs(ifaddr);
 
     // Determine the primary network type
-    std::string primary_type = "none";
-    
-    for (const auto& interface : active_interfaces) {
-        std::string type = GetInterfaceType(interface);
-        
+    for (const auto& interface : snapshot.interfaces) {
+        if (!interface.is_up) continue;
+
         // Priority: ethernet > wifi > mobile
-        if (type == "ethernet") {
-            primary_type = "ethernet";
+        if (interface.type == "ethernet") {
+            snapshot.network_type = "ethernet";
             break; // Ethernet has highest priority
-        } else if (type == "wifi" && primary_type != "ethernet") {
-            primary_type = "wifi";
-        } else if (type == "mobile" && primary_type == "none") {
-            primary_type = "mobile";
+        } else if (interface.type == "wifi") {
+            snapshot.network_type = "wifi";
+        } else if (interface.type == "mobile" && snapshot.network_type == "none") {
+            snapshot.network_type = "mobile";
         }
     }
     
-    return primary_type;
+    return snapshot;
+}
+
+const std::string& NetworkServiceLinux::SysfsRoot() {
+    return SysfsRootStorage();
+}
+
+void NetworkServiceLinux::SetSysfsRoot(const std::string& root) {
+    SysfsRootStorage() = root;
+}
+
+void NetworkServiceLinux::ClearInterfaceCache() {
+    std::lock_guard<std::mutex> lock(g_interface_cache_mutex);
+    g_interface_cache.clear();
+}
+
+bool NetworkServiceLinux::IsConnectedToWifiOrEthernet() {
+    return GetSnapshot().IsWifiOrEthernet();
+}
+
+std::string NetworkServiceLinux::GetNetworkType() {
+    return GetSnapshot().network_type;
 }
 
 bool NetworkServiceLinux::IsConnected() {
-    // Check if we can create a socket and there are active interfaces
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    return GetSnapshot().is_connected;
+}
+
+std::string NetworkServiceLinux::GetRouteInterface() {
+    int sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE);
     if (sock == -1) {
-        return false;
+        return std::string();
     }
-    close(sock);
-    
-    // Check if we have any non-loopback interfaces with valid IPs
-    struct ifaddrs *ifaddr, *ifa;
-    if (getifaddrs(&ifaddr) == -1) {
-        return false;
+
+    // RTM_GETROUTE resolves a destination the way a connect() would,
+    // including the rules VPNs such as wg-quick install. Nothing is sent;
+    // any public address takes the route Internet traffic does.
+    struct {
+        struct nlmsghdr header;
+        struct rtmsg route;
+        char attributes[RTA_SPACE(sizeof(struct in_addr))];
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    request.header.nlmsg_type = RTM_GETROUTE;
+    request.header.nlmsg_flags = NLM_F_REQUEST;
+    request.route.rtm_family = AF_INET;
+    request.route.rtm_dst_len = 32;
+    struct rtattr* destination = reinterpret_cast<struct rtattr*>(
+        reinterpret_cast<char*>(&request) + NLMSG_ALIGN(request.header.nlmsg_len));
+    destination->rta_type = RTA_DST;
+    destination->rta_len = RTA_LENGTH(sizeof(struct in_addr));
+    inet_pton(AF_INET, "1.1.1.1", RTA_DATA(destination));
+    request.header.nlmsg_len = NLMSG_ALIGN(request.header.nlmsg_len) + destination->rta_len;
+
+    std::string name;
+    alignas(struct nlmsghdr) char buffer[4096];
+    ssize_t len = -1;
+    if (send(sock, &request, request.header.nlmsg_len, 0) >= 0) {
+        len = recv(sock, buffer, sizeof(buffer), 0);
     }
-    
-    bool connected = false;
-    for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == nullptr) continue;
-        
-        if (ifa->ifa_addr->sa_family == AF_INET) {
-            std::string interface_name = ifa->ifa_name;
-            if (interface_name != "lo") { // Skip loopback
-                struct sockaddr_in* addr_in = (struct sockaddr_in*)ifa->ifa_addr;
-                if (addr_in->sin_addr.s_addr != 0) {
-                    connected = true;
-                    break;
-                }
+    close(sock);
+
+    int remaining = static_cast<int>(len);
+    for (struct nlmsghdr* nh = reinterpret_cast<struct nlmsghdr*>(buffer);
+         len > 0 && NLMSG_OK(nh, remaining); nh = NLMSG_NEXT(nh, remaining)) {
+        if (nh->nlmsg_type != RTM_NEWROUTE) {
+            break;  // NLMSG_ERROR: no route
+        }
+        struct rtmsg* route = static_cast<struct rtmsg*>(NLMSG_DATA(nh));
+        int attributes_len = static_cast<int>(RTM_PAYLOAD(nh));
+        for (struct rtattr* attribute = RTM_RTA(route); RTA_OK(attribute, attributes_len);
+             attribute = RTA_NEXT(attribute, attributes_len)) {
+            if (attribute->rta_type != RTA_OIF) continue;
+            char interface_name[IF_NAMESIZE];
+            if (if_indextoname(*static_cast<int*>(RTA_DATA(attribute)), interface_name)) {
+                name = interface_name;
             }
         }
+        break;
     }
-    
-    freeifaddrs(ifaddr);
-    return connected;
+    return name;
+}
+
+int NetworkServiceLinux::GetLinkSpeedMbps(const std::string& interface_name) {
+    std::ifstream speed_file(SysfsNetPath(interface_name) + "/speed");
+    int speed = -1;
+    if (!(speed_file >> speed) || speed <= 0) {
+        return -1;
+    }
+    return speed;
+}
+
+LinkQuality NetworkServiceLinux::ReadLinkQuality(const std::string& interface_name) {
+    LinkQuality quality;
+    std::string path = SysfsNetPath(interface_name);
+    quality.speed_mbps = GetLinkSpeedMbps(interface_name);
+    quality.mtu = ReadSysfsInt(path + "/mtu", -1);
+
+    std::ifstream duplex_file(path + "/duplex");
+    std::string duplex;
+    if (duplex_file >> duplex) {
+        if (duplex == "full") {
+            quality.duplex = NETWORK_SERVICE_DUPLEX_FULL;
+        } else if (duplex == "half") {
+            quality.duplex = NETWORK_SERVICE_DUPLEX_HALF;
+        }
+    }
+    return quality;
 }
 
 std::string NetworkServiceLinux::GetInterfaceType(const std::string& interface_name) {
     // Check interface type based on naming convention and /sys filesystem
     
     // Check wireless interfaces
-    std::string wireless_path = "/sys/class/net/" + interface_name + "/wireless";
+    std::string wireless_path = SysfsNetPath(interface_name) + "/wireless";
     if (std::filesystem::exists(wireless_path)) {
         return "wifi";
     }
     
     // Check interface type from /sys/class/net/<interface>/type
-    std::string type_path = "/sys/class/net/" + interface_name + "/type";
+    std::string type_path = SysfsNetPath(interface_name) + "/type";
     std::ifstream type_file(type_path);
     if (type_file.is_open()) {
         std::string type_str;
         std::getline(type_file, type_str);
         int type = std::stoi(type_str);
-        
+
+        if (type == ARPHRD_PPP) {
+            return "mobile";
+        }
+
         // Type 1 is typically Ethernet
         if (type == 1) {
             // Further classify based on interface name
@@ -159,16 +400,3 @@ std::string NetworkServiceLinux::GetInterfaceType(const std::string& interface_n
     
     return "ethernet"; // Default fallback
 }
-
-bool NetworkServiceLinux::IsInterfaceUp(const std::string& interface_name) {
-    std::string operstate_path = "/sys/class/net/" + interface_name + "/operstate";
-    std::ifstream operstate_file(operstate_path);
-    
-    if (operstate_file.is_open()) {
-        std::string state;
-        std::getline(operstate_file, state);
-        return state == "up";
-    }
-    
-    return false;
-} 
\ No newline at end of file
@@ -1,17 +1,92 @@
 #ifndef NETWORK_SERVICE_LINUX_H_
 #define NETWORK_SERVICE_LINUX_H_
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+struct ifaddrs;
+
+// What an interface can carry. Every field has an "unknown" value, because
+// most drivers only report some of them.
+struct LinkQuality {
+    int32_t speed_mbps = -1;       // negotiated speed; wired links only
+    int32_t duplex = 0;            // NetworkServiceDuplex (network_service_ffi.h)
+    int32_t mtu = -1;
+    int32_t signal_dbm = 0;        // wireless only; 0 when unknown
+    int32_t tx_bitrate_kbps = -1;  // wireless only; current transmit rate
+
+    // Whether |other| differs enough to be worth an update. Wi-Fi signal and
+    // rate wander constantly, so small moves don't count.
+    bool SignificantlyDifferentFrom(const LinkQuality& other) const;
+};
+
+struct NetworkInterfaceInfo {
+    std::string name;
+    std::string type;  // "wifi", "ethernet" or "mobile"
+    bool is_up = false;
+    int index = 0;
+    // Filled by the network monitor; BuildSnapshot() leaves it unknown.
+    LinkQuality quality;
+};
+
+// Network state captured from a single interface enumeration, so every field
+// describes the same instant.
+struct NetworkSnapshot {
+    bool is_connected = false;
+    std::string network_type = "none";
+    std::vector<NetworkInterfaceInfo> interfaces;
+    int64_t timestamp_ms = 0;  // wall clock when the snapshot was taken
+    uint64_t generation = 0;   // status page generation, set when published
+
+    bool IsWifiOrEthernet() const {
+        return network_type == "wifi" || network_type == "ethernet";
+    }
+
+    // The up interface network_type was taken from, or null when offline.
+    const NetworkInterfaceInfo* PrimaryInterface() const;
+
+    // Compares the fields reported to Dart.
+    bool SameStateAs(const NetworkSnapshot& other) const;
+};
 
 class NetworkServiceLinux {
 public:
+    static NetworkSnapshot GetSnapshot();
+
+    // Builds a snapshot from an interface list in getifaddrs() format.
+    // GetSnapshot() is this applied to the live list; benchmarks feed it
+    // synthetic ones.
+    static NetworkSnapshot BuildSnapshot(const struct ifaddrs* interfaces);
+
     static bool IsConnectedToWifiOrEthernet();
     static std::string GetNetworkType();
     static bool IsConnected();
 
+    // Negotiated speed from /sys/class/net/<if>/speed, or -1 when the driver
+    // does not report one (most wireless and virtual devices).
+    static int GetLinkSpeedMbps(const std::string& interface_name);
+
+    // Interface the kernel would send Internet traffic out of, after policy
+    // routing, or "" when there is no IPv4 route. Differs from every
+    // physical link while a VPN tunnel carries the default route.
+    static std::string GetRouteInterface();
+
+    // Speed, duplex and MTU from /sys/class/net/<if>. Wireless signal and
+    // bitrate come from nl80211 instead (wireless_probe_linux.h).
+    static LinkQuality ReadLinkQuality(const std::string& interface_name);
+
+    // Root of the sysfs tree interfaces are classified from, "/sys" unless
+    // overridden by IMAGEDUMPER_SYSFS_ROOT or SetSysfsRoot(). Lets benchmarks
+    // and tests run against a synthetic tree. Set it before monitoring starts.
+    static const std::string& SysfsRoot();
+    static void SetSysfsRoot(const std::string& root);
+
+    // Forgets every cached interface classification.
+    static void ClearInterfaceCache();
+
 private:
     static std::string GetInterfaceType(const std::string& interface_name);
-    static bool IsInterfaceUp(const std::string& interface_name);
 };
 
-#endif  // NETWORK_SERVICE_LINUX_H_ 
\ No newline at end of file
+#endif  // NETWORK_SERVICE_LINUX_H_ 
@@ -0,0 +1,20 @@
+#ifndef NETWORK_STATUS_PAGE_H_
+#define NETWORK_STATUS_PAGE_H_
+
+#include "network_service_linux.h"
+
+#include <cstdint>
+#include <string>
+
+// NetworkServiceType value (network_service_ffi.h) of a network type name.
+int32_t NetworkServiceTypeFromString(const std::string& network_type);
+
+// NETWORK_SERVICE_STATUS_* bits describing |snapshot|.
+uint32_t NetworkServiceStatusFlags(const NetworkSnapshot& snapshot);
+
+// Writes |snapshot| into the shared NetworkStatusPage (network_service_ffi.h)
+// and bumps its generation, which is returned. Must only be called from one
+// thread at a time; the network monitor thread is the single writer.
+uint64_t PublishNetworkStatusPage(const NetworkSnapshot& snapshot);
+
+#endif  // NETWORK_STATUS_PAGE_H_
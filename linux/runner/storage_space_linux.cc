@@ -0,0 +1,45 @@
+#include "storage_space_linux.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+int64_t StorageSpaceLinux::Available(const std::string& directory) {
+    struct statvfs info;
+    if (statvfs(directory.c_str(), &info) != 0) {
+        return -1;
+    }
+    // f_bavail, not f_bfree: blocks reserved for root are no use to us.
+    return static_cast<int64_t>(info.f_bavail) * static_cast<int64_t>(info.f_frsize);
+}
+
+bool StorageSpaceLinux::Admit(const std::string& directory, int64_t bytes, int64_t floor) {
+    int64_t available = Available(directory);
+    if (available < 0) {
+        return true;
+    }
+    return available - (bytes > 0 ? bytes : 0) >= floor;
+}
+
+bool StorageSpaceLinux::Preallocate(int fd, int64_t length) {
+    if (length <= 0) {
+        return true;
+    }
+    int result;
+    do {
+        result = fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, length);
+    } while (result != 0 && errno == EINTR);
+    return result == 0 || !IsOutOfSpace(errno);
+}
+
+void StorageSpaceLinux::Release(int fd, int64_t size, int64_t reserved) {
+    // Truncating to the current size drops blocks kept past the end; hole
+    // punching stops at the end of the file on most filesystems.
+    if (reserved > size && ftruncate(fd, size) != 0) {
+        return;  // the space comes back when the file is deleted
+    }
+}
+
+bool StorageSpaceLinux::IsOutOfSpace(int error) {
+    return error == ENOSPC || error == EDQUOT;
+}
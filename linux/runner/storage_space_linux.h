@@ -0,0 +1,35 @@
+#ifndef STORAGE_SPACE_LINUX_H_
+#define STORAGE_SPACE_LINUX_H_
+
+#include <cstdint>
+#include <string>
+
+// Free-space admission and preallocation for files about to be written, so
+// a full disk is found before the bandwidth is spent rather than half way
+// through a download.
+class StorageSpaceLinux {
+public:
+    // Bytes unprivileged writers can still use on the filesystem holding
+    // |directory|, or -1 if it can't be queried.
+    static int64_t Available(const std::string& directory);
+
+    // Whether |bytes| more can be written under |directory| with at least
+    // |floor| bytes left free afterwards. Filesystems that can't be queried
+    // are admitted; the write itself then has the final say.
+    static bool Admit(const std::string& directory, int64_t bytes, int64_t floor);
+
+    // Reserves the first |length| bytes of |fd| without changing its size,
+    // which also lets the filesystem lay the file out in few extents.
+    // Returns false only if the space isn't there (ENOSPC, EDQUOT);
+    // filesystems without fallocate() just skip the reservation.
+    static bool Preallocate(int fd, int64_t length);
+
+    // Returns reserved blocks past |size| (an object that turned out smaller
+    // than announced) to the filesystem.
+    static void Release(int fd, int64_t size, int64_t reserved);
+
+    // Whether |error| (an errno value) means the filesystem is out of space.
+    static bool IsOutOfSpace(int error);
+};
+
+#endif  // STORAGE_SPACE_LINUX_H_
@@ -0,0 +1,400 @@
+#include "storage_writer_linux.h"
+#include "io_uring_linux.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <unistd.h>
+
+namespace {
+
+// Requests per batch. Each takes at most three SQEs per stage, plus its
+// directory's, so a batch always fits the ring.
+constexpr size_t kBatchSize = 64;
+constexpr unsigned kRingEntries = 256;
+// Workers without io_uring. Placements are mostly waiting on the disk, so
+// a few of them keep an NVMe queue busy.
+constexpr int kPoolThreads = 4;
+
+enum Kind : uint64_t {
+    kOpenFile,
+    kOpenDirectory,
+    kSyncFile,
+    kRename,
+    kSyncDirectory,
+    kClose,
+};
+
+uint64_t Tag(Kind kind, size_t index) {
+    return (static_cast<uint64_t>(index) << 8) | kind;
+}
+
+void PrepOpen(io_uring_sqe* sqe, const std::string& path, int flags, uint64_t tag) {
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uint64_t>(path.c_str());
+    sqe->open_flags = flags | O_CLOEXEC;
+    sqe->user_data = tag;
+}
+
+void PrepFsync(io_uring_sqe* sqe, int fd, bool data_only, uint64_t tag) {
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = data_only ? IORING_FSYNC_DATASYNC : 0;
+    sqe->user_data = tag;
+}
+
+void PrepRename(io_uring_sqe* sqe, const std::string& from, const std::string& to, uint64_t tag) {
+    sqe->opcode = IORING_OP_RENAMEAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uint64_t>(from.c_str());
+    sqe->len = static_cast<uint32_t>(AT_FDCWD);
+    sqe->addr2 = reinterpret_cast<uint64_t>(to.c_str());
+    sqe->user_data = tag;
+}
+
+void PrepClose(io_uring_sqe* sqe, int fd, uint64_t tag) {
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = tag;
+}
+
+std::string ErrorMessage(const char* what, int error) {
+    return std::string(what) + ": " + strerror(error);
+}
+
+}  // namespace
+
+StorageWriterLinux::StorageWriterLinux(CompletionCallback callback, gpointer user_data)
+    : callback_(callback),
+      user_data_(user_data),
+      running_(false),
+      using_ring_(false),
+      stopping_(false),
+      next_id_(1),
+      dispatch_scheduled_(false) {}
+
+StorageWriterLinux::~StorageWriterLinux() {
+    Stop();
+}
+
+bool StorageWriterLinux::Start() {
+    if (running_.load()) {
+        return true;
+    }
+
+    ring_ = std::make_unique<IoUringLinux>();
+    if (!ring_->Init(kRingEntries) || !ring_->Supports(IORING_OP_OPENAT) ||
+        !ring_->Supports(IORING_OP_FSYNC) || !ring_->Supports(IORING_OP_RENAMEAT) ||
+        !ring_->Supports(IORING_OP_CLOSE)) {
+        g_message("io_uring unavailable, placing files on a thread pool");
+        ring_.reset();
+    }
+
+    stopping_ = false;
+    using_ring_.store(ring_ != nullptr);
+    running_.store(true);
+    if (ring_) {
+        threads_.emplace_back(&StorageWriterLinux::RunBatches, this);
+    } else {
+        for (int i = 0; i < kPoolThreads; ++i) {
+            threads_.emplace_back(&StorageWriterLinux::RunSingles, this);
+        }
+    }
+    return true;
+}
+
+void StorageWriterLinux::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_changed_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    ring_.reset();
+    using_ring_.store(false);
+
+    // Delivered now rather than from an idle callback that may never run.
+    g_source_remove_by_user_data(this);
+    DispatchCompleted(this);
+}
+
+uint64_t StorageWriterLinux::Enqueue(const StorageWriteRequest& request) {
+    if (!running_.load()) {
+        return 0;
+    }
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        id = next_id_++;
+        queue_.push_back(Pending{id, request});
+    }
+    queue_changed_.notify_one();
+    return id;
+}
+
+void StorageWriterLinux::RunBatches() {
+    std::vector<Pending> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;  // stopping, and nothing left to place
+            }
+            // Everything that queued up while the last batch ran.
+            size_t count = std::min(queue_.size(), kBatchSize);
+            batch.assign(std::make_move_iterator(queue_.begin()),
+                         std::make_move_iterator(queue_.begin() + count));
+            queue_.erase(queue_.begin(), queue_.begin() + count);
+        }
+        PlaceBatch(batch);
+        if (!ring_) {
+            // The ring failed; this thread joins a pool for the rest.
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                for (int i = 1; !stopping_ && i < kPoolThreads; ++i) {
+                    threads_.emplace_back(&StorageWriterLinux::RunSingles, this);
+                }
+            }
+            RunSingles();
+            return;
+        }
+    }
+}
+
+void StorageWriterLinux::RunSingles() {
+    while (true) {
+        Pending pending;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            pending = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        StorageWriteResult result;
+        result.id = pending.id;
+        result.context = pending.request.context;
+        result.method = FilePlacementLinux::Place(pending.request.source,
+                                                  pending.request.destination,
+                                                  pending.request.sync, &result.error);
+        Complete(result);
+    }
+}
+
+void StorageWriterLinux::PlaceBatch(std::vector<Pending>& batch) {
+    struct Slot {
+        int fd = -1;
+        // Index into directories, -1 without sync.
+        int directory = -1;
+        int error = 0;
+        std::string what;
+        bool renamed = false;
+    };
+    struct Directory {
+        std::string path;
+        int fd = -1;
+        bool changed = false;
+    };
+    std::vector<Slot> slots(batch.size());
+    std::vector<Directory> directories;
+    // SQEs point at the paths, so the vector must never reallocate: a short
+    // path lives inside the element.
+    directories.reserve(batch.size());
+    std::map<std::string, int> directory_index;
+
+    auto fail = [&slots](size_t i, const char* what, int error) {
+        if (slots[i].error == 0) {
+            slots[i].error = error;
+            slots[i].what = what;
+        }
+    };
+    int ring_error = 0;
+    // Submits the SQEs queued since the last call and hands each completion
+    // to |handle|; false if the ring itself failed. Whatever the kernel took
+    // before a failure is still waited for, so a late open is closed here
+    // instead of leaking, and no completion is left for the next batch.
+    auto run = [this, &ring_error](unsigned queued, auto handle) {
+        if (queued == 0) {
+            return true;
+        }
+        bool submitted = ring_->Submit(queued);
+        if (!submitted) {
+            ring_error = errno;
+        }
+        for (unsigned done = 0; done < queued;) {
+            io_uring_cqe* cqe = ring_->PeekCqe();
+            if (cqe == nullptr) {
+                if (submitted || ring_->InFlight() == 0 || !ring_->Submit(1)) {
+                    break;
+                }
+                continue;
+            }
+            handle(static_cast<Kind>(cqe->user_data & 0xff), cqe->user_data >> 8, cqe->res);
+            ring_->Advance();
+            ++done;
+        }
+        return submitted;
+    };
+
+    // Stage 1: open what needs syncing.
+    unsigned queued = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const StorageWriteRequest& request = batch[i].request;
+        if (!request.sync) continue;
+        std::string directory = FilePlacementLinux::DirectoryOf(request.destination);
+        auto found = directory_index.find(directory);
+        if (found == directory_index.end()) {
+            found = directory_index.emplace(directory, static_cast<int>(directories.size())).first;
+            directories.push_back(Directory{directory});
+            PrepOpen(ring_->GetSqe(), directories.back().path, O_RDONLY | O_DIRECTORY,
+                     Tag(kOpenDirectory, found->second));
+            ++queued;
+        }
+        slots[i].directory = found->second;
+        PrepOpen(ring_->GetSqe(), request.source, O_RDONLY, Tag(kOpenFile, i));
+        ++queued;
+    }
+    bool ok = run(queued, [&](Kind kind, size_t index, int res) {
+        if (kind == kOpenDirectory) {
+            // Without it only the directory sync is skipped.
+            directories[index].fd = res;
+        } else if (res < 0) {
+            fail(index, "cannot open source", -res);
+        } else {
+            slots[index].fd = res;
+        }
+    });
+
+    // Stage 2: sync each file, then give it its name. The link keeps a file
+    // whose data didn't reach the disk from appearing under its final name.
+    queued = 0;
+    for (size_t i = 0; ok && i < batch.size(); ++i) {
+        const StorageWriteRequest& request = batch[i].request;
+        if (slots[i].error != 0) continue;
+        if (request.sync) {
+            io_uring_sqe* sync = ring_->GetSqe();
+            PrepFsync(sync, slots[i].fd, true, Tag(kSyncFile, i));
+            sync->flags |= IOSQE_IO_LINK;
+            ++queued;
+        }
+        PrepRename(ring_->GetSqe(), request.source, request.destination, Tag(kRename, i));
+        ++queued;
+    }
+    ok = ok && run(queued, [&](Kind kind, size_t index, int res) {
+        if (kind == kSyncFile && res < 0) {
+            fail(index, "cannot sync source", -res);
+        } else if (kind == kRename && res == 0) {
+            slots[index].renamed = true;
+            if (slots[index].directory >= 0) {
+                directories[slots[index].directory].changed = true;
+            }
+        } else if (kind == kRename && res != -ECANCELED) {
+            fail(index, "rename failed", -res);
+        }
+    });
+
+    // Stage 3: make the new names durable, one sync per directory, and
+    // close everything. A hard link closes the directory even if its sync
+    // fails.
+    queued = 0;
+    for (size_t i = 0; ok && i < slots.size(); ++i) {
+        if (slots[i].fd < 0) continue;
+        PrepClose(ring_->GetSqe(), slots[i].fd, Tag(kClose, i));
+        ++queued;
+    }
+    for (size_t d = 0; ok && d < directories.size(); ++d) {
+        if (directories[d].fd < 0) continue;
+        if (directories[d].changed) {
+            io_uring_sqe* sync = ring_->GetSqe();
+            PrepFsync(sync, directories[d].fd, false, Tag(kSyncDirectory, d));
+            sync->flags |= IOSQE_IO_HARDLINK;
+            ++queued;
+        }
+        PrepClose(ring_->GetSqe(), directories[d].fd, Tag(kClose, batch.size() + d));
+        ++queued;
+    }
+    // Sync and close failures here don't undo the placement.
+    ok = ok && run(queued, [&](Kind kind, size_t index, int) {
+        if (kind != kClose) return;
+        if (index < slots.size()) {
+            slots[index].fd = -1;
+        } else {
+            directories[index - slots.size()].fd = -1;
+        }
+    });
+
+    if (!ok) {
+        // Requests the kernel took but never completed may still use the
+        // ring and its descriptors, so only an idle ring is cleaned up after.
+        if (ring_->InFlight() == 0) {
+            for (const Slot& slot : slots) {
+                if (slot.fd >= 0) close(slot.fd);
+            }
+            for (const Directory& directory : directories) {
+                if (directory.fd >= 0) close(directory.fd);
+            }
+        }
+        // Unsubmitted SQEs would go out with the next batch; the ring is
+        // done for.
+        g_warning("io_uring failed (%s), placing files on a thread pool", strerror(ring_error));
+        ring_.reset();
+        using_ring_.store(false);
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const StorageWriteRequest& request = batch[i].request;
+        StorageWriteResult result;
+        result.id = batch[i].id;
+        result.context = request.context;
+        if (slots[i].renamed) {
+            result.method = FilePlacementLinux::Method::kRenamed;
+        } else if (slots[i].error == EXDEV) {
+            // Another filesystem: copy it, which the ring can't do in one step.
+            result.method = FilePlacementLinux::Place(request.source, request.destination,
+                                                      request.sync, &result.error);
+        } else if (slots[i].error != 0) {
+            result.error = ErrorMessage(slots[i].what.c_str(), slots[i].error);
+        } else {
+            // The ring failed before getting to it.
+            result.method = FilePlacementLinux::Place(request.source, request.destination,
+                                                      request.sync, &result.error);
+        }
+        Complete(result);
+    }
+}
+
+void StorageWriterLinux::Complete(const StorageWriteResult& result) {
+    std::lock_guard<std::mutex> lock(completed_mutex_);
+    completed_.push_back(result);
+    if (!dispatch_scheduled_ && running_.load()) {
+        dispatch_scheduled_ = true;
+        g_idle_add(DispatchCompleted, this);
+    }
+}
+
+gboolean StorageWriterLinux::DispatchCompleted(gpointer user_data) {
+    StorageWriterLinux* self = static_cast<StorageWriterLinux*>(user_data);
+    std::deque<StorageWriteResult> completed;
+    {
+        std::lock_guard<std::mutex> lock(self->completed_mutex_);
+        completed.swap(self->completed_);
+        self->dispatch_scheduled_ = false;
+    }
+    for (const StorageWriteResult& result : completed) {
+        self->callback_(result, self->user_data_);
+    }
+    return G_SOURCE_REMOVE;
+}
@@ -0,0 +1,107 @@
+#ifndef STORAGE_WRITER_LINUX_H_
+#define STORAGE_WRITER_LINUX_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glib.h>
+
+#include "file_placement_linux.h"
+
+class IoUringLinux;
+
+struct StorageWriteRequest {
+    // A finished download, moved to destination (see FilePlacementLinux).
+    std::string source;
+    std::string destination;
+    // Make the data and the new name durable before reporting success.
+    bool sync = true;
+    // Opaque caller data, handed back unchanged in the result.
+    gpointer context = nullptr;
+};
+
+struct StorageWriteResult {
+    uint64_t id = 0;
+    FilePlacementLinux::Method method = FilePlacementLinux::Method::kFailed;
+    std::string error;
+    gpointer context = nullptr;
+};
+
+// Places finished downloads in the image folder off the main thread, in
+// batches.
+//
+// Requests that arrive while a batch is in flight form the next batch, so
+// the batch size follows the load with no added latency. With io_uring each
+// batch costs three io_uring_enter() calls however many files it holds:
+// open the sources and their directories; then per file fdatasync and
+// renameat2, linked so a failed sync leaves the name alone; then one fsync
+// per directory, and a close for every descriptor opened. Files on another filesystem than their destination are
+// copied as before (FilePlacementLinux). Where io_uring is missing or lacks
+// those operations (Linux < 5.11, or blocked), a small thread pool places
+// each file with plain syscalls instead; so does a writer whose ring fails
+// while running. Completions are delivered on the GLib main context.
+class StorageWriterLinux {
+public:
+    // Invoked on the main context once per enqueued request.
+    typedef void (*CompletionCallback)(const StorageWriteResult& result, gpointer user_data);
+
+    StorageWriterLinux(CompletionCallback callback, gpointer user_data);
+    ~StorageWriterLinux();
+
+    bool Start();
+
+    // Finishes the requests already queued, then joins the workers; their
+    // results are delivered before this returns.
+    void Stop();
+
+    bool IsRunning() const { return running_.load(); }
+
+    // Whether batches go through io_uring rather than the thread pool.
+    bool UsesIoUring() const { return using_ring_.load(); }
+
+    // Queues a request and returns its id, or 0 if the writer isn't running.
+    uint64_t Enqueue(const StorageWriteRequest& request);
+
+private:
+    struct Pending {
+        uint64_t id;
+        StorageWriteRequest request;
+    };
+
+    void RunBatches();
+    void RunSingles();
+    void PlaceBatch(std::vector<Pending>& batch);
+    void Complete(const StorageWriteResult& result);
+
+    static gboolean DispatchCompleted(gpointer user_data);
+
+    CompletionCallback callback_;
+    gpointer user_data_;
+
+    // Owned by the batch thread once started.
+    std::unique_ptr<IoUringLinux> ring_;
+    // Guarded by queue_mutex_ while running: a failed ring adds pool threads.
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_;
+    std::atomic<bool> using_ring_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_changed_;
+    std::deque<Pending> queue_;
+    bool stopping_;
+    uint64_t next_id_;
+
+    // Results waiting for the main context.
+    std::mutex completed_mutex_;
+    std::deque<StorageWriteResult> completed_;
+    bool dispatch_scheduled_;
+};
+
+#endif  // STORAGE_WRITER_LINUX_H_
@@ -0,0 +1,217 @@
+#include "wireless_probe_linux.h"
+#include <cerrno>
+#include <cstring>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/nl80211.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+// The monitor thread blocks on replies; a wedged driver must not stall it.
+constexpr int kReceiveTimeoutMs = 200;
+
+// Calls |visit| with the type, payload and payload length of every attribute
+// in [data, data + length).
+template <typename Visitor>
+void ForEachAttribute(const uint8_t* data, size_t length, Visitor visit) {
+    while (length >= NLA_HDRLEN) {
+        struct nlattr attribute;
+        memcpy(&attribute, data, sizeof(attribute));
+        if (attribute.nla_len < NLA_HDRLEN || attribute.nla_len > length) {
+            break;
+        }
+        visit(attribute.nla_type & NLA_TYPE_MASK, data + NLA_HDRLEN,
+              static_cast<size_t>(attribute.nla_len - NLA_HDRLEN));
+        size_t step = NLA_ALIGN(attribute.nla_len);
+        if (step >= length) {
+            break;
+        }
+        data += step;
+        length -= step;
+    }
+}
+
+template <typename T>
+T ReadValue(const uint8_t* data) {
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Reads the replies to request |sequence| and calls |handle| with the
+// attributes of each. Returns false on a netlink error or timeout.
+template <typename Handler>
+bool ReceiveReplies(int fd, uint32_t sequence, Handler handle) {
+    alignas(struct nlmsghdr) uint8_t buffer[16384];
+    while (true) {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (len == 0) {
+            return false;
+        }
+
+        int remaining = static_cast<int>(len);
+        for (struct nlmsghdr* nh = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(nh, remaining); nh = NLMSG_NEXT(nh, remaining)) {
+            // Late replies to a request that timed out.
+            if (nh->nlmsg_seq != sequence) continue;
+
+            if (nh->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (nh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr* error =
+                    static_cast<const struct nlmsgerr*>(NLMSG_DATA(nh));
+                return error->error == 0;
+            }
+            if (nh->nlmsg_len >= NLMSG_LENGTH(GENL_HDRLEN)) {
+                const uint8_t* payload = static_cast<const uint8_t*>(NLMSG_DATA(nh)) + GENL_HDRLEN;
+                handle(payload, nh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN));
+            }
+            if ((nh->nlmsg_flags & NLM_F_MULTI) == 0) {
+                return true;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+WirelessProbeLinux::WirelessProbeLinux() : fd_(-1), family_id_(0), sequence_(0) {}
+
+WirelessProbeLinux::~WirelessProbeLinux() {
+    Close();
+}
+
+bool WirelessProbeLinux::Open() {
+    if (fd_ >= 0) {
+        return true;
+    }
+
+    int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (sock == -1) {
+        return false;
+    }
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = kReceiveTimeoutMs * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    fd_ = sock;
+
+    static const char kFamilyName[] = NL80211_GENL_NAME;
+    uint16_t family_id = 0;
+    bool resolved = Send(GENL_ID_CTRL, 0, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME,
+                         kFamilyName, sizeof(kFamilyName)) &&
+                    ReceiveReplies(fd_, sequence_, [&](const uint8_t* data, size_t length) {
+                        ForEachAttribute(data, length, [&](uint16_t type, const uint8_t* value,
+                                                           size_t size) {
+                            if (type == CTRL_ATTR_FAMILY_ID && size >= sizeof(uint16_t)) {
+                                family_id = ReadValue<uint16_t>(value);
+                            }
+                        });
+                    });
+    if (!resolved || family_id == 0) {
+        Close();
+        return false;
+    }
+    family_id_ = family_id;
+    return true;
+}
+
+void WirelessProbeLinux::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    family_id_ = 0;
+}
+
+bool WirelessProbeLinux::Query(int ifindex, int32_t* signal_dbm, int32_t* tx_bitrate_kbps) {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    uint32_t index = static_cast<uint32_t>(ifindex);
+    if (!Send(family_id_, NLM_F_DUMP, NL80211_CMD_GET_STATION, NL80211_ATTR_IFINDEX, &index,
+              sizeof(index))) {
+        return false;
+    }
+
+    // A managed-mode interface has one station: its access point.
+    bool found = false;
+    int32_t signal = 0;
+    int32_t bitrate = -1;
+    auto parse_rate = [&](uint16_t type, const uint8_t* value, size_t size) {
+        // Both attributes count in units of 100 kbit/s.
+        if (type == NL80211_RATE_INFO_BITRATE32 && size >= sizeof(uint32_t)) {
+            bitrate = static_cast<int32_t>(ReadValue<uint32_t>(value) * 100);
+        } else if (type == NL80211_RATE_INFO_BITRATE && size >= sizeof(uint16_t) && bitrate < 0) {
+            bitrate = ReadValue<uint16_t>(value) * 100;
+        }
+    };
+    auto parse_station = [&](uint16_t type, const uint8_t* value, size_t size) {
+        if (type == NL80211_STA_INFO_SIGNAL && size >= 1) {
+            signal = static_cast<int8_t>(value[0]);
+        } else if (type == NL80211_STA_INFO_TX_BITRATE) {
+            ForEachAttribute(value, size, parse_rate);
+        }
+    };
+    bool ok = ReceiveReplies(fd_, sequence_, [&](const uint8_t* data, size_t length) {
+        if (found) return;
+        ForEachAttribute(data, length, [&](uint16_t type, const uint8_t* value, size_t size) {
+            if (type == NL80211_ATTR_STA_INFO) {
+                found = true;
+                ForEachAttribute(value, size, parse_station);
+            }
+        });
+    });
+    if (!ok || !found) {
+        return false;
+    }
+
+    *signal_dbm = signal;
+    *tx_bitrate_kbps = bitrate;
+    return true;
+}
+
+bool WirelessProbeLinux::Send(uint16_t type, uint16_t flags, uint8_t command,
+                              uint16_t attribute, const void* data, uint16_t length) {
+    struct {
+        struct nlmsghdr header;
+        struct genlmsghdr genl;
+        uint8_t attributes[64];
+    } request;
+    memset(&request, 0, sizeof(request));
+    if (static_cast<size_t>(NLA_HDRLEN) + length > sizeof(request.attributes)) {
+        return false;
+    }
+
+    struct nlattr nla;
+    nla.nla_type = attribute;
+    nla.nla_len = static_cast<uint16_t>(NLA_HDRLEN + length);
+    memcpy(request.attributes, &nla, sizeof(nla));
+    memcpy(request.attributes + NLA_HDRLEN, data, length);
+
+    request.header.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(nla.nla_len));
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = static_cast<uint16_t>(NLM_F_REQUEST | flags);
+    request.header.nlmsg_seq = ++sequence_;
+    request.genl.cmd = command;
+    request.genl.version = 1;
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    ssize_t sent;
+    do {
+        sent = sendto(fd_, &request, request.header.nlmsg_len, 0,
+                      reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel));
+    } while (sent < 0 && errno == EINTR);
+    return sent == static_cast<ssize_t>(request.header.nlmsg_len);
+}
@@ -0,0 +1,36 @@
+#ifndef WIRELESS_PROBE_LINUX_H_
+#define WIRELESS_PROBE_LINUX_H_
+
+#include <cstdint>
+
+// Asks nl80211 (generic netlink) for the signal strength and transmit rate
+// of a wireless interface's current association, the numbers `iw dev <if>
+// link` prints. Talks to the kernel directly, no libnl.
+class WirelessProbeLinux {
+public:
+    WirelessProbeLinux();
+    ~WirelessProbeLinux();
+
+    // Opens a generic netlink socket and resolves the nl80211 family. Returns
+    // false when the kernel has no cfg80211 (no wireless hardware, or a
+    // sandbox), in which case wireless links just report unknown quality.
+    bool Open();
+    void Close();
+
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Signal in dBm and transmit bitrate in kbit/s of the station |ifindex|
+    // is associated with. Returns false if it isn't associated or the query
+    // fails; outputs are only written on success.
+    bool Query(int ifindex, int32_t* signal_dbm, int32_t* tx_bitrate_kbps);
+
+private:
+    bool Send(uint16_t type, uint16_t flags, uint8_t command, uint16_t attribute,
+              const void* data, uint16_t length);
+
+    int fd_;
+    uint16_t family_id_;
+    uint32_t sequence_;
+};
+
+#endif  // WIRELESS_PROBE_LINUX_H_
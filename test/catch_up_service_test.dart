@@ -0,0 +1,256 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:dio/dio.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:imagedumper/core/utils/sp_manager.dart';
+import 'package:imagedumper/models/download_record.dart';
+import 'package:imagedumper/models/image_model.dart';
+import 'package:imagedumper/services/api_service.dart';
+import 'package:imagedumper/services/catch_up_service.dart';
+import 'package:imagedumper/services/download_history.dart';
+import 'package:imagedumper/services/download_scheduler.dart';
+import 'package:imagedumper/services/download_service.dart';
+import 'package:imagedumper/services/storage_service.dart';
+import 'package:shared_preferences/shared_preferences.dart';
+
+/// Stand-in for the backend's `GET /api/images?since=&limit=` manifest
+/// Image `i` is `image-i.jpg`; the cursor after it is `i + 1`.
+class _ManifestServer {
+  final HttpServer _server;
+  int total;
+  int requests = 0;
+
+  _ManifestServer._(this._server, this.total) {
+    _server.listen(_handle);
+  }
+
+  static Future<_ManifestServer> start(int total) async {
+    final server = await HttpServer.bind(InternetAddress.loopbackIPv4, 0);
+    return _ManifestServer._(server, total);
+  }
+
+  String get baseUrl => 'http://127.0.0.1:${_server.port}/api';
+
+  Future<void> close() => _server.close(force: true);
+
+  void _handle(HttpRequest request) {
+    if (request.uri.path != '/api/images') {
+      request.response
+        ..statusCode = HttpStatus.notFound
+        ..close();
+      return;
+    }
+    requests++;
+    final query = request.uri.queryParameters;
+    final since = int.tryParse(query['since'] ?? '') ?? 0;
+    final limit = int.tryParse(query['limit'] ?? '') ?? 100;
+    final end = since + limit < total ? since + limit : total;
+    request.response
+      ..headers.contentType = ContentType.json
+      ..write(
+        jsonEncode({
+          'images': [
+            for (var i = since; i < end; i++)
+              {
+                'filename': 'image-$i.jpg',
+                'url': '/uploads/image-$i.jpg',
+                'size': 1024,
+              },
+          ],
+          'nextCursor': '$end',
+          'hasMore': end < total,
+        }),
+      )
+      ..close();
+  }
+}
+
+/// Downloads that start and never finish, so queued images stay queued
+class _StalledDownloadManager extends DownloadManager {
+  _StalledDownloadManager() : super(Dio());
+
+  @override
+  bool get supportsArchives => false;
+
+  @override
+  Stream<DownloadResult> downloadImageToGallery(
+    String imageUrl, {
+    String? checksum,
+    int size = 0,
+  }) {
+    return StreamController<DownloadResult>().stream;
+  }
+}
+
+/// Archives are supported but every archive download fails outright, as
+/// against a backend without `/images/archive`
+class _FailingArchiveDownloadManager extends _StalledDownloadManager {
+  @override
+  bool get supportsArchives => true;
+
+  @override
+  Stream<DownloadResult> downloadArchiveToGallery(
+    String archiveUrl,
+    List<ImageModel> images,
+  ) {
+    return Stream.value(
+      DownloadResult(
+        status: DownloadStatus.failed,
+        message: 'Archive download failed: 404',
+        result: false,
+      ),
+    );
+  }
+}
+
+class _EmptyStorage extends StorageService {
+  @override
+  Future<bool?> hasImage(String filename, {int? size}) async => false;
+}
+
+class _EmptyHistory extends DownloadHistory {
+  @override
+  Future<DownloadRecord?> latest() async => null;
+}
+
+/// URL ImageModel.fromJson makes of the server's `url` for image [i]
+String _urlOf(int i) => 'http://192.168.0.3:3000/uploads/image-$i.jpg';
+
+void main() {
+  late _ManifestServer server;
+  late DownloadScheduler scheduler;
+  late CatchUpService catchUp;
+
+  Future<void> setUpWith({
+    required int total,
+    int maxQueued = 1000,
+    DownloadManager? manager,
+  }) async {
+    server = await _ManifestServer.start(total);
+    scheduler = DownloadScheduler(
+      manager ?? _StalledDownloadManager(),
+      maxConcurrent: 1,
+      maxQueued: maxQueued,
+      archiveUrl: '${server.baseUrl}/images/archive',
+    );
+    catchUp = CatchUpService(
+      ApiService(Dio(BaseOptions(baseUrl: server.baseUrl))),
+      scheduler,
+      _EmptyStorage(),
+      _EmptyHistory(),
+    );
+  }
+
+  Future<void> setCursor(String? cursor) async {
+    final prefs = await SharedPreferences.getInstance();
+    if (cursor == null) {
+      await prefs.remove('sync_cursor');
+    } else {
+      await SPManager.setSyncCursor(cursor);
+    }
+  }
+
+  setUpAll(() {
+    SharedPreferences.setMockInitialValues({});
+  });
+
+  tearDown(() async {
+    scheduler.dispose();
+    await server.close();
+    await SPManager.setInterruptedDownloads([]);
+  });
+
+  test('queues every missed image in ceil(N / 100) + 1 requests', () async {
+    const seen = 30;
+    const missed = 250;
+    await setUpWith(total: seen + missed);
+    await setCursor('$seen');
+
+    final results = await catchUp.catchUp();
+
+    expect(results, hasLength(missed));
+    for (var i = seen; i < seen + missed; i++) {
+      expect(scheduler.isQueuedOrActive(_urlOf(i)), isTrue);
+    }
+    expect(
+      server.requests,
+      lessThanOrEqualTo((missed / CatchUpService.pageSize).ceil() + 1),
+    );
+    expect(await SPManager.getSyncCursor(), '${seen + missed}');
+  });
+
+  test('nothing missed costs one request', () async {
+    await setUpWith(total: 40);
+    await setCursor('40');
+
+    expect(await catchUp.catchUp(), isEmpty);
+    expect(server.requests, 1);
+  });
+
+  test('first run starts from the real end of a long manifest', () async {
+    const total = 5150;
+    await setUpWith(total: total);
+    await setCursor(null);
+
+    expect(await catchUp.catchUp(), isEmpty);
+    expect(await SPManager.getSyncCursor(), '$total');
+
+    // Only what comes after it is downloaded
+    server.total = total + 3;
+    expect(await catchUp.catchUp(), hasLength(3));
+  });
+
+  test('images the full queue turns away are deferred, not lost', () async {
+    const missed = 120;
+    const maxQueued = 50;
+    await setUpWith(total: missed, maxQueued: maxQueued);
+    await setCursor('0');
+
+    await catchUp.catchUp();
+    await pumpEventQueue();
+
+    // maxQueued fit the queue (one of them is running now); the rest are
+    // kept for resumeInterrupted()
+    final deferred = await SPManager.getInterruptedDownloads();
+    expect(deferred, hasLength(missed - maxQueued));
+    for (var i = 0; i < missed; i++) {
+      final url = _urlOf(i);
+      expect(
+        scheduler.isQueuedOrActive(url) ||
+            deferred.any((saved) => saved.contains('"$url"')),
+        isTrue,
+      );
+    }
+    expect(await SPManager.getSyncCursor(), '$missed');
+  });
+
+  test('images a failed archive leaves are deferred, not lost', () async {
+    const missed = 120;
+    const maxQueued = 50;
+    await setUpWith(
+      total: missed,
+      maxQueued: maxQueued,
+      manager: _FailingArchiveDownloadManager(),
+    );
+    await setCursor('0');
+
+    // One archive of all of them, which fails; they are queued singly
+    // and overflow the queue
+    await catchUp.catchUp();
+    await pumpEventQueue();
+
+    final deferred = await SPManager.getInterruptedDownloads();
+    expect(deferred, hasLength(missed - maxQueued));
+    for (var i = 0; i < missed; i++) {
+      final url = _urlOf(i);
+      expect(
+        scheduler.isQueuedOrActive(url) ||
+            deferred.any((saved) => saved.contains('"$url"')),
+        isTrue,
+      );
+    }
+    expect(scheduler.queueState.dropped, 0);
+  });
+}
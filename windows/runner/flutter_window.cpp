@@ -51,6 +51,13 @@ bool FlutterWindow::OnCreate() {
         } else if (call.method_name().compare("isConnected") == 0) {
           bool isConnected = NetworkServiceWindows::IsConnected();
           result->Success(flutter::EncodableValue(isConnected));
+        } else if (call.method_name().compare("getStatus") == 0) {
+          auto status = flutter::EncodableMap{
+            {flutter::EncodableValue("isConnected"), flutter::EncodableValue(NetworkServiceWindows::IsConnected())},
+            {flutter::EncodableValue("isWifiOrEthernet"), flutter::EncodableValue(NetworkServiceWindows::IsConnectedToWifiOrEthernet())},
+            {flutter::EncodableValue("networkType"), flutter::EncodableValue(NetworkServiceWindows::GetNetworkType())}
+          };
+          result->Success(flutter::EncodableValue(status));
         } else if (call.method_name().compare("startNetworkMonitoring") == 0) {
           this->StartNetworkMonitoring();
           result->Success();